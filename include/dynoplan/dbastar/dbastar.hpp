@@ -36,7 +36,12 @@
 #include "dynobench/planar_rotor.hpp"
 #include "dynobench/quadrotor.hpp"
 #include "dynoplan/dbastar/heuristics.hpp"
+#include "dynoplan/dbastar/node_pool.hpp"
+#include "dynoplan/dbastar/open_list.hpp"
 #include "dynoplan/dbastar/options.hpp"
+#include "dynoplan/dbastar/successor_table.hpp"
+#include "dynoplan/output_sink.hpp"
+#include "dynoplan/thread_pool.hpp"
 
 namespace dynoplan {
 
@@ -54,7 +59,8 @@ typedef typename boost::heap::d_ary_heap<AStarNode *, boost::heap::arity<2>,
                                          boost::heap::mutable_<true>>
     open_t;
 
-// Node type (used for open and explored states)
+// Node type (used for open and explored states in dbrrt).
+// dbastar uses the compact SearchNode, see node_pool.hpp
 struct AStarNode {
   const ob::State *state;
   Eigen::VectorXd state_eig;
@@ -154,9 +160,6 @@ double automatic_delta(double delta_in, double alpha, RobotOmpl &robot,
 void filte_duplicates(std::vector<Motion> &motions, double delta, double alpha,
                       RobotOmpl &robot, ompl::NearestNeighbors<Motion *> &T_m);
 
-void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
-             dynobench::Trajectory &traj_out, Out_info_db &out_info_db);
-
 struct LazyTraj {
 
   Eigen::VectorXd *offset;
@@ -244,6 +247,8 @@ struct Expander {
   size_t max_k = std::numeric_limits<size_t>::max();
   double time_in_nn = 0;
   bool verbose = false;
+  const Successor_table *successor_table = nullptr; // optional
+  size_t num_successor_table = 0; // expansions answered by successor_table
 
   Expander(dynobench::Model_robot *robot, ompl::NearestNeighbors<Motion *> *T_m,
            double delta)
@@ -267,8 +272,10 @@ struct Expander {
 
   void seed(int seed) { g.seed(seed); }
 
+  // motion_idx: motion that reached x (-1 if unknown), to use the
+  // successor_table
   void expand_lazy(Eigen::Ref<const Eigen::VectorXd> x,
-                   std::vector<LazyTraj> &lazy_trajs) {
+                   std::vector<LazyTraj> &lazy_trajs, int motion_idx = -1) {
 
     robot->canonical_state(x, canonical_state);
     robot->offset(x, offset);
@@ -278,7 +285,12 @@ struct Expander {
     Stopwatch sw;
     // CSTR_(x);
 
-    T_m->nearestR(&fakeMotion, delta, neighbors_m);
+    if (successor_table && motion_idx >= 0 &&
+        successor_table->find(motion_idx, canonical_state, neighbors_m)) {
+      num_successor_table++;
+    } else {
+      T_m->nearestR(&fakeMotion, delta, neighbors_m);
+    }
     time_in_nn += sw.elapsed_ms();
 
     if (!neighbors_m.size() && verbose) {
@@ -324,18 +336,114 @@ void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
                                     AStarNode *solution,
                                     const dynobench::Problem &problem,
                                     dynobench::Trajectory &traj_out,
-                                    std::ofstream *out = nullptr);
+                                    std::ostream *out = nullptr);
+
+void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
+                                    const std::vector<Motion> &motions,
+                                    SearchNode *solution,
+                                    const dynobench::Problem &problem,
+                                    dynobench::Trajectory &traj_out,
+                                    std::ostream *out = nullptr);
 
 void check_goal(dynobench::Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
                 const Eigen::Ref<const Eigen::VectorXd> &goal,
                 dynobench::TrajWrapper &traj_wrapper, double distance_bound,
                 size_t num_check_goal, int &chosen_index);
 
+// const_motion: if true, the collision shape of the motion is not modified
+// (thread-safe if each thread has its own robot).
 bool check_lazy_trajectory(
     LazyTraj &lazy_traj, dynobench::Model_robot &robot,
     Time_benchmark &time_bench, dynobench::TrajWrapper &tmp_traj,
     Eigen::Ref<Eigen::VectorXd> aux_last_state,
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *check_state = nullptr,
-    int *num_valid_states = nullptr, bool forward = true);
+    int *num_valid_states = nullptr, bool forward = true,
+    bool const_motion = false);
+
+// Heuristic for dbastar, chosen with options_dbastar.heuristic. heu_map is
+// the storage if the roadmap has to be loaded or computed. T_m has the
+// primitives of the search (the HLUT must be built for them, see hlut_hash).
+std::shared_ptr<Heu_fun>
+make_heuristic(const dynobench::Problem &problem,
+               std::shared_ptr<dynobench::Model_robot> robot,
+               Options_dbastar &options_dbastar,
+               ompl::NearestNeighbors<Motion *> &T_m,
+               std::vector<Heuristic_node> &heu_map,
+               Time_benchmark &time_bench);
+
+// Scratch memory of a thread that checks motion primitives (see
+// num_threads_check). Each worker has its own robot model, because the
+// collision check modifies the collision objects of the robot.
+struct Check_worker {
+  std::shared_ptr<dynobench::Model_robot> robot;
+  Eigen::VectorXd aux_last_state;
+  Time_benchmark time_bench;
+  std::function<bool(Eigen::Ref<Eigen::VectorXd>)> is_state_valid;
+};
+
+/**
+ * @brief db-A* planner that can answer several queries.
+ *
+ * The robot model, the environment, the tree of motion primitives and the
+ * heuristic are created once, in the constructor. plan() only runs the
+ * search, and reuses the memory of the previous search. The heuristic is
+ * computed again only if the goal changes (a roadmap given with heu_map_ptr
+ * or heu_map_file is only used for the goal of the problem).
+ *
+ * The motion primitives (options_dbastar.motions_ptr) must outlive the
+ * planner.
+ */
+struct DbAStarPlanner {
+
+  DbAStarPlanner(const dynobench::Problem &problem,
+                 const Options_dbastar &options_dbastar);
+
+  DbAStarPlanner(const DbAStarPlanner &) = delete;
+  DbAStarPlanner &operator=(const DbAStarPlanner &) = delete;
+
+  ~DbAStarPlanner();
+
+  void plan(const Eigen::VectorXd &start, const Eigen::VectorXd &goal,
+            dynobench::Trajectory &traj_out, Out_info_db &out_info_db,
+            double budget_ms = -1);
+
+  dynobench::Problem problem; // start and goal of the last query
+  Options_dbastar options_dbastar;
+  std::shared_ptr<dynobench::Model_robot> robot;
+  ompl::NearestNeighbors<Motion *> *T_m = nullptr;
+  ompl::NearestNeighbors<SearchNode *> *T_n = nullptr;
+  std::unique_ptr<Successor_table> successor_table; // optional
+  std::unique_ptr<NodePool> node_pool;
+  std::unique_ptr<Open_list> open_list;
+
+  std::shared_ptr<Heu_fun> h_fun;
+  Eigen::VectorXd h_fun_goal;
+  std::vector<Heuristic_node> heu_map;
+
+  // Time spent in the setup, reported in the next query
+  Time_benchmark time_bench_setup;
+
+  dynobench::TrajWrapper traj_wrapper;
+
+  std::unique_ptr<Thread_pool> check_pool;
+  std::vector<Check_worker> check_workers;
+  std::vector<dynobench::TrajWrapper> check_trajs;
+  std::vector<char> check_valid;
+  size_t check_chunk = 1;
+
+private:
+  void update_heuristic(const Eigen::VectorXd &goal);
+};
+
+void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
+             dynobench::Trajectory &traj_out, Out_info_db &out_info_db);
+
+// Parallel version of dbastar: the best num_threads nodes of the open list
+// are expanded and checked in parallel, and then added to the search in a
+// deterministic order.
+void dbastar_parallel(const dynobench::Problem &problem,
+                      Options_dbastar options_dbastar,
+                      dynobench::Trajectory &traj_out,
+                      Out_info_db &out_info_db);
 
 } // namespace dynoplan
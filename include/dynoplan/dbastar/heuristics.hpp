@@ -34,6 +34,7 @@
 #include "dynobench/general_utils.hpp"
 
 #include "dynoplan/dbastar/options.hpp"
+#include "dynoplan/nn_state_query.hpp"
 
 namespace dynoplan {
 
@@ -107,6 +108,9 @@ double heuristicCollisionsTree(ompl::NearestNeighbors<Heuristic_node *> *T_heu,
 void write_heu_map(const std::vector<Heuristic_node> &heu_map, const char *file,
                    const char *header = nullptr);
 
+void write_heu_map(const std::vector<Heuristic_node> &heu_map,
+                   std::ostream &out, const char *header = nullptr);
+
 struct Heu_fun {
   virtual double h(const Eigen::VectorXd &x) = 0;
   virtual ~Heu_fun() = default;
@@ -190,24 +194,88 @@ struct Heu_roadmap : Heu_fun {
   };
 };
 
-template <typename _T, typename _Node> struct Heu_roadmap_bwd : Heu_fun {
+// Cost-to-go on a dense grid of the workspace (heuristic 2).
+//
+// The positions of the workspace (p_lb, p_ub, 2D or 3D) are rasterized at
+// `resolution`: a grid point is free if the robot at this position is
+// collision free for the goal orientation or one of a fixed sweep of
+// headings (with zero velocity), and the free points are inflated by one
+// cell. A Dijkstra wavefront from the goal over the 8/26-connected grid
+// gives the distance to the goal of each point. h(x) interpolates the
+// distance at the position of x, corrected for the connectivity of the grid
+// and the resolution, converts it to time and combines it with
+// lower_bound_time_vel, as Heu_roadmap.
+//
+// The heuristic is deterministic, but NOT admissible in general: a passage
+// that the robot only traverses at orientations outside the sweep (or
+// narrower than the inflation) is blocked in the grid. The solutions of the
+// search are then not guaranteed to be optimal.
+//
+// Requires that the first components of the state are the position.
+struct Heu_grid : Heu_fun {
+
+  std::shared_ptr<dynobench::Model_robot> robot;
+  Eigen::VectorXd goal;
+  Eigen::VectorXd lb;
+  double resolution;
+  size_t dim;
+  std::vector<size_t> num_points; // per dim
+  std::vector<float> distance;    // to the goal, inf if not reachable
+  double time_per_distance = 1;   // lower bound of time per unit of length
+
+  // worker_robots: one robot (with the environment) per thread to rasterize
+  // the workspace (default: sequential with `robot`).
+  Heu_grid(std::shared_ptr<dynobench::Model_robot> robot,
+           const Eigen::VectorXd &goal, const Eigen::VectorXd &p_lb,
+           const Eigen::VectorXd &p_ub, double resolution,
+           std::vector<std::shared_ptr<dynobench::Model_robot>>
+               worker_robots = {});
+
+  virtual double h(const Eigen::VectorXd &x) override;
+
+  virtual ~Heu_grid() override{};
+
+private:
+  size_t index(const size_t *cell) const {
+    size_t i = 0;
+    for (size_t k = dim; k-- > 0;) {
+      i = i * num_points[k] + cell[k];
+    }
+    return i;
+  }
+};
+
+// Cost-to-go from the tree of a reverse search (gScore of the nearest node).
+// If the tree supports queries by state (NN_state_query), h() does not
+// allocate; otherwise the state is copied into a fake node.
+template <typename _Node> struct Heu_roadmap_bwd : Heu_fun {
 
   Heu_roadmap_bwd(std::shared_ptr<dynobench::Model_robot> robot,
-                  ompl::NearestNeighbors<_T> *heuristic_nn,
+                  ompl::NearestNeighbors<_Node *> *heuristic_nn,
                   const Eigen::VectorXd &goal)
-      : robot(robot), heuristic_nn(heuristic_nn), goal(goal) {}
+      : robot(robot), heuristic_nn(heuristic_nn), goal(goal) {
+    state_query = dynamic_cast<NN_state_query<_Node *> *>(heuristic_nn);
+    if (state_query && !state_query->has_state_query()) {
+      state_query = nullptr;
+    }
+    if (heuristic_nn && !state_query) {
+      fake_node = std::make_unique<_Node>();
+    }
+  }
 
   std::shared_ptr<dynobench::Model_robot> robot;
-  ompl::NearestNeighbors<_T> *heuristic_nn;
+  ompl::NearestNeighbors<_Node *> *heuristic_nn;
+  NN_state_query<_Node *> *state_query = nullptr;
+  std::unique_ptr<_Node> fake_node;
   Eigen::VectorXd goal;
 
   virtual double h(const Eigen::VectorXd &x) override {
     assert(x.size() == robot->nx);
-    if (heuristic_nn) {
-      auto fake_node = std::make_shared<_Node>();
+    if (state_query) {
+      return state_query->nearest_state(x)->gScore;
+    } else if (heuristic_nn) {
       fake_node->state_eig = x;
-      auto nearest_node = heuristic_nn->nearest(fake_node);
-      return nearest_node->gScore;
+      return heuristic_nn->nearest(fake_node.get())->gScore;
     } else {
       return robot->lower_bound_time(x, goal);
     }
@@ -216,15 +284,94 @@ template <typename _T, typename _Node> struct Heu_roadmap_bwd : Heu_fun {
   virtual ~Heu_roadmap_bwd() override{};
 };
 
+// Memoised h of another heuristic, for the expensive ones (roadmap).
+//
+// The states are quantised at `resolution` (all components) and the values
+// are stored in a bounded open addressing table with linear probing. When
+// the `max_probes` slots of a key are used, the first one is overwritten.
+// The value of a cell is the one of the first state evaluated in the cell.
+struct Heu_cached : Heu_fun {
+
+  std::shared_ptr<Heu_fun> heu;
+  double resolution;
+  size_t max_probes = 8;
+  size_t hits = 0;
+  size_t misses = 0;
+
+  // capacity is rounded up to a power of 2
+  Heu_cached(std::shared_ptr<Heu_fun> heu, double resolution,
+             size_t capacity = 1 << 16);
+
+  virtual double h(const Eigen::VectorXd &x) override;
+
+  // Add the hits and misses since the last call to time_bench
+  void collect(Time_benchmark &time_bench);
+
+  virtual ~Heu_cached() override{};
+
+private:
+  struct Entry {
+    uint64_t key = 0;
+    double value = 0;
+    bool used = false;
+  };
+  std::vector<Entry> table;
+  size_t mask;
+};
+
+// Roadmap between the samples (edges shorter than distance_threshold and
+// collision free at `resolution`), and distances to the last sample (goal).
+//
+// If `robot_type` is given and its nigh metric is robot->distance (see
+// nigh_candidates_exact), the candidate edges are found with a nigh tree
+// instead of checking all pairs. The edges are checked with one thread per
+// robot in `worker_robots` (default: sequential with `robot`). The roadmap
+// does not depend on these two arguments.
 void build_heuristic_distance_new(
     const std::vector<Eigen::VectorXd> &batch_samples,
     std::shared_ptr<dynobench::Model_robot> &robot,
     std::vector<Heuristic_node> &heuristic_map, double distance_threshold,
-    double resolution);
+    double resolution, const std::string &robot_type = "",
+    std::vector<std::shared_ptr<dynobench::Model_robot>> worker_robots = {});
+
+// Copies of `robot` with the environment of the problem, one per thread
+// (worker_robots[0] is `robot`). num_threads = 0 -> all cores.
+std::vector<std::shared_ptr<dynobench::Model_robot>>
+make_worker_robots(const dynobench::Problem &problem,
+                   const std::string &robot_type,
+                   std::shared_ptr<dynobench::Model_robot> robot,
+                   size_t num_threads);
 
 void generate_heuristic_map(const dynobench::Problem &problem,
                             std::shared_ptr<dynobench::Model_robot> robot,
                             const Options_dbastar &options_dbastar,
                             std::vector<Heuristic_node> &heu_map);
 
+// Compact binary format of the heuristic map (extension .bin). `hash`
+// identifies the problem and options used to compute the map (0: unknown).
+void write_heu_map_bin(const std::vector<Heuristic_node> &heu_map,
+                       const std::string &file, uint64_t hash = 0);
+
+// Returns false if the file does not exist, does not have the size given by
+// its header, or if expected_hash != 0 and the map was computed for another
+// problem.
+bool load_heu_map_bin(const std::string &file,
+                      std::vector<Heuristic_node> &heu_map,
+                      uint64_t expected_hash = 0);
+
+// Hash of environment, robot model, start, goal and heuristic options. Returns
+// 0 if the files of the problem or of the robot are not available. The start
+// is a sample of the map, so a map is not reused for another start (it could
+// have no node within connect_radius_h of the new start).
+uint64_t heu_map_hash(const dynobench::Problem &problem,
+                      const Options_dbastar &options_dbastar);
+
+// generate_heuristic_map, with a cache in options_dbastar.heu_map_cache_dir
+// (disabled if empty).
+void generate_heuristic_map_cached(
+    const dynobench::Problem &problem,
+    std::shared_ptr<dynobench::Model_robot> robot,
+    const Options_dbastar &options_dbastar,
+    std::vector<Heuristic_node> &heu_map);
+
 } // namespace dynoplan
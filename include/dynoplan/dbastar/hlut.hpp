@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/dbastar/heuristics.hpp"
+
+namespace dynoplan {
+
+// Heuristic lookup table: cost-to-go of the primitives in free space.
+//
+// Computed offline with a Dijkstra over the graph of the primitives without
+// obstacles, with the expansions of the Expander (primitives within `radius`
+// of the canonical state, applied with the offset of the state). The states
+// are quantised: the position (the first get_translation_invariance()
+// components) with `resolution_pos` and the other components with
+// `resolution_rest`.
+//
+// There is one search for each start class (the quantised non position
+// components of the start of the primitives). The sources of a search are
+// the canonical start states of its class, and the table stores the cost of
+// the first time that each quantised state is reached.
+//
+// The cost from x to a goal g is looked up with the class of x and the state
+// of g relative to x (position of g minus position of x, other components of
+// g). States that were not reached (e.g. beyond `max_cost`) return 0.
+//
+// The value is NOT a lower bound of the cost of db-A*: the search reaches the
+// goal anywhere within delta_factor_goal * delta and each expansion can jump
+// up to delta, while the table has the cost of the first arrival at the exact
+// goal cell (and the quantised states prune other paths). Heu_hlut is
+// therefore not admissible, the solutions are not guaranteed to be optimal.
+struct Hlut {
+
+  static constexpr size_t max_dim_pos = 3;
+
+  size_t nx = 0;
+  size_t dim_pos = 0; // at most max_dim_pos
+  double resolution_pos = .1;
+  double resolution_rest = .2;
+  double max_cost = 10; // the searches stop at this cost
+  uint64_t hash = 0;    // of the primitives and the radius, see hlut_hash
+
+  std::unordered_set<uint64_t> classes;
+  std::unordered_map<uint64_t, float> cost; // key: class and relative state
+
+  // max_expands: per start class
+  void build(dynobench::Model_robot &robot,
+             ompl::NearestNeighbors<Motion *> &T_m, double radius,
+             size_t max_expands);
+
+  double lookup(const Eigen::VectorXd &x, const Eigen::VectorXd &goal) const;
+
+  void write(const std::string &file) const;
+
+  // Returns false if the file does not exist or is not a table
+  bool read(const std::string &file);
+
+  uint64_t class_key(const Eigen::VectorXd &x) const;
+  uint64_t state_key(uint64_t class_key, const Eigen::VectorXd &x,
+                     const Eigen::VectorXd &origin) const;
+};
+
+// Key of a table of the first num_motions primitives of motions_file, loaded
+// with cut_actions, and the expansion radius. It identifies the file (see
+// primitive_file_hash), not the loaded states, so that a table built offline
+// is valid for the searches that load the same primitives.
+uint64_t hlut_hash(const std::string &motions_file,
+                   const std::string &robot_type, size_t num_motions,
+                   bool cut_actions, double radius);
+
+// Table of the first `max_motions` primitives (T_m is created as in dbastar),
+// without bounds on the position. motions were loaded from motions_file with
+// cut_actions. The resolutions and max_cost are taken from `hlut`.
+void build_hlut(Hlut &hlut, std::shared_ptr<dynobench::Model_robot> robot,
+                const std::string &robot_type, std::vector<Motion> &motions,
+                const std::string &motions_file, bool cut_actions,
+                size_t max_motions, double radius, size_t max_expands);
+
+// max(HLUT(x relative to goal), lower_bound_time(x, goal)). Not admissible,
+// see Hlut.
+struct Heu_hlut : Heu_fun {
+
+  Heu_hlut(std::shared_ptr<dynobench::Model_robot> robot,
+           const Eigen::VectorXd &goal, std::shared_ptr<const Hlut> hlut)
+      : robot(robot), goal(goal), hlut(hlut) {}
+
+  std::shared_ptr<dynobench::Model_robot> robot;
+  Eigen::VectorXd goal;
+  std::shared_ptr<const Hlut> hlut;
+
+  virtual double h(const Eigen::VectorXd &x) override {
+    assert(x.size() == robot->nx);
+    return std::max(hlut->lookup(x, goal), robot->lower_bound_time(x, goal));
+  }
+
+  virtual ~Heu_hlut() override{};
+};
+
+} // namespace dynoplan
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "Eigen/Core"
+
+namespace dynoplan {
+
+// Compact node used by dbastar (open and explored states).
+// The node does not own its state: `state_eig` maps into the contiguous
+// storage of the NodePool that allocated the node (or into the buffer passed
+// to `bind`). Assigning to `state_eig` copies the values, it never
+// reallocates.
+struct SearchNode {
+  Eigen::Map<Eigen::VectorXd> state_eig{nullptr, 0};
+  const SearchNode *came_from = nullptr;
+
+  float fScore = 0;
+  float gScore = 0;
+  float hScore = 0;
+  uint32_t used_motion = 0;
+  uint32_t open_index = 0; // position (or handle) in the Open_list
+  int32_t intermediate_state =
+      -1; // checking intermediate states for reaching the goal.
+  uint16_t open_bucket = 0; // bucket in Open_bucket
+  bool is_in_open = false;
+  bool is_closed = false; // expanded (in the current iteration of anytime)
+  bool valid = true;
+  bool edge_checked = true; // false: edge from came_from not checked yet
+
+  double get_cost() const { return gScore; }
+  const Eigen::Map<Eigen::VectorXd> &getStateEig() const { return state_eig; }
+
+  // Use an external buffer of size nx as the state of this node.
+  void bind(double *data, Eigen::Index nx) {
+    new (&state_eig) Eigen::Map<Eigen::VectorXd>(data, nx);
+  }
+};
+
+static_assert(std::is_trivially_destructible<SearchNode>::value,
+              "NodePool releases nodes without calling destructors");
+
+// Arena for the nodes of one search.
+//
+// Nodes and states are allocated in blocks of `block_size`: the node records
+// are stored in one array per block and the states in a second array with
+// fixed stride `nx`. Pointers returned by `allocate` are stable until `clear`
+// or `release`. `clear` is O(1) and keeps the blocks, so that a second search
+// with the same pool does not allocate memory again.
+struct NodePool {
+
+  NodePool(size_t nx, size_t block_size = 4096)
+      : nx(nx), block_size(block_size) {
+    assert(nx > 0);
+    assert(block_size > 0);
+  }
+
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  SearchNode *allocate() {
+    const size_t b = num_nodes / block_size;
+    const size_t k = num_nodes % block_size;
+    if (b == blocks.size()) {
+      blocks.push_back(
+          Block{std::unique_ptr<SearchNode[]>(new SearchNode[block_size]),
+                std::unique_ptr<double[]>(new double[block_size * nx])});
+    }
+    SearchNode *node = &blocks[b].nodes[k];
+    new (node) SearchNode();
+    node->bind(&blocks[b].states[k * nx], nx);
+    num_nodes++;
+    return node;
+  }
+
+  SearchNode *operator[](size_t i) const {
+    assert(i < num_nodes);
+    return &blocks[i / block_size].nodes[i % block_size];
+  }
+
+  size_t size() const { return num_nodes; }
+
+  // Forget all nodes, but keep the memory for the next search.
+  void clear() { num_nodes = 0; }
+
+  // Give the memory back to the system.
+  void release() {
+    blocks.clear();
+    num_nodes = 0;
+  }
+
+  size_t memory_bytes() const {
+    return blocks.size() * block_size *
+           (sizeof(SearchNode) + nx * sizeof(double));
+  }
+
+  size_t nx;
+  size_t block_size;
+
+private:
+  struct Block {
+    std::unique_ptr<SearchNode[]> nodes;
+    std::unique_ptr<double[]> states;
+  };
+  std::vector<Block> blocks;
+  size_t num_nodes = 0;
+};
+
+} // namespace dynoplan
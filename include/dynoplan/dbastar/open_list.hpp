@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynoplan/dbastar/node_pool.hpp"
+#include <boost/heap/d_ary_heap.hpp>
+
+namespace dynoplan {
+
+struct compareSearchNode {
+  bool operator()(const SearchNode *a, const SearchNode *b) const;
+};
+
+typedef typename boost::heap::d_ary_heap<
+    SearchNode *, boost::heap::arity<2>,
+    boost::heap::compare<compareSearchNode>, boost::heap::mutable_<true>>
+    open_search_t;
+
+// Open list of dbastar. All the implementations pop the node with the lowest
+// fScore, and with the highest gScore on ties (same order as open_search_t).
+//
+// `increase` restores the order after the fScore (or gScore) of a node in the
+// list has improved. The name follows boost::heap: the priority increases.
+struct Open_list {
+  virtual ~Open_list() = default;
+  virtual void push(SearchNode *node) = 0;
+  virtual SearchNode *top() const = 0;
+  virtual void pop() = 0;
+  virtual void increase(SearchNode *node) = 0;
+  virtual size_t size() const = 0;
+  virtual void clear() = 0;
+  // Append the nodes in the list (in any order)
+  virtual void list(std::vector<SearchNode *> &nodes) const = 0;
+  bool empty() const { return size() == 0; }
+};
+
+enum class Open_list_type { boost_heap = 0, heap4 = 1, heap8 = 2, bucket = 3 };
+
+// Mutable binary heap of boost (default). The handles are stored in the list,
+// SearchNode::open_index is the index of the handle of the node.
+struct Open_boost : Open_list {
+  void push(SearchNode *node) override {
+    node->open_index = handles.size();
+    handles.push_back(heap.push(node));
+  }
+  SearchNode *top() const override { return heap.top(); }
+  void pop() override { heap.pop(); }
+  void increase(SearchNode *node) override {
+    assert(node->open_index < handles.size());
+    heap.increase(handles[node->open_index]);
+  }
+  size_t size() const override { return heap.size(); }
+  void clear() override {
+    heap.clear();
+    handles.clear();
+  }
+  void list(std::vector<SearchNode *> &nodes) const override {
+    nodes.insert(nodes.end(), heap.begin(), heap.end());
+  }
+
+  open_search_t heap;
+  std::vector<open_search_t::handle_type> handles;
+};
+
+template <typename T, size_t alignment> struct Aligned_allocator {
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = Aligned_allocator<U, alignment>;
+  };
+  Aligned_allocator() = default;
+  template <typename U>
+  Aligned_allocator(const Aligned_allocator<U, alignment> &) {}
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(alignment)));
+  }
+  void deallocate(T *p, size_t) {
+    ::operator delete(p, std::align_val_t(alignment));
+  }
+  bool operator==(const Aligned_allocator &) const { return true; }
+  bool operator!=(const Aligned_allocator &) const { return false; }
+};
+
+// Indexed d-ary heap. The keys are stored next to the node pointers, so that
+// comparisons do not touch the nodes, and the position of a node is kept in
+// SearchNode::open_index for `increase`.
+//
+// Entry i is stored at data[i + arity - 1]: the children of an entry start at
+// a multiple of arity, i.e. they share one cache line for arity 4 (two for
+// arity 8).
+template <size_t arity> struct Open_dary_heap : Open_list {
+
+  struct alignas(16) Entry {
+    float f;
+    float g;
+    SearchNode *node;
+  };
+  static_assert(sizeof(Entry) == 16, "");
+  static constexpr size_t pad = arity - 1;
+
+  Open_dary_heap() { data.resize(pad); }
+
+  void push(SearchNode *node) override {
+    data.push_back(Entry{node->fScore, node->gScore, node});
+    sift_up(num++);
+  }
+
+  SearchNode *top() const override {
+    assert(num);
+    return at(0).node;
+  }
+
+  void pop() override {
+    assert(num);
+    erase_at(0);
+  }
+
+  void increase(SearchNode *node) override {
+    size_t i = node->open_index;
+    assert(i < num && at(i).node == node);
+    at(i).f = node->fScore;
+    at(i).g = node->gScore;
+    sift_up(i);
+  }
+
+  // Remove a node that is in the heap
+  void erase(SearchNode *node) {
+    assert(node->open_index < num && at(node->open_index).node == node);
+    erase_at(node->open_index);
+  }
+
+  size_t size() const override { return num; }
+
+  void clear() override {
+    data.resize(pad);
+    num = 0;
+  }
+
+  void list(std::vector<SearchNode *> &nodes) const override {
+    for (size_t i = 0; i < num; i++) {
+      nodes.push_back(at(i).node);
+    }
+  }
+
+private:
+  static bool better(const Entry &a, const Entry &b) {
+    return a.f < b.f || (a.f == b.f && a.g > b.g);
+  }
+
+  Entry &at(size_t i) { return data[i + pad]; }
+  const Entry &at(size_t i) const { return data[i + pad]; }
+
+  void place(size_t i, const Entry &e) {
+    at(i) = e;
+    e.node->open_index = i;
+  }
+
+  void sift_up(size_t i) {
+    Entry e = at(i);
+    while (i > 0) {
+      size_t parent = (i - 1) / arity;
+      if (!better(e, at(parent))) {
+        break;
+      }
+      place(i, at(parent));
+      i = parent;
+    }
+    place(i, e);
+  }
+
+  void sift_down(size_t i) {
+    Entry e = at(i);
+    while (true) {
+      size_t first = arity * i + 1;
+      if (first >= num) {
+        break;
+      }
+      size_t last = std::min(first + arity, num);
+      size_t best = first;
+      for (size_t c = first + 1; c < last; c++) {
+        if (better(at(c), at(best))) {
+          best = c;
+        }
+      }
+      if (!better(at(best), e)) {
+        break;
+      }
+      place(i, at(best));
+      i = best;
+    }
+    place(i, e);
+  }
+
+  void erase_at(size_t i) {
+    Entry last = at(num - 1);
+    data.pop_back();
+    num--;
+    if (i == num) {
+      return;
+    }
+    place(i, last);
+    if (i > 0 && better(last, at((i - 1) / arity))) {
+      sift_up(i);
+    } else {
+      sift_down(i);
+    }
+  }
+
+  std::vector<Entry, Aligned_allocator<Entry, 64>> data;
+  size_t num = 0;
+};
+
+// Two-level bucket queue. The first level quantizes the fScore in buckets of
+// width `bucket_width`, the second level is a binary heap per bucket, so the
+// order is exact. When the fScore of the popped nodes grows (mostly)
+// monotonically, as in A*, the first non-empty bucket is found in amortized
+// O(1) and the heaps stay small. The bucket of a node is kept in
+// SearchNode::open_bucket.
+struct Open_bucket : Open_list {
+
+  explicit Open_bucket(double bucket_width, size_t max_buckets = 1 << 16)
+      : bucket_width(bucket_width), max_buckets(max_buckets) {
+    CHECK(bucket_width > 0, "bucket_width should be positive");
+    CHECK(max_buckets > 0 && max_buckets <= (1 << 16),
+          "the bucket is stored in 16 bits");
+  }
+
+  void push(SearchNode *node) override {
+    size_t b = bucket_of(node);
+    if (b >= buckets.size()) {
+      buckets.resize(b + 1);
+    }
+    buckets[b].push(node);
+    node->open_bucket = b;
+    first = std::min(first, b);
+    num++;
+  }
+
+  SearchNode *top() const override {
+    assert(num);
+    return buckets[first_non_empty()].top();
+  }
+
+  void pop() override {
+    assert(num);
+    buckets[first_non_empty()].pop();
+    num--;
+  }
+
+  void increase(SearchNode *node) override {
+    size_t b = bucket_of(node);
+    if (b == node->open_bucket) {
+      buckets[b].increase(node);
+    } else {
+      buckets[node->open_bucket].erase(node);
+      buckets[b].push(node);
+      node->open_bucket = b;
+      first = std::min(first, b);
+    }
+  }
+
+  size_t size() const override { return num; }
+
+  void clear() override {
+    for (auto &bucket : buckets) {
+      bucket.clear();
+    }
+    first = 0;
+    num = 0;
+  }
+
+  void list(std::vector<SearchNode *> &nodes) const override {
+    for (auto &bucket : buckets) {
+      bucket.list(nodes);
+    }
+  }
+
+  double bucket_width;
+  size_t max_buckets;
+
+private:
+  size_t bucket_of(const SearchNode *node) const {
+    double b = node->fScore / bucket_width;
+    if (!(b > 0)) {
+      return 0;
+    }
+    return b >= max_buckets - 1 ? max_buckets - 1 : static_cast<size_t>(b);
+  }
+
+  size_t first_non_empty() const {
+    while (buckets[first].empty()) {
+      first++;
+    }
+    return first;
+  }
+
+  std::vector<Open_dary_heap<2>> buckets;
+  mutable size_t first = 0; // buckets before first are empty
+  size_t num = 0;
+};
+
+inline std::unique_ptr<Open_list> make_open_list(int type,
+                                                 double bucket_width) {
+  switch (static_cast<Open_list_type>(type)) {
+  case Open_list_type::boost_heap:
+    return std::make_unique<Open_boost>();
+  case Open_list_type::heap4:
+    return std::make_unique<Open_dary_heap<4>>();
+  case Open_list_type::heap8:
+    return std::make_unique<Open_dary_heap<8>>();
+  case Open_list_type::bucket:
+    return std::make_unique<Open_bucket>(bucket_width);
+  default:
+    ERROR_WITH_INFO("unknown open list type: " + std::to_string(type));
+  }
+}
+
+} // namespace dynoplan
@@ -1,15 +1,21 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "dynobench/general_utils.hpp"
 #include <boost/program_options.hpp>
 
+namespace dynobench {
+struct Trajectory; // forward declaration
+}
+
 namespace dynoplan {
 
 struct Heuristic_node; // forward declaration
 struct Motion;         // forward declaration
+struct Output_sink;    // forward declaration
 
 namespace po = boost::program_options;
 
@@ -28,12 +34,17 @@ struct Time_benchmark {
   double time_nearestNode_add = 0.0;
   double time_nearestNode_search = 0.0;
   double time_collisions = 0.0;
+  double time_check_parallel = 0.0;
   double prepare_time = 0.0;
   double total_time = 0.;
   int expands = 0;
   int num_nn_motions = 0;
   int num_nn_states = 0;
   int num_col_motions = 0;
+  int num_lazy_invalid = 0;
+  int num_successor_table = 0;
+  int num_heu_cache_hits = 0;
+  int num_heu_cache_misses = 0;
   int motions_tree_size = 0;
   int states_tree_size = 0;
   double time_search = 0;
@@ -56,12 +67,17 @@ struct Time_benchmark {
     out << be << STR(time_nearestNode_add, af) << std::endl;
     out << be << STR(time_nearestNode_search, af) << std::endl;
     out << be << STR(time_collisions, af) << std::endl;
+    out << be << STR(time_check_parallel, af) << std::endl;
     out << be << STR(prepare_time, af) << std::endl;
     out << be << STR(total_time, af) << std::endl;
     out << be << STR(expands, af) << std::endl;
     out << be << STR(num_nn_motions, af) << std::endl;
     out << be << STR(num_nn_states, af) << std::endl;
     out << be << STR(num_col_motions, af) << std::endl;
+    out << be << STR(num_lazy_invalid, af) << std::endl;
+    out << be << STR(num_successor_table, af) << std::endl;
+    out << be << STR(num_heu_cache_hits, af) << std::endl;
+    out << be << STR(num_heu_cache_misses, af) << std::endl;
     out << be << STR(motions_tree_size, af) << std::endl;
     out << be << STR(states_tree_size, af) << std::endl;
     out << be << STR(time_hfun, af) << std::endl;
@@ -82,12 +98,17 @@ struct Time_benchmark {
     out.insert(NAME_AND_STRING(time_nearestNode_add));
     out.insert(NAME_AND_STRING(time_nearestNode_search));
     out.insert(NAME_AND_STRING(time_collisions));
+    out.insert(NAME_AND_STRING(time_check_parallel));
     out.insert(NAME_AND_STRING(prepare_time));
     out.insert(NAME_AND_STRING(total_time));
     out.insert(NAME_AND_STRING(expands));
     out.insert(NAME_AND_STRING(num_nn_motions));
     out.insert(NAME_AND_STRING(num_nn_states));
     out.insert(NAME_AND_STRING(num_col_motions));
+    out.insert(NAME_AND_STRING(num_lazy_invalid));
+    out.insert(NAME_AND_STRING(num_successor_table));
+    out.insert(NAME_AND_STRING(num_heu_cache_hits));
+    out.insert(NAME_AND_STRING(num_heu_cache_misses));
     out.insert(NAME_AND_STRING(motions_tree_size));
     out.insert(NAME_AND_STRING(states_tree_size));
     out.insert(NAME_AND_STRING(time_hfun));
@@ -115,7 +136,7 @@ struct Options_dbastar {
       "/tmp/dynoplan/out_db.yaml"; // output file to write some results
   float maxCost =
       std::numeric_limits<float>::infinity(); // Cost bound during search
-  int heuristic = 0;                          // which heuristic to use
+  int heuristic = 0; // 0: euclidean, 1: roadmap, 2: grid, 3: hlut, -1: blind
   size_t max_motions = 1e4;   //  Max number of motions to use in the search
   double heu_resolution = .5; // used only for ROADMAP heuristic
   double delta_factor_goal =
@@ -135,12 +156,42 @@ struct Options_dbastar {
   std::vector<Heuristic_node> *heu_map_ptr =
       nullptr;                   // Pointer to a loaded heuristic map
   std::string heu_map_file;      // File that contains the heuristic map
+  std::string hlut_file; // Heuristic lookup table (see main_primitives, hlut)
+  std::string heu_map_cache_dir =
+      ""; // Cache of the heuristic maps, by problem ("": no cache)
   bool add_after_expand = false; // this does not improve cost of closed
 
   double search_timelimit = 1e4;    // in ms
   double heu_connection_radius = 1; // connection radius for ROADMAP heuristic
-  bool use_nigh_nn = true;          // use nigh for nearest neighbor.
+  double heu_grid_resolution = .1;  // resolution of the GRID heuristic
+  // Cache of the ROADMAP heuristic, by quantised state (0: no cache). The
+  // cached value is the one of another state of the cell (not admissible).
+  double heu_cache_resolution = 0;
+  size_t heu_cache_size = 1 << 16; // Entries of the heuristic cache
+  bool use_nigh_nn = true;          // nigh kd-tree (true) or hash grid (false)
   bool check_cols = true;
+  size_t num_threads_check =
+      1; // Threads to check the primitives of one expansion (1: sequential)
+  size_t num_threads = 0; // Threads in dbastar_parallel (0: all cores)
+  size_t num_threads_heu =
+      1; // Threads to build the ROADMAP and GRID heuristics (0: all cores)
+  int output_mode = 0; // 0: no files, 1: write yaml files to /tmp/dynoplan
+  Output_sink *output_sink = nullptr; // If set, overrides output_mode
+  int open_list = 0; // 0: binary heap (boost), 1: 4-ary heap, 2: 8-ary heap,
+                     // 3: bucket queue
+  double open_bucket_width = .1; // fScore width of a bucket (open_list = 3)
+  bool lazy_edges = false; // Check the edge of a node when it is popped
+  bool successor_table =
+      false; // Precompute the primitives applicable after each primitive
+  std::string successor_table_dir =
+      ""; // Cache of the successor tables ("": no cache)
+  bool anytime = false; // ARA*: inflated heuristic, improve the solution
+  float anytime_weight = 3; // Initial weight of the heuristic (anytime)
+  float anytime_weight_step =
+      .5; // Decrease of the weight after each solution (anytime)
+  std::function<void(const dynobench::Trajectory &, double)>
+      anytime_callback; // Called with each improved solution and its
+                        // suboptimality bound (anytime)
 
   void add_options(po::options_description &desc);
 
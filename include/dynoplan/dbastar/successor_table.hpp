@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include <ompl/datastructures/NearestNeighbors.h>
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+
+namespace dynoplan {
+
+// Primitives applicable after each primitive.
+//
+// When a node is reached with the primitive i, its canonical state is the
+// canonical last state of i (the offset is removed), so the primitives within
+// the expansion radius of the node can be computed once per primitive set and
+// radius. Row i stores the canonical last state of i and the result of the
+// query to T_m, in the same order.
+//
+// `find` only answers if the canonical state of the node is exactly the one
+// of the row. Otherwise (start node, intermediate states, rewired nodes,
+// robots whose primitives are rolled out with the dynamics) the expander
+// falls back to T_m.
+struct Successor_table {
+
+  size_t nx = 0;
+  double radius = 0;
+  uint64_t hash = 0; // of the primitives and the radius, see motions_hash
+
+  // rows are indexed by Motion::idx (empty rows for motions not in T_m)
+  std::vector<Eigen::VectorXd> canonical_states;
+  std::vector<uint32_t> begin; // row i is [begin[i], begin[i+1])
+  std::vector<uint32_t> successors_idx;
+  std::vector<Motion *> successors;
+
+  size_t num_rows() const { return canonical_states.size(); }
+
+  // Compute the table with the same queries as the Expander.
+  void build(dynobench::Model_robot &robot,
+             ompl::NearestNeighbors<Motion *> &T_m, double radius);
+
+  // Successors of a node reached with the motion `motion_idx` (canonical
+  // state `canonical_state`). Returns false if the table does not apply.
+  bool find(size_t motion_idx, const Eigen::VectorXd &canonical_state,
+            std::vector<Motion *> &out) const {
+    if (motion_idx + 1 >= begin.size() ||
+        begin[motion_idx] == begin[motion_idx + 1] ||
+        canonical_states[motion_idx] != canonical_state) {
+      return false;
+    }
+    out.assign(successors.begin() + begin[motion_idx],
+               successors.begin() + begin[motion_idx + 1]);
+    return true;
+  }
+
+  void write(const std::string &file) const;
+
+  // Returns false if the file does not exist or was computed for other
+  // primitives, radius or robot.
+  bool read(const std::string &file, ompl::NearestNeighbors<Motion *> &T_m,
+            uint64_t expected_hash);
+};
+
+// Hash of the primitives in T_m, the robot and the radius: key of the table
+// in the cache.
+uint64_t motions_hash(const std::string &robot_type,
+                      ompl::NearestNeighbors<Motion *> &T_m, double radius);
+
+// Load the table from `cache_dir` if possible, otherwise compute it (and
+// store it in `cache_dir`). An empty `cache_dir` disables the cache.
+std::unique_ptr<Successor_table>
+make_successor_table(dynobench::Model_robot &robot,
+                     const std::string &robot_type,
+                     ompl::NearestNeighbors<Motion *> &T_m, double radius,
+                     const std::string &cache_dir);
+
+} // namespace dynoplan
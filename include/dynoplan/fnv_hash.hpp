@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "Eigen/Core"
+
+namespace dynoplan {
+
+// FNV-1a hash, used as the key of the caches on disk (e.g. successor tables).
+// It is stable across runs and platforms with the same endianness.
+struct Fnv_hash {
+  uint64_t value = 14695981039346656037ull;
+
+  void add(const void *data, size_t size) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+      value ^= p[i];
+      value *= 1099511628211ull;
+    }
+  }
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+  void add(T x) {
+    add(&x, sizeof(T));
+  }
+
+  void add(const std::string &s) { add(s.data(), s.size()); }
+
+  void add(const Eigen::Ref<const Eigen::VectorXd> &x) {
+    add(x.data(), x.size() * sizeof(double));
+  }
+};
+
+} // namespace dynoplan
@@ -20,6 +20,15 @@ struct Options_primitives {
   size_t num_threads = 1;
   bool use_random_displacemenet = false;
   std::string models_base_path = "";
+  // heuristic lookup table (mode hlut), of the first max_num_primitives
+  // primitives: as max_motions and cut_actions of the searches that use it
+  double hlut_delta = .3;           // expansions as dbastar: radius alpha*delta
+  double hlut_alpha = .5;
+  double hlut_resolution_pos = .1;  // quantisation of the position
+  double hlut_resolution_rest = .2; // quantisation of the other components
+  double hlut_max_cost = 10;
+  size_t hlut_max_expands = 1e5; // per start class
+  bool hlut_cut_actions = false;
 
   void print(std::ostream &out, const std::string &be = "",
              const std::string &af = ": ") {
@@ -35,6 +44,13 @@ struct Options_primitives {
     STRY(max_length_cut, out, be, af);
     STRY(max_splits, out, be, af);
     STRY(ref_time_steps, out, be, af);
+    STRY(hlut_delta, out, be, af);
+    STRY(hlut_alpha, out, be, af);
+    STRY(hlut_resolution_pos, out, be, af);
+    STRY(hlut_resolution_rest, out, be, af);
+    STRY(hlut_max_cost, out, be, af);
+    STRY(hlut_max_expands, out, be, af);
+    STRY(hlut_cut_actions, out, be, af);
   };
 
   void add_options(po::options_description &desc) {
@@ -50,6 +66,13 @@ struct Options_primitives {
     set_from_boostop(desc, VAR_WITH_NAME(max_length_cut));
     set_from_boostop(desc, VAR_WITH_NAME(max_splits));
     set_from_boostop(desc, VAR_WITH_NAME(ref_time_steps));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_delta));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_alpha));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_resolution_pos));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_resolution_rest));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_max_cost));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_max_expands));
+    set_from_boostop(desc, VAR_WITH_NAME(hlut_cut_actions));
   }
 };
 
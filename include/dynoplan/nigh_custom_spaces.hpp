@@ -1,7 +1,12 @@
 #pragma once
 
 #include <cassert>
+#include <cmath>
 #include <cstddef> // missing std::size_t include in nigh
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_map>
 
 #include <nigh/impl/kdtree_median/strategy.hpp>
 #include <nigh/kdtree_batch.hpp>
@@ -16,6 +21,7 @@
 #include <ompl/datastructures/NearestNeighbors.h>
 
 #include "dynobench/general_utils.hpp"
+#include "dynoplan/nn_state_query.hpp"
 #include "dynoplan/ompl/robots.h"
 
 namespace dynoplan {
@@ -151,7 +157,8 @@ template <typename _T> struct NN_quim {
 };
 
 template <typename _T, typename Space>
-struct NearestNeighborsNigh : public ompl::NearestNeighbors<_T> {
+struct NearestNeighborsNigh : public ompl::NearestNeighbors<_T>,
+                              public NN_state_query<_T> {
 
   using Key = typename Space::Type;
 
@@ -166,6 +173,7 @@ struct NearestNeighborsNigh : public ompl::NearestNeighbors<_T> {
 
   // unc::robotics::nigh::KDTreeBatch<>>;
   std::function<Key(_T const &)> data_to_key;
+  std::function<Key(const Eigen::VectorXd &)> state_to_key; // optional
   std::vector<_T> __data{};
   std::vector<Key> __keys{};
   std::vector<size_t> __idxs{};
@@ -213,7 +221,19 @@ struct NearestNeighborsNigh : public ompl::NearestNeighbors<_T> {
   bool remove(const _T &) override { ERROR_WITH_INFO(AT); }
 
   virtual _T nearest(const _T &data) const override {
-    Key key = data_to_key.operator()(data);
+    return nearest_key(data_to_key.operator()(data));
+  }
+
+  virtual bool has_state_query() const override {
+    return static_cast<bool>(state_to_key);
+  }
+
+  virtual _T nearest_state(const Eigen::VectorXd &x) const override {
+    assert(state_to_key);
+    return nearest_key(state_to_key(x));
+  }
+
+  _T nearest_key(const Key &key) const {
     std::optional<std::pair<size_t, double>> pt = tree.nearest(key);
     if (pt) {
       return __data.at(pt.value().first);
@@ -251,6 +271,242 @@ struct NearestNeighborsNigh : public ompl::NearestNeighbors<_T> {
   virtual void list(std::vector<_T> &data) const override { data = __data; }
 };
 
+// Nigh tree whose key only depends on the state `fun(m)`, with queries by
+// state (NN_state_query)
+template <typename _T, typename Space, typename State_to_key>
+NearestNeighborsNigh<_T, Space> *
+make_nigh(const Space &space, std::function<const Eigen::VectorXd(_T)> fun,
+          State_to_key state_to_key) {
+  auto out = new NearestNeighborsNigh<_T, Space>(
+      space, [fun, state_to_key](_T const &m) { return state_to_key(fun(m)); });
+  out->state_to_key = state_to_key;
+  return out;
+}
+
+// Coordinate of the state used to index the cells of NearestNeighborsGrid.
+// `weight` is the distance weight of the component that contains the
+// coordinate, so that a neighbour at distance r differs at most by r / weight
+// in this coordinate. `periodic` is for angles in [-pi, pi].
+struct Grid_dim {
+  size_t idx;
+  double weight;
+  bool periodic = false;
+};
+
+// Uniform hash grid for radius queries with a (mostly) fixed radius, as the
+// novelty check of dbastar and tdbastar. The cells are indexed with a few
+// coordinates of the state (position, angles, velocities), with width
+// 2 * radius / weight, so that a query of radius `radius` visits at most
+// 2^dims.size() cells. The candidates in the cells are filtered with the
+// exact distance, so that the results are the same as with nigh (for any
+// radius). Insertion is O(1) and there is no rebalancing.
+//
+// nearest and nearestK are linear in the number of points: they are only used
+// once per search (closest node to the goal) or with the primitives.
+template <typename _T>
+struct NearestNeighborsGrid : public ompl::NearestNeighbors<_T>,
+                              public NN_state_query<_T> {
+
+  using Distance =
+      std::function<double(const Eigen::VectorXd &, const Eigen::VectorXd &)>;
+
+  std::function<Eigen::VectorXd(_T const &)> data_to_state;
+  Distance distance;
+  std::vector<Grid_dim> dims;
+  std::vector<double> cell_width;
+  std::vector<long> num_cells; // along periodic dims, 0 otherwise
+
+  std::vector<_T> __data{};
+  std::vector<Eigen::VectorXd> __states{};
+  std::unordered_map<uint64_t, std::vector<size_t>> cells;
+
+  NearestNeighborsGrid(std::function<Eigen::VectorXd(_T const &)> data_to_state,
+                       const Distance &distance,
+                       const std::vector<Grid_dim> &dims, double radius)
+      : data_to_state(data_to_state), distance(distance), dims(dims) {
+    CHECK(radius > 0, "radius of the grid should be positive");
+    CHECK(dims.size() && dims.size() <= 8, "use between 1 and 8 dims");
+    for (auto &d : dims) {
+      CHECK(d.weight > 0, AT);
+      double width = 2. * radius / d.weight;
+      long n = 0;
+      if (d.periodic) {
+        n = std::max(1l, static_cast<long>(2. * M_PI / width));
+        width = 2. * M_PI / n;
+      }
+      cell_width.push_back(width);
+      num_cells.push_back(n);
+    }
+  }
+
+  virtual void add(const _T &data) override {
+    __data.push_back(data);
+    __states.push_back(data_to_state(data));
+    const Eigen::VectorXd &x = __states.back();
+    long cell[8];
+    for (size_t i = 0; i < dims.size(); i++) {
+      cell[i] = cell_index(i, x(dims[i].idx));
+    }
+    cells[hash_cell(cell)].push_back(__data.size() - 1);
+  }
+
+  virtual void add(const std::vector<_T> &data) override {
+    for (auto &d : data) {
+      add(d);
+    }
+  }
+
+  virtual bool reportsSortedResults() const override { return false; };
+
+  virtual void clear() override {
+    __data.clear();
+    __states.clear();
+    cells.clear();
+  };
+
+  bool remove(const _T &) override { ERROR_WITH_INFO(AT); }
+
+  virtual _T nearest(const _T &data) const override {
+    return nearest_state(data_to_state(data));
+  }
+
+  virtual bool has_state_query() const override { return true; }
+
+  virtual _T nearest_state(const Eigen::VectorXd &x) const override {
+    CHECK(__data.size(), AT);
+    size_t best = 0;
+    double best_d = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < __states.size(); i++) {
+      double d = distance(x, __states[i]);
+      if (d < best_d) {
+        best_d = d;
+        best = i;
+      }
+    }
+    return __data[best];
+  }
+
+  virtual void nearestK(const _T &data, std::size_t k,
+                        std::vector<_T> &nbh) const override {
+    Eigen::VectorXd x = data_to_state(data);
+    std::vector<std::pair<double, size_t>> __nbh(__states.size());
+    for (size_t i = 0; i < __states.size(); i++) {
+      __nbh[i] = {distance(x, __states[i]), i};
+    }
+    k = std::min(k, __nbh.size());
+    std::partial_sort(__nbh.begin(), __nbh.begin() + k, __nbh.end());
+    nbh.resize(k);
+    for (size_t i = 0; i < k; i++) {
+      nbh[i] = __data[__nbh[i].second];
+    }
+  }
+
+  virtual void nearestR(const _T &data, double radius,
+                        std::vector<_T> &nbh) const override {
+    nbh.clear();
+    Eigen::VectorXd x = data_to_state(data);
+    const size_t n = dims.size();
+
+    // range of cells along each dim
+    long lo[8], hi[8], cell[8];
+    for (size_t i = 0; i < n; i++) {
+      double r = radius / dims[i].weight;
+      double xi = x(dims[i].idx);
+      lo[i] = static_cast<long>(std::floor((xi - r) / cell_width[i]));
+      hi[i] = static_cast<long>(std::floor((xi + r) / cell_width[i]));
+      if (num_cells[i] && hi[i] - lo[i] + 1 >= num_cells[i]) {
+        lo[i] = 0;
+        hi[i] = num_cells[i] - 1;
+      }
+      cell[i] = lo[i];
+    }
+
+    // radius much larger than the cells: a linear scan is faster
+    double num_visits = 1;
+    for (size_t i = 0; i < n; i++) {
+      num_visits *= hi[i] - lo[i] + 1;
+    }
+    bool linear_scan = num_visits > __data.size();
+
+    std::vector<std::pair<double, size_t>> __nbh;
+    for (size_t j = 0; linear_scan && j < __states.size(); j++) {
+      double d = distance(x, __states[j]);
+      if (d <= radius) {
+        __nbh.push_back({d, j});
+      }
+    }
+
+    // different cells can have the same hash (or the same index, when
+    // wrapping the angles): visit each bucket once
+    std::vector<uint64_t> visited;
+    while (!linear_scan) {
+      long wrapped[8];
+      for (size_t i = 0; i < n; i++) {
+        wrapped[i] = wrap(i, cell[i]);
+      }
+      uint64_t h = hash_cell(wrapped);
+      if (std::find(visited.begin(), visited.end(), h) == visited.end()) {
+        visited.push_back(h);
+        auto it = cells.find(h);
+        if (it != cells.end()) {
+          for (size_t j : it->second) {
+            double d = distance(x, __states[j]);
+            if (d <= radius) {
+              __nbh.push_back({d, j});
+            }
+          }
+        }
+      }
+      // next cell
+      size_t i = 0;
+      for (; i < n; i++) {
+        if (cell[i] < hi[i]) {
+          cell[i]++;
+          break;
+        }
+        cell[i] = lo[i];
+      }
+      if (i == n) {
+        break;
+      }
+    }
+
+    // sorted by distance, as nigh
+    std::sort(__nbh.begin(), __nbh.end());
+    nbh.resize(__nbh.size());
+    for (size_t i = 0; i < __nbh.size(); i++) {
+      nbh[i] = __data[__nbh[i].second];
+    }
+  }
+
+  virtual std::size_t size() const override { return __data.size(); }
+
+  virtual void list(std::vector<_T> &data) const override { data = __data; }
+
+private:
+  long cell_index(size_t i, double xi) const {
+    return wrap(i, static_cast<long>(std::floor(xi / cell_width[i])));
+  }
+
+  long wrap(size_t i, long c) const {
+    if (!num_cells[i]) {
+      return c;
+    }
+    c %= num_cells[i];
+    return c < 0 ? c + num_cells[i] : c;
+  }
+
+  uint64_t hash_cell(const long *cell) const {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < dims.size(); i++) {
+      h ^= static_cast<uint64_t>(cell[i]);
+      h *= 1099511628211ull;
+      h ^= h >> 29;
+    }
+    return h;
+  }
+};
+
 template <typename _T>
 ompl::NearestNeighbors<_T> *nigh_factory(
     const std::string &name, const std::shared_ptr<RobotOmpl> &robot,
@@ -403,17 +659,15 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
   if (startsWith(name, "unicycle1")) {
 
     if (cost_scale < 0) {
-      auto data_to_key = [robot, fun](_T const &m) {
-        // DYNO_CHECK_EQ(fun(m).size(), 3, ""); //
-        // assert(fun(m).size() == 3);
-        Eigen::Vector3d __x = fun(m);
+      auto state_to_key = [](const Eigen::VectorXd &__s) {
+        Eigen::Vector3d __x = __s;
         return std::tuple(Eigen::Vector2d(__x.head(2)), __x(2));
       };
 
       DYNO_CHECK_EQ(w.size(), 2, AT);
       __Space space(double(w(0)), double(w(1)));
 
-      out = new NearestNeighborsNigh<_T, __Space>(space, data_to_key);
+      out = make_nigh<_T, __Space>(space, fun, state_to_key);
     } else {
 
       std::cout << "Warning: State space with cost!" << std::endl;
@@ -433,10 +687,10 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
   } else if (startsWith(name, "unicycle2")) {
 
     if (cost_scale < 0) {
-      auto data_to_key = [robot, fun](_T const &m) {
+      auto state_to_key = [](const Eigen::VectorXd &__s) {
         using Vector5d = Eigen::Matrix<double, 5, 1>;
         using Vector1d = Eigen::Matrix<double, 1, 1>;
-        Vector5d __x = fun(m);
+        Vector5d __x = __s;
         return std::tuple(Eigen::Vector2d(__x.head(2)), __x(2),
                           Vector1d(__x(3)), Vector1d(__x(4)));
       };
@@ -445,7 +699,7 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
 
       DYNO_CHECK_EQ(w.size(), 4, AT);
       __SpaceUni2 space(w(0), w(1), w(2), w(3));
-      out = new NearestNeighborsNigh<_T, __SpaceUni2>(space, data_to_key);
+      out = make_nigh<_T, __SpaceUni2>(space, fun, state_to_key);
     } else {
 
       auto data_to_key = [robot, fun](_T const &m) {
@@ -463,21 +717,21 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
           new NearestNeighborsNigh<_T, __SpaceUni2WithCost>(space, data_to_key);
     }
   } else if (startsWith(name, "integrator2_2d")) {
-    auto data_to_key = [robot, fun](_T const &m) {
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
       using Vector4d = Eigen::Matrix<double, 4, 1>;
-      Vector4d __x = fun(m);
+      Vector4d __x = __s;
       return std::tuple(Eigen::Vector2d(__x.head(2)),
                         Eigen::Vector2d(__x(2), __x(3)));
     };
 
     DYNO_CHECK_EQ(w.size(), 2, AT);
     __SpaceIntegrator2 space(w(0), w(1));
-    out = new NearestNeighborsNigh<_T, __SpaceIntegrator2>(space, data_to_key);
+    out = make_nigh<_T, __SpaceIntegrator2>(space, fun, state_to_key);
 
   } else if (startsWith(name, "integrator2_3d")) {
-    auto data_to_key = [robot, fun](_T const &m) {
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
       using Vector6d = Eigen::Matrix<double, 6, 1>;
-      Vector6d __x = fun(m);
+      Vector6d __x = __s;
       // return std::tuple(Eigen::Vector3d(__x.head(3)),Eigen::Vector3d(__x(3),
       // __x(4), __x(5)));
       return std::tuple(Eigen::Vector3d(__x(0), __x(1), __x(2)),
@@ -486,15 +740,14 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
 
     DYNO_CHECK_EQ(w.size(), 2, AT);
     __SpaceIntegrator2_3d space(w(0), w(1));
-    out =
-        new NearestNeighborsNigh<_T, __SpaceIntegrator2_3d>(space, data_to_key);
+    out = make_nigh<_T, __SpaceIntegrator2_3d>(space, fun, state_to_key);
 
   } else if (startsWith(name, "quad2dpole")) {
 
-    auto data_to_key = [robot, fun](_T const &m) {
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
       using Vector8d = Eigen::Matrix<double, 8, 1>;
       using Vector1d = Eigen::Matrix<double, 1, 1>;
-      Vector8d __x = fun(m);
+      Vector8d __x = __s;
       return std::tuple(Eigen::Vector2d(__x.head(2)), __x(2), __x(3),
                         Eigen::Vector2d(__x(4), __x(5)), V1d(__x(6)),
                         V1d(__x(7)));
@@ -504,15 +757,15 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
     DYNO_CHECK_EQ(w.size(), 6, AT);
     Space space(w(0), w(1), w(2), w(3), w(4), w(5));
 
-    out = new NearestNeighborsNigh<_T, Space>(space, data_to_key);
+    out = make_nigh<_T, Space>(space, fun, state_to_key);
 
   }
 
   else if (startsWith(name, "quad2d")) {
 
-    auto data_to_key = [robot, fun](_T const &m) {
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
       using Vector6d = Eigen::Matrix<double, 6, 1>;
-      Vector6d __x = fun(m);
+      Vector6d __x = __s;
       return std::tuple(Eigen::Vector2d(__x.head(2)), __x(2),
                         Eigen::Vector2d(__x(3), __x(4)), V1d(__x(5)));
     };
@@ -520,13 +773,13 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
     DYNO_CHECK_EQ(w.size(), 4, AT);
     __SpaceQuad2d space(w(0), w(1), w(2), w(3));
 
-    out = new NearestNeighborsNigh<_T, __SpaceQuad2d>(space, data_to_key);
+    out = make_nigh<_T, __SpaceQuad2d>(space, fun, state_to_key);
 
     // continue here!!
   } else if (startsWith(name, "acrobot")) {
 
-    auto data_to_key = [robot, fun](_T const &m) {
-      Eigen::Vector4d __x = fun(m);
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
+      Eigen::Vector4d __x = __s;
       return std::tuple(__x(0), __x(1), Eigen::Vector2d(__x(2), __x(3)));
     };
 
@@ -535,14 +788,13 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
     DYNO_CHECK_EQ(w.size(), 3, AT);
     __SpaceAcrobot space(w(0), w(1), w(2));
 
-    out = new NearestNeighborsNigh<_T, __SpaceAcrobot>(space, data_to_key);
+    out = make_nigh<_T, __SpaceAcrobot>(space, fun, state_to_key);
 
   } else if (startsWith(name, "quad3d")) {
 
-    auto data_to_key = [robot, fun](_T const &m) {
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
       using Vector13d = Eigen::Matrix<double, 13, 1>;
-      Vector13d __x = fun(m);
-      // const Eigen::VectorXd &__x = fun(m);
+      Vector13d __x = __s;
       return std::tuple(Eigen::Vector3d(__x(0), __x(1), __x(2)),
                         Eigen::Quaterniond(__x(3), __x(4), __x(5), __x(6)),
                         Eigen::Vector3d(__x(7), __x(8), __x(9)),
@@ -552,12 +804,12 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
     DYNO_CHECK_EQ(w.size(), 4, AT);
     __SpaceQuad3d space(w(0), w(1), w(2), w(3));
     // out = new NearestNeighborsNigh<_T, SpaceQuad3d>(data_to_key);
-    out = new NearestNeighborsNigh<_T, __SpaceQuad3d>(space, data_to_key);
+    out = make_nigh<_T, __SpaceQuad3d>(space, fun, state_to_key);
 
   } else if (startsWith(name, "car1")) {
 
-    auto data_to_key = [robot, fun](_T const &m) {
-      Eigen::Vector4d __x = fun(m);
+    auto state_to_key = [](const Eigen::VectorXd &__s) {
+      Eigen::Vector4d __x = __s;
       return std::tuple(Eigen::Vector2d(__x(0), __x(1)), __x(2), __x(3));
     };
     // out = new NearestNeighborsNigh<_T, SpaceCar1>(data_to_key);
@@ -565,7 +817,7 @@ ompl::NearestNeighbors<_T> *nigh_factory2(
     DYNO_CHECK_EQ(w.size(), 3, AT);
     __SpaceCar1 space(w(0), w(1), w(2));
     // out = new NearestNeighborsNigh<_T, SpaceQuad3d>(data_to_key);
-    out = new NearestNeighborsNigh<_T, __SpaceCar1>(space, data_to_key);
+    out = make_nigh<_T, __SpaceCar1>(space, fun, state_to_key);
   }
 
   CHECK(out, AT);
@@ -691,4 +943,58 @@ ompl::NearestNeighbors<_T> *nigh_factory_t(
   CHECK(out, AT);
   return out;
 }
+
+// Hash grid alternative to nigh_factory2 (use_nigh_nn = false), tuned for
+// queries of radius `radius`. The grid uses the position and the angles, and
+// the velocities if there is room (at most 4 dims, i.e. 16 cells per query).
+// Orientations in SO3 are not gridded.
+template <typename _T>
+ompl::NearestNeighbors<_T> *grid_factory2(
+    const std::string &name,
+    const std::shared_ptr<dynobench::Model_robot> &robot, double radius,
+    std::function<const Eigen::VectorXd(_T)> fun =
+        [](_T m) { return m->getStateEig(); }) {
+
+  auto &w = robot->distance_weights;
+  std::vector<Grid_dim> dims;
+
+  if (startsWith(name, "unicycle1")) {
+    DYNO_CHECK_EQ(w.size(), 2, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1), true}};
+  } else if (startsWith(name, "unicycle2")) {
+    DYNO_CHECK_EQ(w.size(), 4, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1), true}, {3, w(2)}};
+  } else if (startsWith(name, "integrator2_2d")) {
+    DYNO_CHECK_EQ(w.size(), 2, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1)}, {3, w(1)}};
+  } else if (startsWith(name, "integrator2_3d")) {
+    DYNO_CHECK_EQ(w.size(), 2, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(0)}};
+  } else if (startsWith(name, "quad2dpole")) {
+    DYNO_CHECK_EQ(w.size(), 6, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1), true}, {3, w(2), true}};
+  } else if (startsWith(name, "quad2d")) {
+    DYNO_CHECK_EQ(w.size(), 4, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1), true}, {5, w(3)}};
+  } else if (startsWith(name, "acrobot")) {
+    DYNO_CHECK_EQ(w.size(), 3, AT);
+    dims = {{0, w(0), true}, {1, w(1), true}, {2, w(2)}, {3, w(2)}};
+  } else if (startsWith(name, "quad3d")) {
+    DYNO_CHECK_EQ(w.size(), 4, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(0)}};
+  } else if (startsWith(name, "car1")) {
+    DYNO_CHECK_EQ(w.size(), 3, AT);
+    dims = {{0, w(0)}, {1, w(0)}, {2, w(1), true}, {3, w(2), true}};
+  } else {
+    ERROR_WITH_INFO("no hash grid for robot " + name);
+  }
+
+  auto data_to_state = [fun](_T const &m) -> Eigen::VectorXd {
+    return fun(m);
+  };
+  auto distance = [robot](const Eigen::VectorXd &x, const Eigen::VectorXd &y) {
+    return robot->distance(x, y);
+  };
+  return new NearestNeighborsGrid<_T>(data_to_state, distance, dims, radius);
+}
 } // namespace dynoplan
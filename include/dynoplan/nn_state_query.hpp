@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Eigen/Core"
+
+namespace dynoplan {
+
+// Nearest neighbour query with a state instead of an element of the
+// structure, so that the caller does not have to create a fake element (and
+// copy the state into it) for each query. Implemented by the nigh trees of
+// nigh_factory2 (without cost) and by the hash grid.
+template <typename _T> struct NN_state_query {
+
+  // False if the structure cannot answer queries by state
+  virtual bool has_state_query() const = 0;
+
+  virtual _T nearest_state(const Eigen::VectorXd &x) const = 0;
+
+  virtual ~NN_state_query() = default;
+};
+
+} // namespace dynoplan
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <fcl/fcl.h>
+#include <memory>
+#include <vector>
 
 template <typename S>
 void shiftAABB(fcl::AABB<S> &aabb, const fcl::Vector3<S> &offset) {
@@ -57,3 +59,26 @@ protected:
     }
   }
 };
+
+// Collision check of objects translated by offset against a manager (e.g.
+// the environment). Returns true if there is a collision. In contrast to
+// ShiftableDynamicAABBTreeCollisionManager::shift, the objects are not
+// modified, so the same objects can be checked from several threads.
+template <typename S>
+bool collide_shifted(
+    const std::vector<std::unique_ptr<fcl::CollisionObject<S>>> &objs,
+    const fcl::Vector3<S> &offset,
+    const fcl::BroadPhaseCollisionManager<S> *manager) {
+  fcl::DefaultCollisionData<S> collision_data;
+  for (const auto &obj : objs) {
+    fcl::Transform3<S> tf = obj->getTransform();
+    tf.translation() += offset;
+    fcl::CollisionObject<S> shifted(obj->collisionGeometry(), tf);
+    manager->collide(&shifted, &collision_data,
+                     fcl::DefaultCollisionFunction<S>);
+    if (collision_data.result.isCollision()) {
+      return true;
+    }
+  }
+  return false;
+}
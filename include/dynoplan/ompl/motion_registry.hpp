@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/ompl/robots.h"
+
+namespace dynoplan {
+
+// Primitive sets of the robot models, loaded once per process and shared by
+// the planners (dbastar, tdbastar, dbrrt). idbastar adds primitives to its
+// set, it only reads the trajectories.
+//
+// The registry maps a robot type to its primitive file (the default table has
+// the files of new_format_motions, relative to the build folder; it can be
+// extended or overridden with set_motions_file or a yaml file). A set is
+// loaded the first time it is requested, for a (file, robot model,
+// max_motions, cut_actions, shuffle, compute_col) key, and later requests get
+// the same std::vector<Motion>. Different sets load concurrently, the
+// requests of a set wait for its first load.
+//
+// With a cache_dir, the processed trajectories of a set (the first
+// max_motions, with the noise of the first and last states and the
+// normalized quaternions) are stored in a binary file and read instead of
+// the primitive file in the next runs. The collision shapes and the nearest
+// neighbour trees hold pointers (fcl objects, nigh nodes), they are built from
+// the trajectories when a set is loaded, once per process.
+//
+// The planners that shift the collision shapes of the motions (dbastar and
+// dbrrt, without const_motion) restore them, but must not use the same set
+// concurrently.
+struct Motion_registry {
+
+  Motion_registry();
+
+  Motion_registry(const Motion_registry &) = delete;
+  Motion_registry &operator=(const Motion_registry &) = delete;
+
+  // registry of the process
+  static Motion_registry &instance();
+
+  std::string cache_dir = ""; // binary cache of the trajectories ("": none)
+
+  void set_motions_file(const std::string &robot_type,
+                        const std::string &motions_file);
+
+  // Throws if robot_type has no primitive file
+  std::string motions_file(const std::string &robot_type) const;
+
+  // yaml map from robot type to primitive file, e.g.
+  // unicycle1_v0: ../../new_format_motions/unicycle1_v0/unicycle1_v0.msgpack
+  void read_from_yaml(const std::string &file);
+
+  // Motions of motions_file, with the collision shapes of robot (as
+  // load_motion_primitives_new)
+  std::shared_ptr<std::vector<Motion>>
+  load(const std::string &motions_file, dynobench::Model_robot &robot,
+       size_t max_motions, bool cut_actions = false, bool shuffle = false,
+       bool compute_col = true);
+
+  // Motions of the primitive file of robot_type
+  std::shared_ptr<std::vector<Motion>>
+  motions(const std::string &robot_type, dynobench::Model_robot &robot,
+          size_t max_motions, bool cut_actions = false, bool shuffle = false,
+          bool compute_col = true) {
+    return load(motions_file(robot_type), robot, max_motions, cut_actions,
+                shuffle, compute_col);
+  }
+
+  // Processed trajectories of motions_file (from the binary cache if
+  // possible), for the planners that modify their motions (idbastar)
+  dynobench::Trajectories trajectories(const std::string &motions_file,
+                                       dynobench::Model_robot &robot,
+                                       size_t max_motions);
+
+  size_t num_loads() const; // sets loaded from a primitive file or the cache
+  size_t num_hits() const;  // requests served with a loaded set
+
+private:
+  struct Entry {
+    std::mutex mutex;
+    std::shared_ptr<std::vector<Motion>> motions;
+  };
+
+  mutable std::mutex mutex;
+  std::map<std::string, std::string> files;
+  std::map<std::string, std::shared_ptr<Entry>> entries;
+  size_t loads = 0;
+  size_t hits = 0;
+};
+
+// Identity of a primitive file (absolute path, size and modification time),
+// key of the caches computed from it. The states of the loaded primitives are
+// not used, they have random noise (see load_motion_primitives_new).
+uint64_t primitive_file_hash(const std::string &motions_file);
+
+// Binary file of processed trajectories. read returns false if the file does
+// not exist, has another hash or a wrong size.
+void write_primitive_cache(const std::string &file, uint64_t hash,
+                           const dynobench::Trajectories &trajs);
+
+bool read_primitive_cache(const std::string &file, uint64_t hash,
+                          dynobench::Trajectories &trajs);
+
+} // namespace dynoplan
@@ -236,6 +236,22 @@ public:
 
 enum class MotionPrimitiveFormat { BOOST, YAML, JSON, MSGPACK, AUTO };
 
+// Trajectories of a primitive file, as load_motion_primitives_new uses them:
+// the first max_motions, with noise on the first and last state (and
+// normalized quaternions for quad3d)
+dynobench::Trajectories
+load_primitive_trajectories(const std::string &motionsFile,
+                            dynobench::Model_robot &robot, int max_motions,
+                            MotionPrimitiveFormat format =
+                                MotionPrimitiveFormat::AUTO);
+
+// Motions (collision shapes, cost, idx) of the trajectories of
+// load_primitive_trajectories
+void trajectories_to_motions(const dynobench::Trajectories &trajs,
+                             dynobench::Model_robot &robot,
+                             std::vector<Motion> &motions, bool cut_actions,
+                             bool shuffle, bool compute_col = true);
+
 void load_motion_primitives_new(
     const std::string &motionsFile, dynobench::Model_robot &robot,
     std::vector<Motion> &motions, int max_motions, bool cut_actions,
@@ -46,6 +46,11 @@ std::vector<ReportCost> report_problem(ptr<crocoddyl::ShootingProblem> problem,
                                        const std::vector<Eigen::VectorXd> &us,
                                        const char *file_name);
 
+std::vector<ReportCost> report_problem(ptr<crocoddyl::ShootingProblem> problem,
+                                       const std::vector<Eigen::VectorXd> &xs,
+                                       const std::vector<Eigen::VectorXd> &us,
+                                       std::ostream &out);
+
 bool check_problem(ptr<crocoddyl::ShootingProblem> problem,
                    ptr<crocoddyl::ShootingProblem> problem2,
                    const std::vector<Eigen::VectorXd> &xs,
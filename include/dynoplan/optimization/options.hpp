@@ -7,6 +7,8 @@
 namespace dynoplan {
 namespace po = boost::program_options;
 
+struct Output_sink; // forward declaration
+
 struct Options_trajopt {
 
   double time_ref = .5;
@@ -52,6 +54,8 @@ struct Options_trajopt {
   bool welf_format = false;
   bool linear_search = false;
   std::string name = "";
+  int output_mode = 0; // 0: no files, 1: write yaml files to /tmp/dynoplan
+  Output_sink *output_sink = nullptr; // If set, overrides output_mode
 
   void add_options(po::options_description &desc);
 
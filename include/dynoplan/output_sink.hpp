@@ -0,0 +1,107 @@
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dynobench/general_utils.hpp"
+
+namespace dynoplan {
+
+// Destination of the yaml files that the planners write for debugging and
+// visualization (e.g. /tmp/dynoplan/dbastar_out.yaml).
+//
+// A planner asks the sink for a stream with `open(name)` and writes the file
+// only if it gets a stream back. Code that formats large outputs should check
+// the result of `open` before doing the work.
+struct Output_sink {
+  virtual ~Output_sink() = default;
+
+  // Returns nullptr if the output is discarded.
+  virtual std::unique_ptr<std::ostream> open(const std::string &name) = 0;
+};
+
+// Discard all outputs (default of the planners).
+struct Null_sink : Output_sink {
+  std::unique_ptr<std::ostream> open(const std::string &) override {
+    return nullptr;
+  }
+};
+
+// Write each output to the file `name`, creating the directory if necessary.
+struct File_sink : Output_sink {
+  std::unique_ptr<std::ostream> open(const std::string &name) override {
+    create_dir_if_necessary(name.c_str());
+    return std::make_unique<std::ofstream>(name);
+  }
+};
+
+// Keep the outputs in memory, indexed by name. A file becomes visible when the
+// stream returned by `open` is destroyed. Thread-safe.
+struct Memory_sink : Output_sink {
+
+  std::unique_ptr<std::ostream> open(const std::string &name) override {
+    return std::make_unique<Memory_stream>(*this, name);
+  }
+
+  bool has(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return files.count(name);
+  }
+
+  std::string get(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(name);
+    return it == files.end() ? std::string() : it->second;
+  }
+
+  std::vector<std::string> names() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> out;
+    for (auto &f : files) {
+      out.push_back(f.first);
+    }
+    return out;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    files.clear();
+  }
+
+private:
+  struct Memory_stream : std::ostringstream {
+    Memory_stream(Memory_sink &sink, const std::string &name)
+        : sink(sink), name(name) {}
+    ~Memory_stream() {
+      std::lock_guard<std::mutex> lock(sink.mutex);
+      sink.files[name] = str();
+    }
+    Memory_sink &sink;
+    std::string name;
+  };
+
+  mutable std::mutex mutex;
+  std::map<std::string, std::string> files;
+};
+
+enum class Output_mode { none = 0, files = 1 };
+
+// Sink used by a planner: `sink` if given, otherwise the one selected by
+// `output_mode` (see Output_mode).
+inline Output_sink &get_output_sink(Output_sink *sink, int output_mode) {
+  static Null_sink null_sink;
+  static File_sink file_sink;
+  if (sink) {
+    return *sink;
+  }
+  return output_mode == static_cast<int>(Output_mode::files)
+             ? static_cast<Output_sink &>(file_sink)
+             : static_cast<Output_sink &>(null_sink);
+}
+
+} // namespace dynoplan
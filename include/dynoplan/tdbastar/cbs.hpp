@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include <boost/program_options.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/tdbastar/conflicts.hpp"
+#include "dynoplan/tdbastar/constraint_table.hpp"
+#include "dynoplan/tdbastar/options.hpp"
+
+namespace dynoplan {
+
+namespace po = boost::program_options;
+
+struct Options_cbs {
+
+  size_t max_expands = 1e4;      // expansions of the constraint tree
+  double timelimit = 1e5;        // in ms
+  size_t num_threads = 0;        // threads for the low level (0: all cores)
+  bool reverse_heuristic = true; // heuristic: reverse search of each robot
+  bool incremental = true; // keep the collision checks of each robot (replans)
+
+  void add_options(po::options_description &desc);
+
+  void __load_data(void *source, bool boost, bool write = false,
+                   const std::string &be = "");
+
+  void print(std::ostream &out, const std::string &be = "",
+             const std::string &af = ": ") const;
+
+  void read_from_yaml(const YAML::Node &node);
+};
+
+struct Out_info_cbs {
+  bool solved = false;
+  double cost = -1;          // sum of the costs of the robots
+  size_t expands = 0;        // nodes of the constraint tree
+  size_t num_replans = 0;    // calls to tdbastar, without reverse searches
+  double time_search = 0;    // in ms
+  double time_low_level = 0; // in ms, sum over the threads
+  size_t cache_hits = 0;     // primitives not collision checked again
+
+  void write_yaml(std::ostream &out) const {
+    out << STR_(solved) << std::endl;
+    out << STR_(cost) << std::endl;
+    out << STR_(expands) << std::endl;
+    out << STR_(num_replans) << std::endl;
+    out << STR_(time_search) << std::endl;
+    out << STR_(time_low_level) << std::endl;
+    out << STR_(cache_hits) << std::endl;
+  }
+};
+
+// Conflict-based search (db-CBS) over tdbastar.
+//
+// The high level is a best first search over constraint sets, ordered by the
+// sum of the costs. For the first conflict of a node, robot_a gets the
+// constraint (time, state_a) in the first child and robot_b the constraint
+// (time, state_b) in the second child, and the two robots are replanned in
+// parallel. The robots of the root are also solved in parallel.
+//
+// The primitives are loaded once for each robot type, in a Primitive_library
+// that all the threads share, and the trees of the reverse searches once for
+// each robot. The same robot is never replanned by two threads at the same
+// time, so each robot also keeps a Tdbastar_cache between its replans
+// (incremental).
+//
+// options_tdbastar: one for each robot type, with motionsFile. delta is the
+// one of robot 0.
+void cbs(dynobench::Problem &problem,
+         const std::map<std::string, Options_tdbastar> &options_tdbastar,
+         const Options_cbs &options_cbs,
+         std::vector<dynobench::Trajectory> &trajs_out,
+         Out_info_cbs &out_info_cbs);
+
+} // namespace dynoplan
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/thread_pool.hpp"
+
+namespace dynoplan {
+
+// Conflict between two robots at a time step: the distance between their
+// states is <= delta. A robot that has reached its goal stays at the last
+// state of its trajectory.
+struct Cbs_conflict {
+  size_t robot_a;
+  size_t robot_b;
+  size_t time_step;
+  Eigen::VectorXd state_a;
+  Eigen::VectorXd state_b;
+};
+
+// First conflict between the trajectories of N robots, with a sweep and prune
+// at each time step.
+//
+// The robots are sorted by the first component of the position and only the
+// pairs that are closer than `radius` in that component are compared with the
+// exact distance. radius is delta / distance_weights(0) (robots of the same
+// type, the position part of robot->distance is below delta) or delta (robots
+// of different types). The order of a time step is the initial guess of the
+// next one, so the insertion sort is linear when the robots move little.
+//
+// The result is the same as comparing all the pairs: the earliest time step,
+// and then the smallest (robot_a, robot_b).
+struct Conflict_detector {
+
+  Conflict_detector(
+      const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+      const std::vector<std::string> &robot_types, double delta);
+
+  // With a pool, the time steps are split in windows of `window` steps that
+  // are checked in parallel. The windows after a conflict are skipped.
+  bool first_conflict(const std::vector<dynobench::Trajectory> &trajs,
+                      Cbs_conflict &conflict,
+                      Thread_pool *pool = nullptr) const;
+
+  // Exact check of one pair (narrow phase)
+  bool in_conflict(size_t a, size_t b,
+                   const Eigen::Ref<const Eigen::VectorXd> &x_a,
+                   const Eigen::Ref<const Eigen::VectorXd> &x_b) const;
+
+  size_t window = 64;
+  double radius; // of the sweep, infinity if it cannot prune
+
+private:
+  const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots;
+  const std::vector<std::string> &robot_types;
+  double delta;
+
+  // first conflict with time step in [t_begin, t_end)
+  bool first_conflict_in(const std::vector<dynobench::Trajectory> &trajs,
+                         size_t t_begin, size_t t_end,
+                         Cbs_conflict &conflict) const;
+};
+
+// Conflict_detector::first_conflict. Robots of the same type are compared
+// with robot->distance and robots of different types with the distance
+// between their positions. Returns false if there is no conflict.
+bool first_conflict(
+    const std::vector<dynobench::Trajectory> &trajs,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta,
+    Cbs_conflict &conflict, Thread_pool *pool = nullptr);
+
+// Same result, comparing all the pairs at every time step (for testing)
+bool first_conflict_brute_force(
+    const std::vector<dynobench::Trajectory> &trajs,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta,
+    Cbs_conflict &conflict);
+
+} // namespace dynoplan
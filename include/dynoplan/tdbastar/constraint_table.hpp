@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+
+namespace dynoplan {
+
+struct Constraint {
+  double time;
+  Eigen::VectorXd constrained_state;
+};
+
+// Index of the constraints of a tdbastar search, for the checks of the
+// primitives, of the goal and of the rewire.
+//
+// The constraints are bucketed by time step, lround(time / ref_dt). A bucket
+// with many constraints also has a grid on the position (the first
+// get_translation_invariance() components), with cells of size
+// delta / distance_weights(0): a constraint can only be violated if the
+// position part of the distance is below delta. A second grid, without time,
+// answers the queries of the type "any constraint after time t".
+//
+// The results are the same as checking every constraint: the candidates are
+// filtered with the original time conditions and robot.distance(.) <= delta.
+struct Constraint_table {
+
+  Constraint_table(const std::vector<Constraint> &constraints,
+                   dynobench::Model_robot &robot, double delta);
+
+  // Is there a constraint with time >= t_min that is violated by x?
+  // (e.g. the robot stays at x, because x is at the goal)
+  bool violated_after(const Eigen::Ref<const Eigen::VectorXd> &x,
+                      double t_min) const;
+
+  // Checks a primitive that starts at time g0: the state i is checked against
+  // the constraints with time index lround((time - g0) / ref_dt) == i, for
+  // i < size - 1. If reaches_goal, the last state is also checked against
+  // all the constraints with time index >= size - 1.
+  bool violated_trajectory(dynobench::TrajWrapper &traj, float g0,
+                           bool reaches_goal) const;
+
+  size_t size() const { return constraints.size(); }
+
+private:
+  using Cells = std::unordered_map<uint64_t, std::vector<size_t>>;
+
+  struct Bucket {
+    std::vector<size_t> all;
+    Cells cells; // empty if all.size() < min_spatial
+  };
+
+  static constexpr size_t min_spatial = 16;
+
+  const std::vector<Constraint> &constraints;
+  dynobench::Model_robot &robot;
+  double delta;
+  double ref_dt;
+  size_t dim_pos = 0; // 0: no grid on the position
+  double cell_size = 0;
+
+  std::map<long, Bucket> buckets;
+  std::vector<size_t> all;
+  Cells cells_all; // empty if all.size() < min_spatial
+
+  int time_index(size_t c, float g0) const;
+  bool violated(const Eigen::Ref<const Eigen::VectorXd> &x, size_t c) const;
+  uint64_t cell_key(const Eigen::Ref<const Eigen::VectorXd> &x,
+                    size_t neighbour) const;
+  size_t num_neighbours() const;
+
+  // calls f(c) for the constraints of `cells` that can be close to x, or of
+  // `list` if the grid is not used. Stops when f returns true.
+  template <typename Fun>
+  bool any_near(const Cells &cells, const std::vector<size_t> &list,
+                const Eigen::Ref<const Eigen::VectorXd> &x, Fun f) const;
+};
+
+} // namespace dynoplan
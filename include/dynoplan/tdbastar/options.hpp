@@ -10,6 +10,8 @@ namespace dynoplan {
 
 struct Heuristic_node; // forward declaration
 struct Motion;         // forward declaration
+struct Reservation_table; // forward declaration
+struct Primitive_library; // forward declaration
 
 namespace po = boost::program_options;
 
@@ -29,11 +31,13 @@ struct Options_tdbastar {
   float connect_radius_h = .5; // Connection radius for heuristic (only ROADMAP)
   std::string motionsFile = "";               // file with motion primitives
   std::vector<Motion> *motions_ptr = nullptr; // Pointer to loaded motions
+  const Primitive_library *primitives_ptr =
+      nullptr; // Shared motions and trees (instead of motions_ptr)
   std::string outFile =
       "/tmp/dynoplan/out_db.yaml"; // output file to write some results
   float maxCost =
       std::numeric_limits<float>::infinity(); // Cost bound during search
-  int heuristic = 0;                          // which heuristic to use
+  int heuristic = 0; // 0: euclidean, 1: roadmap, 2: grid, -1: blind
   size_t max_motions = 1e4;   //  Max number of motions to use in the search
   double heu_resolution = .5; // used only for ROADMAP heuristic
   double delta_factor_goal =
@@ -57,9 +61,23 @@ struct Options_tdbastar {
 
   double search_timelimit = 1e4;    // in ms
   double heu_connection_radius = 1; // connection radius for ROADMAP heuristic
-  bool use_nigh_nn = true;          // use nigh for nearest neighbor.
+  double heu_grid_resolution = .1;  // resolution of the GRID heuristic
+  size_t num_threads_heu =
+      1; // Threads to rasterize the GRID heuristic (0: all cores)
+  // Cache of the ROADMAP heuristic, by quantised state (0: no cache). The
+  // cached value is the one of another state of the cell (not admissible).
+  double heu_cache_resolution = 0;
+  size_t heu_cache_size = 1 << 16; // Entries of the heuristic cache
+  bool use_nigh_nn = true;          // nigh kd-tree (true) or hash grid (false)
   bool check_cols = true;
   bool rewire = true; // to allow rewiring during the search
+  int record_expanded_trajs =
+      0; // Expanded primitives: 0: none, 1: all, 2: ring buffer, 3: sampling
+  size_t record_expanded_size = 1000; // Capacity of the ring buffer
+  size_t record_expanded_every = 100; // Sampling: one of every N successors
+  std::string expanded_trajs_file = ""; // msgpack dump of the recorded trajs
+  const Reservation_table *reservations_ptr =
+      nullptr; // Paths of other robots to avoid (prioritized planning)
 
   void add_options(po::options_description &desc);
 
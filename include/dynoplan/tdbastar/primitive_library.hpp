@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ompl/datastructures/NearestNeighbors.h>
+
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/ompl/robots.h"
+#include "dynoplan/tdbastar/options.hpp"
+#include "dynoplan/thread_pool.hpp"
+
+namespace dynoplan {
+
+// Motion primitives of a robot type, with their collision shapes and the
+// nearest neighbour trees of the expansion (forward and reverse search),
+// loaded once and shared by all the planners and threads of a process
+// through a std::shared_ptr<const Primitive_library>.
+//
+// The library is not modified after the constructor: tdbastar only queries
+// the trees, and checks the collisions of the shared shapes without shifting
+// them (collide_shifted). The mutable state of a query (open list, nodes,
+// trajectory buffers, caches) belongs to the search.
+//
+// The motions come from the Motion_registry (with options.max_motions,
+// cut_actions and check_cols), so the libraries with different trees share
+// them. The trees are built as in tdbastar, with
+// options.use_nigh_nn and, for the hash grid, the radius
+// options.alpha * options.delta. The searches that use the library must have
+// the same values.
+struct Primitive_library {
+
+  // robot is the model of robot_type used for the collision shapes
+  Primitive_library(const std::string &robot_type,
+                    const std::shared_ptr<dynobench::Model_robot> &robot,
+                    const Options_tdbastar &options);
+
+  Primitive_library(const Primitive_library &) = delete;
+  Primitive_library &operator=(const Primitive_library &) = delete;
+
+  const std::string robot_type;
+  const std::string motions_file;
+  std::shared_ptr<dynobench::Model_robot> robot;
+
+private:
+  std::shared_ptr<std::vector<Motion>> shared_motions;
+
+public:
+  const std::vector<Motion> &motions;
+
+  size_t max_motions;
+  bool cut_actions;
+  bool check_cols; // collision shapes of the motions
+  bool use_nigh_nn;
+  double grid_radius; // if !use_nigh_nn
+
+  // tree by the first state (forward) or by the last state (reverse search)
+  ompl::NearestNeighbors<Motion *> *nn(bool reverse_search) const {
+    return reverse_search ? T_m_reverse.get() : T_m.get();
+  }
+
+  // Can a search with these options use the library?
+  bool compatible(const std::string &robot_type,
+                  const Options_tdbastar &options) const;
+
+private:
+  std::unique_ptr<ompl::NearestNeighbors<Motion *>> T_m;
+  std::unique_ptr<ompl::NearestNeighbors<Motion *>> T_m_reverse;
+};
+
+// One library for each robot type of a multi-robot problem, loaded in
+// parallel. robots are the models of the robots of the problem and options
+// has the options (with motionsFile) of each robot type.
+std::map<std::string, std::shared_ptr<const Primitive_library>>
+load_primitive_libraries(
+    const std::vector<std::string> &robot_types,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::map<std::string, Options_tdbastar> &options,
+    Thread_pool &pool);
+
+} // namespace dynoplan
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/motions.hpp"
+#include "dynoplan/tdbastar/options.hpp"
+#include "dynoplan/tdbastar/reservation_table.hpp"
+
+namespace dynoplan {
+
+namespace po = boost::program_options;
+
+struct Options_prioritized {
+
+  size_t num_restarts = 8;       // priority orders (the first is 0, 1, ...)
+  size_t seed = 0;               // of the random priority orders
+  double timelimit = 1e5;        // in ms, no restart starts after it
+  size_t num_threads = 0;        // restarts in parallel (0: all cores)
+  bool reverse_heuristic = true; // heuristic: reverse search of each robot
+  bool stop_at_first = false;    // stop at the first solved order
+
+  void add_options(po::options_description &desc);
+
+  void __load_data(void *source, bool boost, bool write = false,
+                   const std::string &be = "");
+
+  void print(std::ostream &out, const std::string &be = "",
+             const std::string &af = ": ") const;
+
+  void read_from_yaml(const YAML::Node &node);
+};
+
+struct Out_info_prioritized {
+  bool solved = false;
+  double cost = -1;            // sum of the costs of the robots
+  size_t num_restarts = 0;     // orders that were tried
+  size_t num_solved = 0;       // orders that were solved
+  size_t num_replans = 0;      // calls to tdbastar, without reverse searches
+  std::vector<size_t> order;   // priority order of the solution
+  double time_search = 0;      // in ms
+  double time_low_level = 0;   // in ms, sum over the threads
+
+  void write_yaml(std::ostream &out) const {
+    out << STR_(solved) << std::endl;
+    out << STR_(cost) << std::endl;
+    out << STR_(num_restarts) << std::endl;
+    out << STR_(num_solved) << std::endl;
+    out << STR_(num_replans) << std::endl;
+    out << "order: [";
+    for (size_t i = 0; i < order.size(); i++) {
+      out << (i ? ", " : "") << order[i];
+    }
+    out << "]" << std::endl;
+    out << STR_(time_search) << std::endl;
+    out << STR_(time_low_level) << std::endl;
+  }
+};
+
+// Prioritized planning over tdbastar.
+//
+// For a priority order, the robots are planned one after the other and the
+// paths of the robots with higher priority are obstacles in a
+// Reservation_table (no constraints, no high level search). An order fails
+// if a robot has no solution. The first order is 0, 1, ..., N-1 and the
+// others are random permutations; they run in parallel, one per thread, and
+// the solution is the one with the lowest cost.
+//
+// The threads share a Primitive_library for each robot type, and each
+// thread keeps a Tdbastar_cache for each robot, reused by the orders it runs.
+// The trees of the reverse searches are computed once for each robot, and
+// then only read.
+void prioritized(
+    dynobench::Problem &problem,
+    const std::map<std::string, Options_tdbastar> &options_tdbastar,
+    const Options_prioritized &options_prioritized,
+    std::vector<dynobench::Trajectory> &trajs_out,
+    Out_info_prioritized &out_info);
+
+} // namespace dynoplan
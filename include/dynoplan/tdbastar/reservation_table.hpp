@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models_base.hpp"
+#include "dynoplan/tdbastar/conflicts.hpp"
+
+namespace dynoplan {
+
+// Paths of the robots that are already planned (prioritized planning), for
+// the checks of tdbastar. It replaces the lists of constraints: a state of the
+// robot being planned is invalid if it is in conflict (Conflict_detector) with
+// a reserved state at the same time step.
+//
+// The states are bucketed by time step (std::map, O(log T) insertion and
+// lookup) and each bucket has a hash grid on the position, with cells of the
+// size of the sweep radius of the Conflict_detector: only the 3^dim cells
+// around a state are compared. A robot stays at the last state of its path
+// forever (parked), these states are checked at every later time step.
+//
+// All the robots must have the same ref_dt. robots and robot_types are
+// indexed by robot id and must outlive the table.
+struct Reservation_table {
+
+  Reservation_table(
+      const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+      const std::vector<std::string> &robot_types, double delta);
+
+  // Reserves the states of the path of robot, starting at time step 0
+  void add(size_t robot, const dynobench::Trajectory &traj);
+
+  // Is x (of robot) in conflict with a reserved state at time step t?
+  bool in_conflict(size_t robot, const Eigen::Ref<const Eigen::VectorXd> &x,
+                   long t) const;
+
+  // Is there a conflict if robot stays at x from time `time` on?
+  bool violated_after(size_t robot, const Eigen::Ref<const Eigen::VectorXd> &x,
+                      double time) const;
+
+  // Checks a primitive of robot that starts at time g0, as
+  // Constraint_table::violated_trajectory: the states i < size - 1 at time
+  // step lround(g0 / ref_dt) + i, and the last state for all the later time
+  // steps if reaches_goal.
+  bool violated_trajectory(size_t robot, dynobench::TrajWrapper &traj,
+                           float g0, bool reaches_goal) const;
+
+  size_t size() const { return num_states; }
+
+private:
+  using Cells = std::unordered_map<uint64_t, std::vector<size_t>>;
+
+  struct Reservation {
+    size_t robot;
+    long time_step;
+    Eigen::VectorXd state;
+  };
+
+  struct Bucket {
+    std::vector<Reservation> all;
+    Cells cells; // empty if there is no grid
+  };
+
+  Conflict_detector detector;
+  double ref_dt;
+  size_t dim_pos = 0; // 0: no grid on the position
+  size_t num_states = 0;
+
+  std::map<long, Bucket> buckets;
+  Bucket all;                       // all the reservations, without time
+  std::vector<Reservation> parked; // last state of each path
+
+  uint64_t cell_key(const Eigen::Ref<const Eigen::VectorXd> &x,
+                    size_t neighbour) const;
+  void insert(Bucket &bucket, const Reservation &r);
+
+  // calls f(r) for the reservations of bucket that can be in conflict with x.
+  // Stops when f returns true.
+  template <typename Fun>
+  bool any_near(const Bucket &bucket,
+                const Eigen::Ref<const Eigen::VectorXd> &x, Fun f) const;
+};
+
+} // namespace dynoplan
@@ -3,9 +3,11 @@
 // // #include <boost/graph/graphviz.hpp>
 #include "Eigen/Core"
 #include <chrono>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <unordered_map>
 //
 // #include <flann/flann.hpp>
 // #include <msgpack.hpp>
@@ -28,7 +30,10 @@
 #include "dynobench/planar_rotor.hpp"
 #include "dynobench/quadrotor.hpp"
 #include "dynoplan/dbastar/heuristics.hpp"
+#include "dynoplan/tdbastar/constraint_table.hpp"
 #include "dynoplan/tdbastar/options.hpp"
+#include "dynoplan/tdbastar/primitive_library.hpp"
+#include "dynoplan/tdbastar/reservation_table.hpp"
 
 namespace dynoplan {
 
@@ -39,13 +44,12 @@ using Sample_ = ob::State;
 
 struct AStarNode;
 struct compareAStarNode {
-  bool operator()(const std::shared_ptr<AStarNode> a,
-                  const std::shared_ptr<AStarNode> b) const;
+  bool operator()(const AStarNode *a, const AStarNode *b) const;
 };
 
-typedef typename boost::heap::d_ary_heap<
-    std::shared_ptr<AStarNode>, boost::heap::arity<2>,
-    boost::heap::compare<compareAStarNode>, boost::heap::mutable_<true>>
+typedef typename boost::heap::d_ary_heap<AStarNode *, boost::heap::arity<2>,
+                                         boost::heap::compare<compareAStarNode>,
+                                         boost::heap::mutable_<true>>
     open_t;
 // Node type (used for open and explored states)
 struct AStarNode {
@@ -70,16 +74,15 @@ struct AStarNode {
   bool valid = true;
   bool reaches_goal;
   // can arrive at this node at time gScore, starting from came_from, using
-  // motion used_motion
+  // motion used_motion. The arrivals are stored in AStarNode_pool::arrivals
+  // and arrival_idx is the arrival of came_from.
   struct arrival {
     float gScore;
-    // AStarNode* came_from;
-    std::shared_ptr<AStarNode> came_from;
+    AStarNode *came_from;
     size_t used_motion;
     size_t arrival_idx;
   };
-  std::vector<arrival> arrivals;
-  size_t current_arrival_idx;
+  size_t current_arrival_idx; // index in AStarNode_pool::arrivals
 
   const ob::State *getState() { return state; }
   const Eigen::VectorXd &getStateEig() { return state_eig; }
@@ -94,6 +97,58 @@ struct AStarNode {
   }
 };
 
+// Memory of the nodes of a tdbastar search. The open list, the nearest
+// neighbour tree and the arrivals use raw pointers to the nodes: a std::deque
+// does not move its elements when it grows. The arrivals of all the nodes are
+// stored in one flat vector.
+struct AStarNode_pool {
+  std::deque<AStarNode> nodes;
+  std::vector<AStarNode::arrival> arrivals;
+
+  AStarNode *allocate() { return &nodes.emplace_back(); }
+
+  size_t add_arrival(const AStarNode::arrival &a) {
+    arrivals.push_back(a);
+    return arrivals.size() - 1;
+  }
+};
+
+// Tree of a search (e.g. the reverse search), used as heuristic of a later
+// search. It owns the nodes of the tree.
+struct Search_tree {
+  std::unique_ptr<AStarNode_pool> pool;
+  std::unique_ptr<ompl::NearestNeighbors<AStarNode *>> T_n;
+};
+
+// Results of the bounds and collision checks of the primitives that tdbastar
+// has applied to each expanded state. They do not depend on the constraints,
+// so they are kept between the replans of the same robot (e.g. in CBS): the
+// search is the same as without cache, but a primitive that was already
+// checked at the same state skips the collision check, and it is not even
+// computed if it was in collision. The caller has to use the same primitives
+// (motion idx) and environment in all the calls.
+struct Tdbastar_cache {
+  size_t max_states = 1e6; // no new states are added when full
+  size_t hits = 0;
+  size_t misses = 0;
+
+  // nullptr if x has not been checked with motion_idx
+  const bool *find(const Eigen::Ref<const Eigen::VectorXd> &x,
+                   size_t motion_idx) const;
+
+  void add(const Eigen::Ref<const Eigen::VectorXd> &x, size_t motion_idx,
+           bool collision_free);
+
+  size_t size() const { return states.size(); }
+
+private:
+  struct Entry {
+    Eigen::VectorXd state;
+    std::unordered_map<size_t, bool> collision_free; // by motion idx
+  };
+  std::unordered_map<uint64_t, Entry> states; // by hash of the state
+};
+
 // float heuristic(std::shared_ptr<RobotOmpl> robot, const ob::State *s,
 //                 const ob::State *g);
 
@@ -152,10 +207,6 @@ struct Out_info_tdb {
 double automatic_delta(double delta_in, double alpha, RobotOmpl &robot,
                        ompl::NearestNeighbors<Motion *> &T_m);
 
-struct Constraint {
-  double time;
-  Eigen::VectorXd constrained_state;
-};
 void export_constraints(const std::vector<Constraint> &constrained_states,
                         std::string robot_type, size_t robot_id,
                         std::ofstream *out);
@@ -165,9 +216,8 @@ void tdbastar(
     dynobench::Trajectory &traj_out, const std::vector<Constraint> &constraints,
     Out_info_tdb &out_info_tdb, size_t &robot_id, bool reverse_search,
     std::vector<dynobench::Trajectory> &expanded_trajs,
-    ompl::NearestNeighbors<std::shared_ptr<AStarNode>> *heuristic_nn = nullptr,
-    ompl::NearestNeighbors<std::shared_ptr<AStarNode>> **heuristic_result =
-        nullptr);
+    ompl::NearestNeighbors<AStarNode *> *heuristic_nn = nullptr,
+    Search_tree *heuristic_result = nullptr, Tdbastar_cache *cache = nullptr);
 
 struct LazyTraj {
 
@@ -293,27 +343,29 @@ void plot_search_tree(std::vector<AStarNode *> nodes,
                       std::vector<Motion> &motions,
                       dynobench::Model_robot &robot, const char *filename);
 
-void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
-                                    const std::vector<Motion> &motions,
-                                    // AStarNode *solution,
-                                    std::shared_ptr<AStarNode> solution,
-                                    const dynobench::Problem &problem,
-                                    dynobench::Trajectory &traj_out,
-                                    std::ofstream *out = nullptr);
+void from_solution_to_yaml_and_traj(
+    dynobench::Model_robot &robot, const std::vector<Motion> &motions,
+    AStarNode *solution, const std::vector<AStarNode::arrival> &arrivals,
+    const dynobench::Problem &problem, dynobench::Trajectory &traj_out,
+    std::ofstream *out = nullptr);
 
 void check_goal(dynobench::Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
                 const Eigen::Ref<const Eigen::VectorXd> &goal,
                 dynobench::TrajWrapper &traj_wrapper, double distance_bound,
                 size_t num_check_goal, int &chosen_index, bool forward);
 
+// const_motion: if true, the collision shape of the motion is not modified
+// (e.g. the motion is in a shared Primitive_library).
 bool check_lazy_trajectory(
     LazyTraj &lazy_traj, dynobench::Model_robot &robot,
     const Eigen::Ref<const Eigen::VectorXd> &goal, Time_benchmark &time_bench,
     dynobench::TrajWrapper &tmp_traj,
-    const std::vector<Constraint> &constraints, const float best_node_gscore,
+    const Constraint_table &constraints, const float best_node_gscore,
     float delta, Eigen::Ref<Eigen::VectorXd> aux_last_state,
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *check_state = nullptr,
-    int *num_valid_states = nullptr, bool forward = true);
+    int *num_valid_states = nullptr, bool forward = true,
+    bool check_collisions = true, bool *collision_free = nullptr,
+    bool const_motion = false);
 
 // TODO: @Akmaral, are you using this function? -- if not remove from here and
 // from cpp
@@ -324,4 +376,33 @@ void disable_motions(std::shared_ptr<dynobench::Model_robot> &robot,
 
 void export_node_expansion(std::vector<dynobench::Trajectory> &expanded_trajs,
                            std::ostream *out);
+
+enum class Record_expanded { none = 0, all = 1, ring = 2, sample = 3 };
+
+// Recording of the primitives that tdbastar expands, for debugging and
+// visualization. Only the recorded primitives are copied to a Trajectory:
+// with Record_expanded::none (default) the search makes no copies, the ring
+// buffer keeps the last `record_expanded_size` and the sampling mode one of
+// every `record_expanded_every`.
+struct Expanded_trajs_recorder {
+
+  Expanded_trajs_recorder(const Options_tdbastar &options);
+
+  bool enabled() const { return mode != Record_expanded::none; }
+
+  // Called with every valid successor. `cost` is the gScore of the parent.
+  void offer(dynobench::TrajWrapper &traj, double cost);
+
+  // Appends the recorded trajectories, oldest first
+  void get(std::vector<dynobench::Trajectory> &out) const;
+
+  size_t num_offered = 0;
+
+private:
+  Record_expanded mode;
+  size_t max_size;
+  size_t every;
+  size_t next = 0; // oldest element of the ring buffer, when full
+  std::vector<dynobench::Trajectory> trajs;
+};
 } // namespace dynoplan
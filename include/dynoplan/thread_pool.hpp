@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dynoplan {
+
+// Persistent pool of threads for fork-join parallelism.
+//
+// The threads are created once and sleep between jobs, so that a
+// parallel_for inside the main loop of a search only costs a wake-up.
+// The calling thread takes part in the work as worker 0, i.e. a pool of size
+// n creates n-1 threads. Not thread-safe: only one thread can submit jobs.
+class Thread_pool {
+public:
+  // num_threads = 0 -> use all hardware threads
+  explicit Thread_pool(size_t num_threads = 0) {
+    if (num_threads == 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < num_threads; i++) {
+      threads.emplace_back([this, i] { worker_loop(i); });
+    }
+  }
+
+  Thread_pool(const Thread_pool &) = delete;
+  Thread_pool &operator=(const Thread_pool &) = delete;
+
+  ~Thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv_start.notify_all();
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+
+  size_t size() const { return threads.size() + 1; }
+
+  // Evaluate fun(i, worker_id) for i in [0, n), with worker_id in [0, size()).
+  // Blocks until all evaluations are done. The first exception thrown by fun
+  // is rethrown here.
+  void parallel_for(size_t n,
+                    const std::function<void(size_t, size_t)> &fun) {
+    if (n == 0) {
+      return;
+    }
+    if (threads.empty() || n == 1) {
+      for (size_t i = 0; i < n; i++) {
+        fun(i, 0);
+      }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = &fun;
+      job_size = n;
+      next.store(0);
+      pending = threads.size();
+      error = nullptr;
+      generation++;
+    }
+    cv_start.notify_all();
+
+    run_job(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv_done.wait(lock, [&] { return pending == 0; });
+    job = nullptr;
+    if (error) {
+      std::exception_ptr e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  void run_job(size_t worker_id) {
+    size_t i;
+    while ((i = next.fetch_add(1)) < job_size) {
+      try {
+        (*job)(i, worker_id);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next.store(job_size); // skip the remaining work
+      }
+    }
+  }
+
+  void worker_loop(size_t worker_id) {
+    size_t seen_generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv_start.wait(lock, [&] {
+          return stop || generation != seen_generation;
+        });
+        if (stop) {
+          return;
+        }
+        seen_generation = generation;
+      }
+      run_job(worker_id);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+          cv_done.notify_one();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+
+  const std::function<void(size_t, size_t)> *job = nullptr;
+  size_t job_size = 0;
+  std::atomic<size_t> next{0};
+  size_t pending = 0;
+  size_t generation = 0;
+  bool stop = false;
+  std::exception_ptr error = nullptr;
+};
+
+} // namespace dynoplan
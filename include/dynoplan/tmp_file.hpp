@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+namespace dynoplan {
+
+// Name of a temporary file next to `file`, for the caches on disk that are
+// written to a temporary file and then renamed. The name is unique to the
+// process and the call, so that concurrent writers of the same cache do not
+// write into the same temporary file.
+inline std::string tmp_file_name(const std::string &file) {
+  static std::atomic<uint64_t> counter{0};
+  std::stringstream ss;
+  ss << file << ".tmp." << ::getpid() << "." << counter++;
+  return ss.str();
+}
+
+} // namespace dynoplan
@@ -36,7 +36,9 @@
 
 #include "dynobench/general_utils.hpp"
 
+#include "dynoplan/dbastar/hlut.hpp"
 #include "dynoplan/nigh_custom_spaces.hpp"
+#include <filesystem>
 
 namespace dynoplan {
 
@@ -67,6 +69,16 @@ bool compareAStarNode::operator()(const AStarNode *a,
   }
 }
 
+bool compareSearchNode::operator()(const SearchNode *a,
+                                   const SearchNode *b) const {
+  // Same order as compareAStarNode
+  if (a->fScore != b->fScore) {
+    return a->fScore > b->fScore;
+  } else {
+    return a->gScore < b->gScore;
+  }
+}
+
 void plot_search_tree(std::vector<AStarNode *> nodes,
                       std::vector<Motion> &motions,
                       dynobench::Model_robot &robot, const char *filename) {
@@ -126,18 +138,19 @@ void plot_search_tree(std::vector<AStarNode *> nodes,
   }
 }
 
-void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
-                                    const std::vector<Motion> &motions,
-                                    AStarNode *solution,
-                                    const dynobench::Problem &problem,
-                                    dynobench::Trajectory &traj_out,
-                                    std::ofstream *out) {
-  std::vector<const AStarNode *> result;
+template <typename _Node>
+void __from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
+                                      const std::vector<Motion> &motions,
+                                      const _Node *solution,
+                                      const dynobench::Problem &problem,
+                                      dynobench::Trajectory &traj_out,
+                                      std::ostream *out) {
+  std::vector<const _Node *> result;
 
   CHECK(solution, AT);
   // TODO: check what happens if a solution is a single state?
 
-  const AStarNode *n = solution;
+  const _Node *n = solution;
   while (n != nullptr) {
     result.push_back(n);
     // std::cout << n->used_motion << std::endl;
@@ -309,6 +322,26 @@ void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
                  1e-6, "");
 };
 
+void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
+                                    const std::vector<Motion> &motions,
+                                    AStarNode *solution,
+                                    const dynobench::Problem &problem,
+                                    dynobench::Trajectory &traj_out,
+                                    std::ostream *out) {
+  __from_solution_to_yaml_and_traj(robot, motions, solution, problem, traj_out,
+                                   out);
+}
+
+void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
+                                    const std::vector<Motion> &motions,
+                                    SearchNode *solution,
+                                    const dynobench::Problem &problem,
+                                    dynobench::Trajectory &traj_out,
+                                    std::ostream *out) {
+  __from_solution_to_yaml_and_traj(robot, motions, solution, problem, traj_out,
+                                   out);
+}
+
 double automatic_delta(double delta_in, double alpha, RobotOmpl &robot,
                        ompl::NearestNeighbors<Motion *> &T_m) {
   Motion fakeMotion;
@@ -393,7 +426,7 @@ bool check_lazy_trajectory(
     Time_benchmark &time_bench, dynobench::TrajWrapper &tmp_traj,
     Eigen::Ref<Eigen::VectorXd> aux_last_state,
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *check_state,
-    int *num_valid_states, bool forward) {
+    int *num_valid_states, bool forward, bool const_motion) {
 
   time_bench.time_alloc_primitive += 0; // no memory allocation :)
 
@@ -471,14 +504,20 @@ bool check_lazy_trajectory(
       assert(motion);
       assert(motion->collision_manager);
       assert(robot.env.get());
-      std::vector<fcl::CollisionObject<double> *> objs;
-      motion->collision_manager->getObjects(objs);
-      motion->collision_manager->shift(__offset);
-      fcl::DefaultCollisionData<double> collision_data;
-      motion->collision_manager->collide(robot.env.get(), &collision_data,
-                                         fcl::DefaultCollisionFunction<double>);
-      motion->collision_manager->shift(-__offset);
-      motion_valid = !collision_data.result.isCollision();
+      if (const_motion) {
+        motion_valid = !collide_shifted(motion->collision_objects, __offset,
+                                        robot.env.get());
+      } else {
+        std::vector<fcl::CollisionObject<double> *> objs;
+        motion->collision_manager->getObjects(objs);
+        motion->collision_manager->shift(__offset);
+        fcl::DefaultCollisionData<double> collision_data;
+        motion->collision_manager->collide(
+            robot.env.get(), &collision_data,
+            fcl::DefaultCollisionFunction<double>);
+        motion->collision_manager->shift(-__offset);
+        motion_valid = !collision_data.result.isCollision();
+      }
     } else {
       motion_valid = dynobench::is_motion_collision_free(tmp_traj, robot);
     }
@@ -511,29 +550,106 @@ void check_goal(dynobench::Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
   }
 };
 
-/** @brief Discontiuity Bounded A* search.
- * See the TRO paper for more details:
- * https://arxiv.org/abs/2311.03553
- *
- * @param problem: The motion planning problem
- * @param options_dbastar: The options for the search
- * @param traj_out: The output trajectory (as out argument)
- * @param out_info_db: The output info (as out argument)
- */
-void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
-             Trajectory &traj_out, Out_info_db &out_info_db) {
+std::shared_ptr<Heu_fun>
+make_heuristic(const dynobench::Problem &problem,
+               std::shared_ptr<dynobench::Model_robot> robot,
+               Options_dbastar &options_dbastar,
+               ompl::NearestNeighbors<Motion *> &T_m,
+               std::vector<Heuristic_node> &heu_map,
+               Time_benchmark &time_bench) {
+  std::shared_ptr<Heu_fun> h_fun = nullptr;
+
+  switch (options_dbastar.heuristic) {
+  case 0: {
+    h_fun = std::make_shared<Heu_euclidean>(robot, problem.goal);
+  } break;
+  case 1: {
+    if (options_dbastar.heu_map_ptr) {
+      std::cout << "Heuristic map is already loaded" << std::endl;
+    } else {
+      if (options_dbastar.heu_map_file.size()) {
+        std::cout << "loading map from file " << std::endl;
+        load_heu_map(options_dbastar.heu_map_file.c_str(), heu_map);
+      } else {
+        std::cout << "not heu map provided. Computing one .... " << std::endl;
+        time_bench.build_heuristic += timed_fun_void([&] {
+          generate_heuristic_map_cached(problem, robot, options_dbastar,
+                                        heu_map);
+        });
+        Output_sink &sink = get_output_sink(options_dbastar.output_sink,
+                                            options_dbastar.output_mode);
+        if (auto out = sink.open("/tmp/dynoplan/tmp_heu_map.yaml")) {
+          write_heu_map(heu_map, *out);
+        }
+      }
+      options_dbastar.heu_map_ptr = &heu_map;
+    }
+
+    auto hh = std::make_shared<Heu_roadmap>(robot, *options_dbastar.heu_map_ptr,
+                                            problem.goal, problem.robotType);
+    hh->connect_radius_h = options_dbastar.connect_radius_h;
+    h_fun = hh;
+    if (options_dbastar.heu_cache_resolution > 0) {
+      h_fun = std::make_shared<Heu_cached>(
+          h_fun, options_dbastar.heu_cache_resolution,
+          options_dbastar.heu_cache_size);
+    }
+  } break;
+  case 2: {
+    time_bench.build_heuristic += timed_fun_void([&] {
+      h_fun = std::make_shared<Heu_grid>(
+          robot, problem.goal, problem.p_lb, problem.p_ub,
+          options_dbastar.heu_grid_resolution,
+          make_worker_robots(problem, problem.robotType, robot,
+                             options_dbastar.num_threads_heu));
+    });
+  } break;
+  case 3: {
+    CHECK(options_dbastar.hlut_file.size(), "heuristic 3 requires hlut_file");
+    auto hlut = std::make_shared<Hlut>();
+    time_bench.build_heuristic += timed_fun_void([&] {
+      CHECK(hlut->read(options_dbastar.hlut_file),
+            "cannot read " + options_dbastar.hlut_file);
+    });
+    DYNO_CHECK_EQ(hlut->nx, robot->nx, AT);
+    // the table is only valid for the primitives and the expansion radius
+    // of the search
+    CHECK(options_dbastar.motionsFile.size(),
+          "heuristic 3 requires motionsFile");
+    const double radius = options_dbastar.alpha * options_dbastar.delta;
+    CHECK(hlut->hash == hlut_hash(options_dbastar.motionsFile,
+                                  problem.robotType, T_m.size(),
+                                  options_dbastar.cut_actions, radius),
+          options_dbastar.hlut_file +
+              " was built for other primitives (motionsFile, max_motions, "
+              "cut_actions), alpha or delta");
+    h_fun = std::make_shared<Heu_hlut>(robot, problem.goal, hlut);
+  } break;
+  case -1: {
+    h_fun = std::make_shared<Heu_blind>();
+  } break;
+  default: {
+    ERROR_WITH_INFO("not implemented");
+  }
+  }
+
+  return h_fun;
+}
+
+DbAStarPlanner::DbAStarPlanner(const dynobench::Problem &problem,
+                               const Options_dbastar &options_dbastar)
+    : problem(problem), options_dbastar(options_dbastar) {
 
   // Print the input option to the screen
   std::cout << "*** options_dbastar ***" << std::endl;
-  options_dbastar.print(std::cout);
+  this->options_dbastar.print(std::cout);
   std::cout << "***" << std::endl;
 
   // Create the robot model and load the environment
-  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+  robot = dynobench::robot_factory(
       (problem.models_base_path + problem.robotType + ".yaml").c_str(),
       problem.p_lb, problem.p_ub);
   load_env(*robot, problem);
-  const int nx = robot->nx;
 
   // Get the motions primitive from the input options! Motion primitives should
   // be loaded before -- see tests.
@@ -553,119 +669,230 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
 
   assert(check_motions());
 
-  // Struct to store timing information
-  Time_benchmark time_bench;
+  if (options_dbastar.alpha <= 0 || options_dbastar.alpha >= 1) {
+    ERROR_WITH_INFO("Alpha needs to be between 0 and 1!");
+  }
 
-  // build kd-tree for motion primitives
-  ompl::NearestNeighbors<Motion *> *T_m = nullptr;
-  ompl::NearestNeighbors<AStarNode *> *T_n = nullptr;
+  if (options_dbastar.delta < 0) {
+    NOT_IMPLEMENTED;
+  }
 
   // Nearest Neighbors for motion primitives
   if (options_dbastar.use_nigh_nn) {
     T_m = nigh_factory2<Motion *>(problem.robotType, robot);
   } else {
-    NOT_IMPLEMENTED;
+    T_m = grid_factory2<Motion *>(
+        problem.robotType, robot,
+        options_dbastar.alpha * options_dbastar.delta);
   }
 
-  time_bench.time_nearestMotion += timed_fun_void([&] {
+  time_bench_setup.time_nearestMotion += timed_fun_void([&] {
     for (size_t i = 0;
          i < std::min(motions.size(), options_dbastar.max_motions); ++i) {
       T_m->add(&motions.at(i));
     }
   });
 
-  // Nearest Neighbors for new states (will grow dinamically)
+  // Successors of each primitive (the expansion radius is fixed)
+  if (options_dbastar.successor_table) {
+    time_bench_setup.time_nearestMotion += timed_fun_void([&] {
+      successor_table = make_successor_table(
+          *robot, problem.robotType, *T_m,
+          options_dbastar.alpha * options_dbastar.delta,
+          options_dbastar.successor_table_dir);
+    });
+  }
+
+  // Nearest Neighbors for new states (will grow dinamically, and it is
+  // cleared at each query)
   if (options_dbastar.use_nigh_nn) {
-    T_n = nigh_factory2<AStarNode *>(problem.robotType, robot);
+    T_n = nigh_factory2<SearchNode *>(problem.robotType, robot);
   } else {
-    NOT_IMPLEMENTED;
+    // the novelty radius is fixed during the search
+    T_n = grid_factory2<SearchNode *>(
+        problem.robotType, robot,
+        (1. - options_dbastar.alpha) * options_dbastar.delta);
   }
 
-  // Helper Class used to expand a state with the motions primitives
-  Expander expander(robot.get(), T_m,
-                    options_dbastar.alpha * options_dbastar.delta);
-
-  if (options_dbastar.alpha <= 0 || options_dbastar.alpha >= 1) {
-    ERROR_WITH_INFO("Alpha needs to be between 0 and 1!");
+  update_heuristic(problem.goal);
+
+  // Parallel check of the primitives of one expansion (num_threads_check >
+  // 1). Candidates are checked in chunks of check_chunk, one TrajWrapper per
+  // candidate. The results are consumed in order, as in the sequential case,
+  // so that novelty and branching factor are not affected.
+  if (options_dbastar.num_threads_check > 1) {
+    check_pool =
+        std::make_unique<Thread_pool>(options_dbastar.num_threads_check);
+    check_chunk = check_pool->size();
+    check_workers.resize(check_pool->size());
+    for (size_t i = 0; i < check_workers.size(); i++) {
+      auto &worker = check_workers[i];
+      if (i == 0) {
+        // the calling thread is worker 0
+        worker.robot = robot;
+      } else {
+        worker.robot = dynobench::robot_factory(
+            (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+            problem.p_lb, problem.p_ub);
+        load_env(*worker.robot, problem);
+      }
+      worker.aux_last_state.resize(robot->nx);
+      dynobench::Model_robot *worker_robot = worker.robot.get();
+      worker.is_state_valid = [worker_robot](Eigen::Ref<Eigen::VectorXd> x) {
+        return worker_robot->is_state_valid(x);
+      };
+    }
+    check_trajs.resize(check_chunk);
+    check_valid.resize(check_chunk);
   }
 
-  if (options_dbastar.delta < 0) {
-    NOT_IMPLEMENTED;
+  // For runtime efficiency, we allocate memory for longest possible
+  // Motion primitives
+  {
+    std::vector<Motion *> motions;
+    T_m->list(motions);
+    size_t max_traj_size = (*std::max_element(motions.begin(), motions.end(),
+                                              [](Motion *a, Motion *b) {
+                                                return a->traj.states.size() <
+                                                       b->traj.states.size();
+                                              }))
+                               ->traj.states.size();
+
+    traj_wrapper.allocate_size(max_traj_size, robot->nx, robot->nu);
+    for (auto &tw : check_trajs) {
+      tw.allocate_size(max_traj_size, robot->nx, robot->nu);
+    }
   }
 
-  // Set up the heuristic function used to guide the search
-  std::shared_ptr<Heu_fun> h_fun = nullptr;
-  std::vector<Heuristic_node> heu_map;
+  node_pool = std::make_unique<NodePool>(robot->nx);
+  open_list = make_open_list(options_dbastar.open_list,
+                             options_dbastar.open_bucket_width);
+}
 
-  switch (options_dbastar.heuristic) {
-  case 0: {
-    h_fun = std::make_shared<Heu_euclidean>(robot, problem.goal);
-  } break;
-  case 1: {
-    if (options_dbastar.heu_map_ptr) {
-      std::cout << "Heuristic map is already loaded" << std::endl;
-    } else {
-      if (options_dbastar.heu_map_file.size()) {
-        std::cout << "loading map from file " << std::endl;
-        load_heu_map(options_dbastar.heu_map_file.c_str(), heu_map);
-      } else {
-        std::cout << "not heu map provided. Computing one .... " << std::endl;
-        time_bench.build_heuristic += timed_fun_void([&] {
-          generate_heuristic_map(problem, robot, options_dbastar, heu_map);
-        });
-        auto filename = "/tmp/dynoplan/tmp_heu_map.yaml";
-        create_dir_if_necessary(filename);
-        write_heu_map(heu_map, filename);
-      }
-      options_dbastar.heu_map_ptr = &heu_map;
-    }
+DbAStarPlanner::~DbAStarPlanner() {
+  delete T_m;
+  delete T_n;
+}
 
-    auto hh = std::make_shared<Heu_roadmap>(robot, *options_dbastar.heu_map_ptr,
-                                            problem.goal, problem.robotType);
-    hh->connect_radius_h = options_dbastar.connect_radius_h;
-    h_fun = hh;
-  } break;
-  case -1: {
-    h_fun = std::make_shared<Heu_blind>();
-  } break;
-  default: {
-    ERROR_WITH_INFO("not implemented");
+void DbAStarPlanner::update_heuristic(const Eigen::VectorXd &goal) {
+  if (h_fun && h_fun_goal.size() == goal.size() && h_fun_goal == goal) {
+    return;
+  }
+
+  // The roadmap has the cost-to-go to the previous goal. A roadmap of the
+  // user (heu_map_ptr, heu_map_file) is also for that goal, so it is
+  // replaced by one computed for the new goal.
+  if (h_fun && options_dbastar.heuristic == 1) {
+    heu_map.clear();
+    options_dbastar.heu_map_ptr = nullptr;
+    options_dbastar.heu_map_file = "";
   }
+  problem.goal = goal;
+  h_fun = make_heuristic(problem, robot, options_dbastar, *T_m, heu_map,
+                         time_bench_setup);
+  h_fun_goal = goal;
+}
+
+/** @brief Discontiuity Bounded A* search.
+ * See the TRO paper for more details:
+ * https://arxiv.org/abs/2311.03553
+ *
+ * Only the search runs here: robot, environment, primitives and heuristic
+ * are prepared in the constructor. The first query (and a query that changes
+ * the goal) reports the setup time in time_nearestMotion and
+ * build_heuristic.
+ *
+ * With options_dbastar.anytime, the search is ARA*-like: it returns a first
+ * solution with an inflated heuristic and improves it until the weight is 1
+ * or the time limit is reached. Every improved solution is reported to
+ * options_dbastar.anytime_callback.
+ *
+ * @param start: Start state
+ * @param goal: Goal state
+ * @param traj_out: The output trajectory (as out argument)
+ * @param out_info_db: The output info (as out argument)
+ * @param budget_ms: Time limit of the search. If <= 0, use
+ * options_dbastar.search_timelimit
+ */
+void DbAStarPlanner::plan(const Eigen::VectorXd &start,
+                          const Eigen::VectorXd &goal, Trajectory &traj_out,
+                          Out_info_db &out_info_db, double budget_ms) {
+
+  problem.start = start;
+  update_heuristic(goal);
+
+  std::vector<Motion> &motions = *options_dbastar.motions_ptr;
+  const double search_timelimit =
+      budget_ms > 0 ? budget_ms : options_dbastar.search_timelimit;
+
+  // Struct to store timing information
+  Time_benchmark time_bench = time_bench_setup;
+  time_bench_setup = Time_benchmark();
+  for (auto &worker : check_workers) {
+    worker.time_bench = Time_benchmark();
   }
 
+  // Helper Class used to expand a state with the motions primitives
+  Expander expander(robot.get(), T_m,
+                    options_dbastar.alpha * options_dbastar.delta);
+  expander.successor_table = successor_table.get();
+
+  // Clear the search of the previous query
+  T_n->clear();
+  node_pool->clear();
+
   //
-  // Conventions: the vector all_nodes will own the memory.
-  // c-pointer don't have onwership.
+  // Conventions: the node pool all_nodes will own the memory (nodes and
+  // states). c-pointer don't have onwership.
   //
 
   // Here we put all nodes that have been created during the search
-  std::vector<std::unique_ptr<AStarNode>> all_nodes;
-  all_nodes.push_back(std::make_unique<AStarNode>());
-
-  AStarNode *start_node = all_nodes.at(0).get();
+  NodePool &all_nodes = *node_pool;
+
+  // Anytime search (ARA*): the heuristic is inflated by weight >= 1. When a
+  // solution is found, the weight is decreased and the search continues with
+  // the nodes of the previous iterations: the open list is reordered and the
+  // nodes that were improved after being expanded (incons_list) are added
+  // back to it. Nodes that cannot improve the best solution are pruned.
+  const bool anytime = options_dbastar.anytime;
+  double weight =
+      anytime ? std::max(1., double(options_dbastar.anytime_weight)) : 1.;
+  SearchNode *best_solution = nullptr;
+  // cost of best_solution when it was reported. The node can be rewired
+  // later, its gScore is not the cost of the reported solution.
+  double best_cost = std::numeric_limits<double>::max();
+  double best_bound = -1; // suboptimality bound of best_solution
+  size_t anytime_solutions = 0;
+  std::vector<SearchNode *> incons_list;
+
+  SearchNode *start_node = all_nodes.allocate();
   start_node->gScore = 0;
   start_node->state_eig = problem.start;
   start_node->hScore = h_fun->h(problem.start);
-  start_node->fScore = start_node->gScore + start_node->hScore;
+  start_node->fScore = start_node->gScore + weight * start_node->hScore;
   start_node->came_from = nullptr;
   start_node->is_in_open = true;
 
   DYNO_CHECK_GEQ(start_node->hScore, 0, "hScore should be positive");
   DYNO_CHECK_LEQ(start_node->hScore, 1e5, "hScore should be bounded");
 
-  auto goal_node = std::make_unique<AStarNode>();
-  goal_node->state_eig = problem.goal;
+  Eigen::VectorXd goal_state = problem.goal;
+  SearchNode goal_node;
+  goal_node.bind(goal_state.data(), robot->nx);
 
   // Open list for the A* search  -- we use a heap
-  open_t open;
-  start_node->handle = open.push(start_node);
+  Open_list &open = *open_list;
+  open.clear();
+  open.push(start_node);
 
   Motion fakeMotion;
   fakeMotion.idx = -1;
   fakeMotion.traj.states.push_back(Eigen::VectorXd::Zero(robot->nx));
 
-  AStarNode tmp_node;
-  tmp_node.state_eig = Eigen::VectorXd::Zero(robot->nx);
+  // tmp_node is only used for queries to T_n. Its state is tmp_state.
+  Eigen::VectorXd tmp_state = Eigen::VectorXd::Zero(robot->nx);
+  SearchNode tmp_node;
+  tmp_node.bind(tmp_state.data(), robot->nx);
 
   double best_distance_to_goal =
       robot->distance(start_node->state_eig, problem.goal);
@@ -698,6 +925,63 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
   Stopwatch watch;
   Terminate_status status = Terminate_status::UNKNOWN;
 
+  // Start the next iteration of the anytime search
+  auto next_anytime_iteration = [&] {
+    weight = std::max(1., weight - options_dbastar.anytime_weight_step);
+    std::vector<SearchNode *> nodes;
+    open.list(nodes);
+    for (auto &n : incons_list) {
+      if (!n->is_in_open) {
+        n->is_in_open = true;
+        nodes.push_back(n);
+      }
+    }
+    incons_list.clear();
+    for (size_t i = 0; i < all_nodes.size(); i++) {
+      all_nodes[i]->is_closed = false;
+    }
+    open.clear();
+    for (auto &n : nodes) {
+      n->fScore = n->gScore + weight * n->hScore;
+      open.push(n);
+    }
+    std::cout << "anytime: new iteration with weight " << weight
+              << " open: " << open.size() << std::endl;
+  };
+
+  // Report a new solution of the anytime search. The bound is
+  // min(weight, cost / min(g + h)) over the open and incons nodes.
+  auto publish_anytime_solution = [&] {
+    double min_f = std::numeric_limits<double>::max();
+    std::vector<SearchNode *> nodes;
+    open.list(nodes);
+    for (auto &n : nodes) {
+      min_f = std::min(min_f, double(n->gScore + n->hScore));
+    }
+    for (auto &n : incons_list) {
+      min_f = std::min(min_f, double(n->gScore + n->hScore));
+    }
+    best_bound = weight;
+    if (min_f > 0 && min_f < std::numeric_limits<double>::max()) {
+      best_bound =
+          std::max(1., std::min(weight, best_solution->gScore / min_f));
+    }
+    best_cost = best_solution->gScore;
+    anytime_solutions++;
+    std::cout << "anytime: solution " << anytime_solutions
+              << " cost: " << best_solution->gScore
+              << " bound: " << best_bound << std::endl;
+    if (options_dbastar.anytime_callback) {
+      Trajectory traj;
+      from_solution_to_yaml_and_traj(*robot, motions, best_solution, problem,
+                                     traj);
+      traj.start = problem.start;
+      traj.goal = problem.goal;
+      traj.cost = traj.actions.size() * robot->ref_dt;
+      options_dbastar.anytime_callback(traj, best_bound);
+    }
+  };
+
   // Function to check if we should stop the search
   auto stop_search = [&] {
     if (static_cast<size_t>(time_bench.expands) >=
@@ -707,12 +991,23 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
       return true;
     }
 
-    if (watch.elapsed_ms() > options_dbastar.search_timelimit) {
+    if (watch.elapsed_ms() > search_timelimit) {
       status = Terminate_status::MAX_TIME;
       std::cout << "BREAK search:" << "MAX_TIME" << std::endl;
       return true;
     }
 
+    if (open.empty() && anytime && best_solution) {
+      // No node of this iteration can improve the solution.
+      if (incons_list.empty()) {
+        best_bound = 1;
+        status = Terminate_status::SOLVED;
+        std::cout << "BREAK search:" << "SOLVED" << std::endl;
+        return true;
+      }
+      next_anytime_iteration();
+    }
+
     if (open.empty()) {
       status = Terminate_status::EMPTY_QUEUE;
       std::cout << "BREAK search:" << "EMPTY_QUEUE" << std::endl;
@@ -722,9 +1017,9 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
     return false;
   };
 
-  AStarNode *best_node = nullptr;
-  std::vector<AStarNode *> closed_list;
-  std::vector<AStarNode *> neighbors_n;
+  SearchNode *best_node = nullptr;
+  std::vector<SearchNode *> closed_list;
+  std::vector<SearchNode *> neighbors_n;
   std::vector<Trajectory> expanded_trajs; // for debugging
 
   const bool debug = false; // Set to true to write save to disk a lot of stuff
@@ -741,27 +1036,48 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
         return robot->is_state_valid(state);
       };
 
-  // Traj_wrapper is a wrapper around a trajectory. It is used to compute the
-  // expansion without allocating memory
-  dynobench::TrajWrapper traj_wrapper;
-
-  // For runtime efficiency, we allocate memory for longest possible
-  // Motion primitives
-  {
-    std::vector<Motion *> motions;
-    T_m->list(motions);
-    size_t max_traj_size = (*std::max_element(motions.begin(), motions.end(),
-                                              [](Motion *a, Motion *b) {
-                                                return a->traj.states.size() <
-                                                       b->traj.states.size();
-                                              }))
-                               ->traj.states.size();
-
-    traj_wrapper.allocate_size(max_traj_size, robot->nx, robot->nu);
-  }
+  // Check a chunk of candidates (starting at index first) in parallel
+  auto check_chunk_parallel = [&](std::vector<LazyTraj> &lazy_trajs,
+                                  size_t first) {
+    size_t num = std::min(check_chunk, lazy_trajs.size() - first);
+    check_pool->parallel_for(num, [&](size_t j, size_t w) {
+      auto &worker = check_workers[w];
+      LazyTraj lazy_traj = lazy_trajs[first + j];
+      lazy_traj.robot = worker.robot.get();
+      int num_valid_states = -1;
+      check_trajs[j].set_size(lazy_traj.motion->traj.states.size());
+      check_valid[j] = check_lazy_trajectory(
+          lazy_traj, *worker.robot, worker.time_bench, check_trajs[j],
+          worker.aux_last_state, &worker.is_state_valid, &num_valid_states);
+    });
+  };
 
   Eigen::VectorXd aux_last_state(robot->nx);
 
+  // Lazy edges: at generation, only the last state of a primitive is
+  // computed and checked against the bounds, and the node is pushed with an
+  // optimistic cost (without the discontinuity cost). The rollout and the
+  // collision check of the edge are done when the node is popped: an invalid
+  // node is discarded, a valid one is pushed again with its true cost if it
+  // was underestimated. The intermediate states of the checked edge are
+  // checked against the goal, as in the eager expansion. A node whose edge is
+  // not checked yet does not make its neighbours redundant (novelty).
+  const bool lazy_edges = options_dbastar.lazy_edges;
+  Eigen::VectorXd lazy_offset(robot->get_offset_dim());
+  Eigen::VectorXd lazy_goal_state(robot->nx);
+
+  // Full check of the edge (parent, motion), result in traj_wrapper
+  auto check_edge = [&](const SearchNode *parent, Motion *motion) {
+    robot->offset(parent->state_eig, lazy_offset);
+    LazyTraj lazy_traj{.offset = &lazy_offset, .robot = robot.get(),
+                       .motion = motion};
+    int num_valid_states = -1;
+    traj_wrapper.set_size(motion->traj.states.size());
+    return check_lazy_trajectory(lazy_traj, *robot, time_bench, traj_wrapper,
+                                 aux_last_state, &is_state_valid,
+                                 &num_valid_states);
+  };
+
   // Main loop of the search
   while (!stop_search()) {
 
@@ -770,9 +1086,67 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
       best_node = open.top();
       open.pop();
     });
+    best_node->is_in_open = false;
+
+    if (anytime && best_node->gScore + best_node->hScore >= best_cost) {
+      // prune: this node cannot improve the solution
+      continue;
+    }
+
+    if (lazy_edges && !best_node->edge_checked) {
+      const SearchNode *parent = best_node->came_from;
+      Motion *motion = &motions.at(best_node->used_motion);
+      best_node->edge_checked = true;
+      if (!check_edge(parent, motion)) {
+        // discard: the node stays in T_n, but it is ignored as neighbor
+        best_node->valid = false;
+        time_bench.num_lazy_invalid++;
+        continue;
+      }
+      const double cost_delta =
+          options_dbastar.cost_delta_factor *
+          robot->lower_bound_time(parent->state_eig, traj_wrapper.get_state(0));
+
+      int chosen_index = -1;
+      if (check_intermediate_goal) {
+        check_goal(*robot, lazy_goal_state, problem.goal, traj_wrapper,
+                   options_dbastar.delta_factor_goal * options_dbastar.delta,
+                   num_check_goal, chosen_index);
+      }
+      if (chosen_index != -1) {
+        // the intermediate state is a new node, as in the eager expansion
+        SearchNode *__node = all_nodes.allocate();
+        __node->state_eig = lazy_goal_state;
+        __node->gScore =
+            parent->gScore + chosen_index * robot->ref_dt + cost_delta;
+        time_bench.time_hfun += timed_fun_void(
+            [&] { __node->hScore = h_fun->h(lazy_goal_state); });
+        __node->fScore = __node->gScore + weight * __node->hScore;
+        __node->came_from = parent;
+        __node->used_motion = best_node->used_motion;
+        __node->intermediate_state = chosen_index;
+        __node->edge_checked = true;
+        __node->is_in_open = true;
+        time_bench.time_queue += timed_fun_void([&] { open.push(__node); });
+        time_bench.time_nearestNode_add +=
+            timed_fun_void([&] { T_n->add(__node); });
+      }
+
+      double gScore = parent->gScore +
+                      (traj_wrapper.get_size() - 1) * robot->ref_dt +
+                      cost_delta;
+      if (gScore > best_node->gScore) {
+        best_node->gScore = gScore;
+        best_node->fScore = gScore + weight * best_node->hScore;
+        best_node->is_in_open = true;
+        time_bench.time_queue += timed_fun_void([&] { open.push(best_node); });
+        continue;
+      }
+    }
+
     last_f_score = best_node->fScore;
     closed_list.push_back(best_node);
-    best_node->is_in_open = false;
+    best_node->is_closed = true;
 
     if (time_bench.expands % print_every == 0) {
       print_search_status();
@@ -796,34 +1170,77 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
                 << std::endl;
       std::cout << "x: " << best_node->state_eig.format(FMT) << std::endl;
       std::cout << "d: " << distance_to_goal << std::endl;
-      status = Terminate_status::SOLVED;
-      break;
+      if (!anytime) {
+        status = Terminate_status::SOLVED;
+        break;
+      }
+      best_solution = best_node;
+      publish_anytime_solution();
+      if (weight <= 1.) {
+        status = Terminate_status::SOLVED;
+        break;
+      }
+      next_anytime_iteration();
+      continue;
     }
 
     // EXPAND The node using motion primitives
     size_t num_expansion_best_node = 0;
     std::vector<LazyTraj> lazy_trajs;
-    time_bench.time_lazy_expand += timed_fun_void(
-        [&] { expander.expand_lazy(best_node->state_eig, lazy_trajs); });
+    time_bench.time_lazy_expand += timed_fun_void([&] {
+      expander.expand_lazy(best_node->state_eig, lazy_trajs,
+                           best_node->came_from ? best_node->used_motion : -1);
+    });
 
     for (size_t i = 0; i < lazy_trajs.size(); i++) {
       auto &lazy_traj = lazy_trajs[i];
 
-      int num_valid_states = -1;
-      traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
-
       // check collisions and bounds
-      bool motion_valid = check_lazy_trajectory(
-          lazy_traj, *robot, time_bench, traj_wrapper, aux_last_state,
-          &is_state_valid, &num_valid_states);
+      bool motion_valid;
+      bool edge_checked = true;
+      dynobench::TrajWrapper *checked_traj = &traj_wrapper;
+      if (lazy_edges) {
+        // only the bounds of the last state
+        edge_checked = false;
+        if (robot->transform_primitive_last_state_available) {
+          time_bench.time_transform_primitive += timed_fun_void([&] {
+            robot->transform_primitive_last_state(
+                *lazy_traj.offset, lazy_traj.motion->traj.states,
+                lazy_traj.motion->traj.actions, tmp_state);
+          });
+        } else {
+          int num_valid_states = -1;
+          traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
+          time_bench.time_transform_primitive += timed_fun_void([&] {
+            lazy_traj.compute(traj_wrapper, true, &is_state_valid,
+                              &num_valid_states);
+          });
+          tmp_state = traj_wrapper.get_state(traj_wrapper.get_size() - 1);
+        }
+        time_bench.check_bounds += timed_fun_void(
+            [&] { motion_valid = robot->is_state_valid(tmp_state); });
+      } else if (check_pool) {
+        if (i % check_chunk == 0) {
+          time_bench.time_check_parallel +=
+              timed_fun_void([&] { check_chunk_parallel(lazy_trajs, i); });
+        }
+        motion_valid = check_valid[i % check_chunk];
+        checked_traj = &check_trajs[i % check_chunk];
+      } else {
+        int num_valid_states = -1;
+        traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
+        motion_valid = check_lazy_trajectory(
+            lazy_traj, *robot, time_bench, traj_wrapper, aux_last_state,
+            &is_state_valid, &num_valid_states);
+      }
 
       if (!motion_valid) {
         continue;
       }
 
       int chosen_index = -1;
-      if (check_intermediate_goal) {
-        check_goal(*robot, tmp_node.state_eig, problem.goal, traj_wrapper,
+      if (check_intermediate_goal && edge_checked) {
+        check_goal(*robot, tmp_state, problem.goal, *checked_traj,
                    options_dbastar.delta_factor_goal * options_dbastar.delta,
                    num_check_goal, chosen_index);
       }
@@ -831,20 +1248,24 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
       // Tentative hScore.
       double hScore;
       time_bench.time_hfun +=
-          timed_fun_void([&] { hScore = h_fun->h(tmp_node.state_eig); });
+          timed_fun_void([&] { hScore = h_fun->h(tmp_state); });
       assert(hScore >= 0);
 
-      double cost_motion = chosen_index != -1
-                               ? chosen_index * robot->ref_dt
-                               : (traj_wrapper.get_size() - 1) * robot->ref_dt;
+      double cost_motion =
+          chosen_index != -1
+              ? chosen_index * robot->ref_dt
+              : (lazy_traj.motion->traj.states.size() - 1) * robot->ref_dt;
 
       assert(cost_motion >= 0);
 
       // Tentative hScore.
-      double gScore = best_node->gScore + cost_motion +
-                      options_dbastar.cost_delta_factor *
-                          robot->lower_bound_time(best_node->state_eig,
-                                                  traj_wrapper.get_state(0));
+      double gScore =
+          best_node->gScore + cost_motion +
+          (edge_checked ? options_dbastar.cost_delta_factor *
+                              robot->lower_bound_time(
+                                  best_node->state_eig,
+                                  checked_traj->get_state(0))
+                        : 0.);
 
       // Check if new state is NOVEL (e.g. not close to any other state)
       time_bench.time_nearestNode_search += timed_fun_void([&] {
@@ -853,59 +1274,88 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
                       neighbors_n);
       });
 
-      if (!neighbors_n.size() || chosen_index != -1) {
+      if (lazy_edges) {
+        // nodes with an invalid edge are still in T_n
+        neighbors_n.erase(std::remove_if(neighbors_n.begin(), neighbors_n.end(),
+                                         [](auto &n) { return !n->valid; }),
+                          neighbors_n.end());
+      }
+      // a neighbour with an unchecked edge can still be invalid
+      const bool novel =
+          std::none_of(neighbors_n.begin(), neighbors_n.end(),
+                       [](auto &n) { return n->edge_checked; });
+
+      if (!edge_checked && neighbors_n.size() &&
+          std::any_of(neighbors_n.begin(), neighbors_n.end(), [&](auto &n) {
+            return gScore + robot->lower_bound_time(tmp_state, n->state_eig) <
+                   n->gScore;
+          })) {
+        // Rewiring uses the exact cost and a checked edge
+        if (!check_edge(best_node, lazy_traj.motion)) {
+          continue;
+        }
+        edge_checked = true;
+        gScore += options_dbastar.cost_delta_factor *
+                  robot->lower_bound_time(best_node->state_eig,
+                                          traj_wrapper.get_state(0));
+      }
+
+      if (novel || chosen_index != -1) {
         // This state is novel or we have found a solution with intermediate
         // state!
         num_expansion_best_node++;
-        all_nodes.push_back(std::make_unique<AStarNode>());
-        AStarNode *__node = all_nodes.back().get();
-        __node->state_eig = tmp_node.state_eig;
+        SearchNode *__node = all_nodes.allocate();
+        __node->state_eig = tmp_state;
         __node->gScore = gScore;
         __node->hScore = hScore;
-        __node->fScore = gScore + hScore;
+        __node->fScore = gScore + weight * hScore;
         __node->came_from = best_node;
         __node->used_motion = lazy_traj.motion->idx;
         if (chosen_index != -1)
           __node->intermediate_state = chosen_index;
+        __node->edge_checked = edge_checked;
         __node->is_in_open = true;
 
         // Adding the sate to the tree and to the open list
-        time_bench.time_queue +=
-            timed_fun_void([&] { __node->handle = open.push(__node); });
+        time_bench.time_queue += timed_fun_void([&] { open.push(__node); });
         time_bench.time_nearestNode_add +=
             timed_fun_void([&] { T_n->add(__node); });
 
-        if (debug) {
+        if (debug && edge_checked) {
           expanded_trajs.push_back(
-              dynobench::trajWrapper_2_Trajectory(traj_wrapper));
+              dynobench::trajWrapper_2_Trajectory(*checked_traj));
         }
 
-      } else {
+      } else if (edge_checked) {
         // The state is not novel. Check if we should update parent and cost of
         // previous states.
         for (auto &n : neighbors_n) {
           if (double tentative_g =
                   gScore +
-                  robot->lower_bound_time(tmp_node.state_eig, n->state_eig);
+                  robot->lower_bound_time(tmp_state, n->state_eig);
               tentative_g < n->gScore) {
 
             n->gScore = tentative_g;
-            n->fScore = tentative_g + n->hScore;
+            n->fScore = tentative_g + weight * n->hScore;
             n->came_from = best_node;
             n->used_motion = lazy_traj.motion->idx;
             n->intermediate_state = -1;
+            n->edge_checked = true;
             // NOTE: the motion is taken fully,
             // because otherwise it would
             // be novel and enter inside
             // the other if.
 
-            // Update the open list or reinsert
+            // Update the open list or reinsert. In the anytime search,
+            // nodes expanded in this iteration wait in incons_list.
             if (n->is_in_open) {
               time_bench.time_queue +=
-                  timed_fun_void([&] { open.increase(n->handle); });
+                  timed_fun_void([&] { open.increase(n); });
+            } else if (anytime && n->is_closed) {
+              incons_list.push_back(n);
             } else {
-              time_bench.time_queue +=
-                  timed_fun_void([&] { n->handle = open.push(n); });
+              n->is_in_open = true;
+              time_bench.time_queue += timed_fun_void([&] { open.push(n); });
             }
           }
         }
@@ -923,7 +1373,16 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
 
   // Setup the informatin about the timings
   time_bench.time_search = watch.elapsed_ms();
+  for (auto &worker : check_workers) {
+    // only the counters, times of the workers are included in
+    // time_check_parallel
+    time_bench.num_col_motions += worker.time_bench.num_col_motions;
+  }
   time_bench.time_nearestMotion += expander.time_in_nn;
+  time_bench.num_successor_table += expander.num_successor_table;
+  if (auto h_cached = std::dynamic_pointer_cast<Heu_cached>(h_fun)) {
+    h_cached->collect(time_bench);
+  }
   time_bench.time_nearestNode =
       time_bench.time_nearestNode_add + time_bench.time_nearestNode_search;
   time_bench.extra_time =
@@ -931,7 +1390,8 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
       time_bench.time_nearestNode_add - time_bench.time_nearestNode_search -
       time_bench.time_lazy_expand - time_bench.time_alloc_primitive -
       time_bench.time_transform_primitive - time_bench.time_queue -
-      time_bench.check_bounds - time_bench.time_hfun;
+      time_bench.check_bounds - time_bench.time_hfun -
+      time_bench.time_check_parallel;
 
   assert(time_bench.extra_time >= 0);
   assert(time_bench.extra_time / time_bench.time_search * 100 <
@@ -941,22 +1401,28 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
             << time_bench.extra_time / time_bench.time_search * 100 << "%"
             << std::endl;
 
+  Output_sink &sink = get_output_sink(options_dbastar.output_sink,
+                                      options_dbastar.output_mode);
+
   if (debug) {
-    std::ofstream out("/tmp/dynoplan/nodes_list.yaml");
-    out << "close_list:" << std::endl;
-    for (auto &c : closed_list) {
-      out << "- " << c->state_eig.format(dynobench::FMT) << std::endl;
-    }
-    out << "all_nodes:" << std::endl;
-    for (auto &c : all_nodes) {
-      out << "- " << c->state_eig.format(dynobench::FMT) << std::endl;
+    if (auto out = sink.open("/tmp/dynoplan/nodes_list.yaml")) {
+      *out << "close_list:" << std::endl;
+      for (auto &c : closed_list) {
+        *out << "- " << c->state_eig.format(dynobench::FMT) << std::endl;
+      }
+      *out << "all_nodes:" << std::endl;
+      for (size_t i = 0; i < all_nodes.size(); i++) {
+        *out << "- " << all_nodes[i]->state_eig.format(dynobench::FMT)
+             << std::endl;
+      }
     }
-    std::ofstream out2("/tmp/dynoplan/expanded_trajs.yaml");
 
-    out2 << "trajs:" << std::endl;
-    for (auto &traj : expanded_trajs) {
-      out2 << "  - " << std::endl;
-      traj.to_yaml_format(out2, "    ");
+    if (auto out2 = sink.open("/tmp/dynoplan/expanded_trajs.yaml")) {
+      *out2 << "trajs:" << std::endl;
+      for (auto &traj : expanded_trajs) {
+        *out2 << "  - " << std::endl;
+        traj.to_yaml_format(*out2, "    ");
+      }
     }
 
     {
@@ -973,46 +1439,56 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
   std::cout << "time_bench:" << std::endl;
   time_bench.write(std::cout);
 
-  AStarNode *solution = nullptr;
+  SearchNode *solution = nullptr;
+
+  if (anytime && best_solution) {
+    if (best_solution->gScore < best_cost) {
+      // improved by a rewire after it was reported
+      publish_anytime_solution();
+    }
+    // The search can be stopped by the time limit after a first solution
+    status = Terminate_status::SOLVED;
+    best_node = best_solution;
+  }
 
   if (status == Terminate_status::SOLVED) {
     solution = best_node;
     out_info_db.solved = true;
   } else {
     // If not solved, report the closest node to the goal
-    auto nearest = T_n->nearest(goal_node.get());
+    auto nearest = T_n->nearest(&goal_node);
     std::cout << "Close distance T_n to goal: "
-              << robot->distance(goal_node->getStateEig(),
+              << robot->distance(goal_node.getStateEig(),
                                  nearest->getStateEig())
               << std::endl;
     solution = nearest;
     out_info_db.solved = false;
   }
 
-  // write out information in yaml format
-  auto filename = "/tmp/dynoplan/dbastar_out.yaml";
-  create_dir_if_necessary(filename);
-  std::ofstream out(filename);
+  // write out information in yaml format (only if the sink keeps it)
+  auto out = sink.open("/tmp/dynoplan/dbastar_out.yaml");
+  if (out) {
+    *out << "solved: " << (status == Terminate_status::SOLVED) << std::endl;
+    *out << "problem: " << problem.name << std::endl;
+    *out << "robot: " << problem.robotType << std::endl;
+    *out << "status: " << static_cast<int>(status) << std::endl;
+    *out << "status_str: " << terminate_status_str[static_cast<int>(status)]
+         << std::endl;
+    *out << "all_nodes: " << all_nodes.size() << std::endl;
+    *out << "closed_list: " << closed_list.size() << std::endl;
+    *out << "gscore_sol: " << solution->gScore << std::endl;
+    *out << "distance_to_goal: "
+         << robot->distance(solution->getStateEig(), goal_node.getStateEig())
+         << std::endl;
+    time_bench.write(*out);
+    *out << "result:" << std::endl;
+  }
 
-  out << "solved: " << (status == Terminate_status::SOLVED) << std::endl;
-  out << "problem: " << problem.name << std::endl;
-  out << "robot: " << problem.robotType << std::endl;
-  out << "status: " << static_cast<int>(status) << std::endl;
-  out << "status_str: " << terminate_status_str[static_cast<int>(status)]
-      << std::endl;
-  out << "all_nodes: " << all_nodes.size() << std::endl;
-  out << "closed_list: " << closed_list.size() << std::endl;
-  out << "gscore_sol: " << solution->gScore << std::endl;
-  out << "distance_to_goal: "
-      << robot->distance(solution->getStateEig(), goal_node->getStateEig())
-      << std::endl;
-  time_bench.write(out);
-
-  out << "result:" << std::endl;
   // This function will write down the solution as a sequence
   // of states and controls
   from_solution_to_yaml_and_traj(*robot, motions, solution, problem, traj_out,
-                                 &out);
+                                 out.get());
+  out.reset();
   traj_out.start = problem.start;
   traj_out.goal = problem.goal;
   traj_out.check(robot, true);
@@ -1036,10 +1512,10 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
   {
     std::string filename_id =
         "/tmp/dynoplan/traj_db_" + gen_random(6) + ".yaml";
-    std::cout << "saving traj to: " << filename_id << std::endl;
-    create_dir_if_necessary(filename_id.c_str());
-    std::ofstream out(filename_id);
-    traj_out.to_yaml_format(out);
+    if (auto out = sink.open(filename_id)) {
+      std::cout << "saving traj to: " << filename_id << std::endl;
+      traj_out.to_yaml_format(*out);
+    }
   }
 
   // Write out the information in the database format
@@ -1055,12 +1531,39 @@ void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
       std::make_pair("delta", std::to_string(options_dbastar.delta)));
   out_info_db.data.insert(
       std::make_pair("num_primitives", std::to_string(motions.size())));
+  if (anytime) {
+    out_info_db.data.insert(std::make_pair(
+        "anytime_solutions", std::to_string(anytime_solutions)));
+    out_info_db.data.insert(
+        std::make_pair("anytime_bound", std::to_string(best_bound)));
+  }
+}
+
+/** @brief Discontiuity Bounded A* search.
+ * See the TRO paper for more details:
+ * https://arxiv.org/abs/2311.03553
+ *
+ * Use DbAStarPlanner to solve several queries in the same environment.
+ *
+ * @param problem: The motion planning problem
+ * @param options_dbastar: The options for the search
+ * @param traj_out: The output trajectory (as out argument)
+ * @param out_info_db: The output info (as out argument)
+ */
+void dbastar(const dynobench::Problem &problem, Options_dbastar options_dbastar,
+             Trajectory &traj_out, Out_info_db &out_info_db) {
+  DbAStarPlanner planner(problem, options_dbastar);
+  planner.plan(problem.start, problem.goal, traj_out, out_info_db);
 }
 
 void write_heu_map(const std::vector<Heuristic_node> &heu_map, const char *file,
                    const char *header) {
   std::ofstream out(file);
+  write_heu_map(heu_map, out, header);
+}
 
+void write_heu_map(const std::vector<Heuristic_node> &heu_map,
+                   std::ostream &out, const char *header) {
   if (header) {
     out << header << std::endl;
   }
@@ -1076,6 +1579,10 @@ void write_heu_map(const std::vector<Heuristic_node> &heu_map, const char *file,
 
 void load_heu_map(const char *file, std::vector<Heuristic_node> &heu_map) {
   std::cout << "loading heu map -- file: " << file << std::endl;
+  if (std::filesystem::path(file).extension() == ".bin") {
+    CHECK(load_heu_map_bin(file, heu_map), "cannot load heu map");
+    return;
+  }
   std::ifstream in(file);
   CHECK(in.is_open(), AT);
   YAML::Node node = YAML::LoadFile(file);
@@ -0,0 +1,506 @@
+#include "dynoplan/dbastar/dbastar.hpp"
+
+#include "dynobench/general_utils.hpp"
+#include "dynobench/motions.hpp"
+#include "dynobench/robot_models.hpp"
+
+#include "dynoplan/nigh_custom_spaces.hpp"
+#include "dynoplan/thread_pool.hpp"
+
+namespace dynoplan {
+
+using dynobench::FMT;
+using dynobench::Trajectory;
+
+// Valid successor of a node, computed by a worker.
+struct Candidate {
+  Eigen::VectorXd state;
+  double gScore;
+  uint32_t used_motion;
+  int intermediate_state;
+};
+
+// Node that is expanded in the current round, with its valid successors
+struct Expansion_slot {
+  SearchNode *node = nullptr;
+  int seed = 0;
+  std::vector<Candidate> candidates;
+  size_t num_candidates = 0;
+
+  Candidate &add_candidate(size_t nx) {
+    if (num_candidates == candidates.size()) {
+      candidates.push_back(Candidate{Eigen::VectorXd(nx), 0, 0, -1});
+    }
+    return candidates[num_candidates++];
+  }
+};
+
+// Scratch memory of one thread of dbastar_parallel. Each worker has its own
+// robot model (with the environment) and its own expander.
+struct Expand_worker {
+  std::shared_ptr<dynobench::Model_robot> robot;
+  std::unique_ptr<Expander> expander;
+  std::vector<LazyTraj> lazy_trajs;
+  dynobench::TrajWrapper traj_wrapper;
+  Eigen::VectorXd aux_last_state;
+  Eigen::VectorXd query_state;
+  SearchNode query_node;
+  std::vector<SearchNode *> neighbors;
+  std::function<bool(Eigen::Ref<Eigen::VectorXd>)> is_state_valid;
+  Time_benchmark time_bench;
+};
+
+/** @brief Parallel Discontiuity Bounded A*.
+ *
+ * K-best synchronous parallel expansion, with K the number of threads:
+ * in each round, the best K nodes of the open list are popped and expanded
+ * in parallel. Each thread checks the primitives (bounds and collisions)
+ * and filters successors that are neither novel nor improve the cost of a
+ * node of the previous rounds (the tree of nodes is not modified during the
+ * parallel phase). Then, the successors are added sequentially in the order
+ * of the popped nodes, using the same novelty and rewiring rules as dbastar.
+ * Thus, the result does not depend on the scheduling of the threads.
+ *
+ * The collision check does not modify the motion primitives, so that the
+ * same primitive can be checked from several threads.
+ *
+ * Same inputs and outputs as dbastar. Use options_dbastar.num_threads to
+ * choose the number of threads (0: all cores).
+ */
+void dbastar_parallel(const dynobench::Problem &problem,
+                      Options_dbastar options_dbastar, Trajectory &traj_out,
+                      Out_info_db &out_info_db) {
+
+  std::cout << "*** options_dbastar ***" << std::endl;
+  options_dbastar.print(std::cout);
+  std::cout << "***" << std::endl;
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+  load_env(*robot, problem);
+
+  CHECK(options_dbastar.motions_ptr,
+        "motions should be loaded before calling dbastar");
+  std::vector<Motion> &motions = *options_dbastar.motions_ptr;
+
+  if (options_dbastar.alpha <= 0 || options_dbastar.alpha >= 1) {
+    ERROR_WITH_INFO("Alpha needs to be between 0 and 1!");
+  }
+
+  if (options_dbastar.delta < 0) {
+    NOT_IMPLEMENTED;
+  }
+
+  Time_benchmark time_bench;
+
+  // Nearest Neighbors for motion primitives (as dbastar)
+  ompl::NearestNeighbors<Motion *> *T_m = nullptr;
+  if (options_dbastar.use_nigh_nn) {
+    T_m = nigh_factory2<Motion *>(problem.robotType, robot);
+  } else {
+    T_m = grid_factory2<Motion *>(
+        problem.robotType, robot,
+        options_dbastar.alpha * options_dbastar.delta);
+  }
+  time_bench.time_nearestMotion += timed_fun_void([&] {
+    for (size_t i = 0;
+         i < std::min(motions.size(), options_dbastar.max_motions); ++i) {
+      T_m->add(&motions.at(i));
+    }
+  });
+
+  std::unique_ptr<Successor_table> successor_table;
+  if (options_dbastar.successor_table) {
+    time_bench.time_nearestMotion += timed_fun_void([&] {
+      successor_table = make_successor_table(
+          *robot, problem.robotType, *T_m,
+          options_dbastar.alpha * options_dbastar.delta,
+          options_dbastar.successor_table_dir);
+    });
+  }
+
+  // the queries of the workers only read the tree (also the hash grid)
+  ompl::NearestNeighbors<SearchNode *> *T_n = nullptr;
+  if (options_dbastar.use_nigh_nn) {
+    T_n = nigh_factory2<SearchNode *>(problem.robotType, robot);
+  } else {
+    T_n = grid_factory2<SearchNode *>(
+        problem.robotType, robot,
+        (1. - options_dbastar.alpha) * options_dbastar.delta);
+  }
+
+  std::vector<Heuristic_node> heu_map;
+  std::shared_ptr<Heu_fun> h_fun =
+      make_heuristic(problem, robot, options_dbastar, *T_m, heu_map,
+                     time_bench);
+
+  size_t max_traj_size = 0;
+  for (size_t i = 0; i < std::min(motions.size(), options_dbastar.max_motions);
+       ++i) {
+    max_traj_size = std::max(max_traj_size, motions[i].traj.states.size());
+  }
+
+  Thread_pool pool(options_dbastar.num_threads);
+  const size_t num_threads = pool.size();
+  std::cout << "dbastar_parallel with threads: " << num_threads << std::endl;
+
+  std::vector<Expand_worker> workers(num_threads);
+  for (size_t i = 0; i < num_threads; i++) {
+    auto &worker = workers[i];
+    if (i == 0) {
+      worker.robot = robot;
+    } else {
+      worker.robot = dynobench::robot_factory(
+          (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+          problem.p_lb, problem.p_ub);
+      load_env(*worker.robot, problem);
+    }
+    worker.expander = std::make_unique<Expander>(
+        worker.robot.get(), T_m, options_dbastar.alpha * options_dbastar.delta);
+    worker.expander->successor_table = successor_table.get();
+    worker.traj_wrapper.allocate_size(max_traj_size, robot->nx, robot->nu);
+    worker.aux_last_state.resize(robot->nx);
+    worker.query_state = Eigen::VectorXd::Zero(robot->nx);
+    worker.query_node.bind(worker.query_state.data(), robot->nx);
+    dynobench::Model_robot *worker_robot = worker.robot.get();
+    worker.is_state_valid = [worker_robot](Eigen::Ref<Eigen::VectorXd> x) {
+      return worker_robot->is_state_valid(x);
+    };
+  }
+
+  NodePool all_nodes(robot->nx);
+
+  SearchNode *start_node = all_nodes.allocate();
+  start_node->gScore = 0;
+  start_node->state_eig = problem.start;
+  start_node->hScore = h_fun->h(problem.start);
+  start_node->fScore = start_node->gScore + start_node->hScore;
+  start_node->came_from = nullptr;
+  start_node->is_in_open = true;
+
+  Eigen::VectorXd goal_state = problem.goal;
+  SearchNode goal_node;
+  goal_node.bind(goal_state.data(), robot->nx);
+
+  std::unique_ptr<Open_list> open_list = make_open_list(
+      options_dbastar.open_list, options_dbastar.open_bucket_width);
+  Open_list &open = *open_list;
+  open.push(start_node);
+  T_n->add(start_node);
+
+  Eigen::VectorXd tmp_state = Eigen::VectorXd::Zero(robot->nx);
+  SearchNode tmp_node;
+  tmp_node.bind(tmp_state.data(), robot->nx);
+
+  if (options_dbastar.fix_seed) {
+    srand(0);
+  } else {
+    srand(time(0));
+  }
+
+  const double goal_bound =
+      options_dbastar.delta_factor_goal * options_dbastar.delta;
+  const double novelty_radius =
+      (1. - options_dbastar.alpha) * options_dbastar.delta;
+  const size_t num_check_goal = 4;
+  const size_t limit_branching_factor = options_dbastar.limit_branching_factor;
+
+  double best_distance_to_goal =
+      robot->distance(start_node->state_eig, problem.goal);
+  double last_f_score = start_node->fScore;
+
+  const size_t print_every = 1000;
+  auto print_search_status = [&] {
+    std::cout << "expands: " << time_bench.expands << " open: " << open.size()
+              << " best distance: " << best_distance_to_goal
+              << " fscore: " << last_f_score << std::endl;
+  };
+
+  Stopwatch watch;
+  Terminate_status status = Terminate_status::UNKNOWN;
+
+  auto stop_search = [&] {
+    if (static_cast<size_t>(time_bench.expands) >=
+        options_dbastar.max_expands) {
+      status = Terminate_status::MAX_EXPANDS;
+      std::cout << "BREAK search:" << "MAX_EXPANDS" << std::endl;
+      return true;
+    }
+
+    if (watch.elapsed_ms() > options_dbastar.search_timelimit) {
+      status = Terminate_status::MAX_TIME;
+      std::cout << "BREAK search:" << "MAX_TIME" << std::endl;
+      return true;
+    }
+
+    if (open.empty()) {
+      status = Terminate_status::EMPTY_QUEUE;
+      std::cout << "BREAK search:" << "EMPTY_QUEUE" << std::endl;
+      return true;
+    }
+
+    return false;
+  };
+
+  // Parallel phase: expand and check the node of one slot
+  std::vector<Expansion_slot> slots(num_threads);
+  auto expand_slot = [&](size_t k, size_t w) {
+    auto &worker = workers[w];
+    auto &slot = slots[k];
+    const SearchNode *node = slot.node;
+    slot.num_candidates = 0;
+
+    if (options_dbastar.fix_seed) {
+      worker.expander->seed(slot.seed);
+    }
+
+    worker.lazy_trajs.clear();
+    worker.time_bench.time_lazy_expand += timed_fun_void([&] {
+      worker.expander->expand_lazy(node->state_eig, worker.lazy_trajs,
+                                   node->came_from ? node->used_motion : -1);
+    });
+
+    size_t num_novel = 0;
+    for (auto &lazy_traj : worker.lazy_trajs) {
+      int num_valid_states = -1;
+      worker.traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
+      bool motion_valid = check_lazy_trajectory(
+          lazy_traj, *worker.robot, worker.time_bench, worker.traj_wrapper,
+          worker.aux_last_state, &worker.is_state_valid, &num_valid_states,
+          true, true);
+
+      if (!motion_valid) {
+        continue;
+      }
+
+      int chosen_index = -1;
+      check_goal(*worker.robot, worker.query_state, problem.goal,
+                 worker.traj_wrapper, goal_bound, num_check_goal,
+                 chosen_index);
+
+      double cost_motion =
+          chosen_index != -1
+              ? chosen_index * robot->ref_dt
+              : (worker.traj_wrapper.get_size() - 1) * robot->ref_dt;
+
+      double gScore =
+          node->gScore + cost_motion +
+          options_dbastar.cost_delta_factor *
+              worker.robot->lower_bound_time(
+                  node->state_eig, worker.traj_wrapper.get_state(0));
+
+      // Filter with the nodes of previous rounds. If the state is not novel
+      // now, it will not be novel later.
+      worker.time_bench.time_nearestNode_search += timed_fun_void([&] {
+        T_n->nearestR(&worker.query_node, novelty_radius, worker.neighbors);
+      });
+
+      bool novel = !worker.neighbors.size() || chosen_index != -1;
+      if (!novel) {
+        bool improves = false;
+        for (auto &n : worker.neighbors) {
+          if (gScore + worker.robot->lower_bound_time(worker.query_state,
+                                                      n->state_eig) <
+              n->gScore) {
+            improves = true;
+            break;
+          }
+        }
+        if (!improves) {
+          continue;
+        }
+      }
+
+      Candidate &candidate = slot.add_candidate(robot->nx);
+      candidate.state = worker.query_state;
+      candidate.gScore = gScore;
+      candidate.used_motion = lazy_traj.motion->idx;
+      candidate.intermediate_state = chosen_index;
+
+      if (novel && ++num_novel >= limit_branching_factor) {
+        break;
+      }
+    }
+  };
+
+  SearchNode *best_node = nullptr;
+  std::vector<SearchNode *> closed_list;
+  std::vector<SearchNode *> neighbors_n;
+
+  while (!stop_search()) {
+
+    // POP the best nodes
+    size_t num_slots = 0;
+    while (num_slots < num_threads && !open.empty() &&
+           static_cast<size_t>(time_bench.expands) <
+               options_dbastar.max_expands) {
+
+      time_bench.time_queue += timed_fun_void([&] {
+        best_node = open.top();
+        open.pop();
+      });
+      last_f_score = best_node->fScore;
+      closed_list.push_back(best_node);
+      best_node->is_in_open = false;
+
+      if (time_bench.expands % print_every == 0) {
+        print_search_status();
+      }
+
+      time_bench.expands++;
+
+      double distance_to_goal =
+          robot->distance(best_node->state_eig, problem.goal);
+
+      if (distance_to_goal < best_distance_to_goal) {
+        best_distance_to_goal = distance_to_goal;
+      }
+
+      if (distance_to_goal < goal_bound) {
+        std::cout << "FOUND SOLUTION" << std::endl;
+        std::cout << "COST: " << best_node->gScore + best_node->hScore
+                  << std::endl;
+        std::cout << "x: " << best_node->state_eig.format(FMT) << std::endl;
+        std::cout << "d: " << distance_to_goal << std::endl;
+        status = Terminate_status::SOLVED;
+        break;
+      }
+
+      slots[num_slots].node = best_node;
+      slots[num_slots].seed = time_bench.expands;
+      num_slots++;
+    }
+
+    if (status == Terminate_status::SOLVED) {
+      break;
+    }
+
+    time_bench.time_check_parallel += timed_fun_void(
+        [&] { pool.parallel_for(num_slots, expand_slot); });
+
+    // Sequential phase: add the successors in a deterministic order
+    for (size_t k = 0; k < num_slots; k++) {
+      auto &slot = slots[k];
+      size_t num_expansion_node = 0;
+      for (size_t i = 0; i < slot.num_candidates; i++) {
+        auto &candidate = slot.candidates[i];
+        tmp_state = candidate.state;
+
+        time_bench.time_nearestNode_search += timed_fun_void([&] {
+          T_n->nearestR(&tmp_node, novelty_radius, neighbors_n);
+        });
+
+        if (!neighbors_n.size() || candidate.intermediate_state != -1) {
+          double hScore;
+          time_bench.time_hfun +=
+              timed_fun_void([&] { hScore = h_fun->h(tmp_state); });
+          assert(hScore >= 0);
+
+          num_expansion_node++;
+          SearchNode *__node = all_nodes.allocate();
+          __node->state_eig = tmp_state;
+          __node->gScore = candidate.gScore;
+          __node->hScore = hScore;
+          __node->fScore = candidate.gScore + hScore;
+          __node->came_from = slot.node;
+          __node->used_motion = candidate.used_motion;
+          __node->intermediate_state = candidate.intermediate_state;
+          __node->is_in_open = true;
+
+          time_bench.time_queue += timed_fun_void([&] { open.push(__node); });
+          time_bench.time_nearestNode_add +=
+              timed_fun_void([&] { T_n->add(__node); });
+        } else {
+          for (auto &n : neighbors_n) {
+            if (double tentative_g =
+                    candidate.gScore +
+                    robot->lower_bound_time(tmp_state, n->state_eig);
+                tentative_g < n->gScore) {
+
+              n->gScore = tentative_g;
+              n->fScore = tentative_g + n->hScore;
+              n->came_from = slot.node;
+              n->used_motion = candidate.used_motion;
+              n->intermediate_state = -1;
+
+              if (n->is_in_open) {
+                time_bench.time_queue +=
+                    timed_fun_void([&] { open.increase(n); });
+              } else {
+                n->is_in_open = true;
+                time_bench.time_queue += timed_fun_void([&] { open.push(n); });
+              }
+            }
+          }
+        }
+
+        if (num_expansion_node >= limit_branching_factor) {
+          break;
+        }
+      }
+    }
+  }
+
+  time_bench.time_search = watch.elapsed_ms();
+  for (auto &worker : workers) {
+    // the times of the workers are included in time_check_parallel
+    time_bench.num_col_motions += worker.time_bench.num_col_motions;
+    time_bench.time_nearestMotion += worker.expander->time_in_nn;
+    time_bench.num_successor_table += worker.expander->num_successor_table;
+  }
+  if (auto h_cached = std::dynamic_pointer_cast<Heu_cached>(h_fun)) {
+    h_cached->collect(time_bench);
+  }
+  time_bench.time_nearestNode =
+      time_bench.time_nearestNode_add + time_bench.time_nearestNode_search;
+  time_bench.extra_time = time_bench.time_search - time_bench.time_queue -
+                          time_bench.time_hfun -
+                          time_bench.time_nearestNode -
+                          time_bench.time_check_parallel;
+
+  std::cout << "Terminate status: " << static_cast<int>(status) << " "
+            << terminate_status_str[static_cast<int>(status)] << std::endl;
+  std::cout << "time_bench:" << std::endl;
+  time_bench.write(std::cout);
+
+  SearchNode *solution = nullptr;
+  if (status == Terminate_status::SOLVED) {
+    solution = best_node;
+  } else {
+    solution = T_n->nearest(&goal_node);
+    std::cout << "Close distance T_n to goal: "
+              << robot->distance(goal_node.getStateEig(),
+                                 solution->getStateEig())
+              << std::endl;
+  }
+
+  from_solution_to_yaml_and_traj(*robot, motions, solution, problem, traj_out);
+  traj_out.start = problem.start;
+  traj_out.goal = problem.goal;
+  traj_out.check(robot, true);
+  traj_out.cost = traj_out.actions.size() * robot->ref_dt;
+  traj_out.update_feasibility(dynobench::Feasibility_thresholds(), true);
+
+  out_info_db.solved = status == Terminate_status::SOLVED;
+  out_info_db.cost = traj_out.cost;
+  out_info_db.time_search = time_bench.time_search;
+  out_info_db.data = time_bench.to_data();
+  out_info_db.data.insert(std::make_pair(
+      "terminate_status", terminate_status_str[static_cast<int>(status)]));
+  out_info_db.data.insert(
+      std::make_pair("solved", std::to_string(bool(out_info_db.solved))));
+  out_info_db.data.insert(
+      std::make_pair("delta", std::to_string(options_dbastar.delta)));
+  out_info_db.data.insert(
+      std::make_pair("num_primitives", std::to_string(motions.size())));
+  out_info_db.data.insert(
+      std::make_pair("num_threads", std::to_string(num_threads)));
+  out_info_db.data.insert(
+      std::make_pair("all_nodes", std::to_string(all_nodes.size())));
+
+  delete T_m;
+  delete T_n;
+}
+
+} // namespace dynoplan
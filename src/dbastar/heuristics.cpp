@@ -1,8 +1,35 @@
 #include "dynoplan/dbastar/heuristics.hpp"
+#include "dynoplan/fnv_hash.hpp"
 #include "dynoplan/nigh_custom_spaces.hpp"
+#include "dynoplan/thread_pool.hpp"
+#include "dynoplan/tmp_file.hpp"
+
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <queue>
 
 namespace dynoplan {
 
+std::vector<std::shared_ptr<dynobench::Model_robot>>
+make_worker_robots(const dynobench::Problem &problem,
+                   const std::string &robot_type,
+                   std::shared_ptr<dynobench::Model_robot> robot,
+                   size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<std::shared_ptr<dynobench::Model_robot>> worker_robots{robot};
+  for (size_t i = 1; i < num_threads; i++) {
+    worker_robots.push_back(dynobench::robot_factory(
+        (problem.models_base_path + robot_type + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub));
+    load_env(*worker_robots.back(), problem);
+  }
+  return worker_robots;
+}
+
 void generate_heuristic_map(const dynobench::Problem &problem,
                             std::shared_ptr<dynobench::Model_robot> robot,
                             const Options_dbastar &options_dbastar,
@@ -38,9 +65,457 @@ void generate_heuristic_map(const dynobench::Problem &problem,
   __goal.segment(nx_pr, nx - nx_pr).setZero();
   samples.push_back(__goal); // important! goal should be the last one!!
 
+  // one robot (with the environment) per thread for the collision checks
+  auto worker_robots = make_worker_robots(
+      problem, problem.robotType, robot, options_dbastar.num_threads_heu);
+
   build_heuristic_distance_new(samples, robot, heu_map,
                                options_dbastar.heu_connection_radius,
-                               options_dbastar.heu_resolution);
+                               options_dbastar.heu_resolution,
+                               problem.robotType, worker_robots);
+}
+
+// Binary heuristic map: header, then the arrays x (n * nx), d (n) and p (n).
+// All the arrays are 8-byte aligned, so that the file can be mapped in
+// memory.
+static const char heu_map_magic[8] = "DBHEU01";
+
+struct Heu_map_header {
+  char magic[8];
+  uint64_t hash;
+  uint64_t n;
+  uint64_t nx;
+};
+
+void write_heu_map_bin(const std::vector<Heuristic_node> &heu_map,
+                       const std::string &file, uint64_t hash) {
+
+  create_dir_if_necessary(file.c_str());
+  Heu_map_header header;
+  std::copy(heu_map_magic, heu_map_magic + 8, header.magic);
+  header.hash = hash;
+  header.n = heu_map.size();
+  header.nx = heu_map.size() ? heu_map.front().x.size() : 0;
+
+  std::vector<double> xs(header.n * header.nx);
+  std::vector<double> ds(header.n);
+  std::vector<int32_t> ps(header.n);
+  for (size_t i = 0; i < heu_map.size(); i++) {
+    DYNO_CHECK_EQ(static_cast<uint64_t>(heu_map[i].x.size()), header.nx, AT);
+    Eigen::VectorXd::Map(xs.data() + i * header.nx, header.nx) = heu_map[i].x;
+    ds[i] = heu_map[i].d;
+    ps[i] = heu_map[i].p;
+  }
+
+  // write to a tmp file first, so that a concurrent reader never sees a
+  // partial map
+  std::string tmp_file = tmp_file_name(file);
+  {
+    std::ofstream out(tmp_file, std::ios::binary);
+    CHECK(out.good(), "cannot write " + tmp_file);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(xs.data()),
+              xs.size() * sizeof(double));
+    out.write(reinterpret_cast<const char *>(ds.data()),
+              ds.size() * sizeof(double));
+    out.write(reinterpret_cast<const char *>(ps.data()),
+              ps.size() * sizeof(int32_t));
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+bool load_heu_map_bin(const std::string &file,
+                      std::vector<Heuristic_node> &heu_map,
+                      uint64_t expected_hash) {
+
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    return false;
+  }
+
+  Heu_map_header header;
+  in.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!in.good() ||
+      !std::equal(heu_map_magic, heu_map_magic + 8, header.magic)) {
+    std::cout << "WARNING: " << file << " is not a binary heu map"
+              << std::endl;
+    return false;
+  }
+  if (expected_hash && header.hash != expected_hash) {
+    std::cout << "WARNING: heu map " << file << " has a different hash"
+              << std::endl;
+    return false;
+  }
+
+  // n and nx come from the file: check them against its size before
+  // allocating
+  const uint64_t size_data =
+      std::filesystem::file_size(file) - sizeof(header);
+  const uint64_t size_node = sizeof(double) + sizeof(int32_t);
+  if (header.n > size_data / size_node ||
+      (header.n && header.nx > size_data / header.n / sizeof(double)) ||
+      header.n * (header.nx * sizeof(double) + size_node) != size_data) {
+    std::cout << "WARNING: heu map " << file << " has a wrong size"
+              << std::endl;
+    return false;
+  }
+
+  std::vector<double> xs(header.n * header.nx);
+  std::vector<double> ds(header.n);
+  std::vector<int32_t> ps(header.n);
+  in.read(reinterpret_cast<char *>(xs.data()), xs.size() * sizeof(double));
+  in.read(reinterpret_cast<char *>(ds.data()), ds.size() * sizeof(double));
+  in.read(reinterpret_cast<char *>(ps.data()), ps.size() * sizeof(int32_t));
+  CHECK(in.good(), "corrupted heu map " + file);
+
+  heu_map.clear();
+  heu_map.reserve(header.n);
+  for (size_t i = 0; i < header.n; i++) {
+    heu_map.push_back(
+        {Eigen::VectorXd::Map(xs.data() + i * header.nx, header.nx), ds[i],
+         ps[i]});
+  }
+  return true;
+}
+
+uint64_t heu_map_hash(const dynobench::Problem &problem,
+                      const Options_dbastar &options_dbastar) {
+
+  // the obstacles are only known through the file of the problem
+  auto add_file = [](Fnv_hash &h, const std::string &file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.good()) {
+      return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    h.add(ss.str());
+    return true;
+  };
+
+  Fnv_hash h;
+  if (!add_file(h, problem.file) ||
+      !add_file(h, problem.models_base_path + problem.robotType + ".yaml")) {
+    return 0;
+  }
+  h.add(problem.robotType);
+  // the start is a sample of the map, connected on purpose
+  h.add(problem.start);
+  h.add(problem.goal);
+  h.add(problem.p_lb);
+  h.add(problem.p_ub);
+  h.add(static_cast<uint64_t>(options_dbastar.num_sample_trials));
+  h.add(static_cast<uint64_t>(options_dbastar.max_size_heu_map));
+  h.add(options_dbastar.heu_connection_radius);
+  h.add(options_dbastar.heu_resolution);
+  return h.value ? h.value : 1;
+}
+
+void generate_heuristic_map_cached(
+    const dynobench::Problem &problem,
+    std::shared_ptr<dynobench::Model_robot> robot,
+    const Options_dbastar &options_dbastar,
+    std::vector<Heuristic_node> &heu_map) {
+
+  std::string file;
+  uint64_t hash = 0;
+  if (options_dbastar.heu_map_cache_dir.size()) {
+    hash = heu_map_hash(problem, options_dbastar);
+    if (hash) {
+      std::stringstream ss;
+      ss << options_dbastar.heu_map_cache_dir << "/heu_map_" << std::hex
+         << hash << ".bin";
+      file = ss.str();
+      if (load_heu_map_bin(file, heu_map, hash)) {
+        std::cout << "loaded heu map from cache " << file << std::endl;
+        return;
+      }
+    } else {
+      std::cout << "WARNING: cannot hash the problem, heu map not cached"
+                << std::endl;
+    }
+  }
+
+  generate_heuristic_map(problem, robot, options_dbastar, heu_map);
+
+  if (file.size()) {
+    write_heu_map_bin(heu_map, file, hash);
+  }
+}
+
+Heu_grid::Heu_grid(
+    std::shared_ptr<dynobench::Model_robot> robot, const Eigen::VectorXd &goal,
+    const Eigen::VectorXd &p_lb, const Eigen::VectorXd &p_ub,
+    double resolution,
+    std::vector<std::shared_ptr<dynobench::Model_robot>> worker_robots)
+    : robot(robot), goal(goal), lb(p_lb), resolution(resolution),
+      dim(p_lb.size()) {
+
+  CHECK(dim == 2 || dim == 3, "Heu_grid requires a 2D or 3D workspace");
+  CHECK(resolution > 0, AT);
+  DYNO_CHECK_EQ(static_cast<size_t>(p_ub.size()), dim, AT);
+
+  size_t total = 1;
+  for (size_t k = 0; k < dim; k++) {
+    CHECK(p_ub(k) > p_lb(k), AT);
+    num_points.push_back(
+        static_cast<size_t>(std::ceil((p_ub(k) - p_lb(k)) / resolution)) + 1);
+    total *= num_points.back();
+  }
+
+  // Orientations to check each point: the goal orientation and a fixed sweep
+  // of the heading (computed here, so that the workers only read them). In
+  // 2D, the components after the position are angles (the heading and the
+  // trailers, set to the same angle). In 3D, a quaternion (x, y, z, w) of a
+  // rotation around the z axis. Otherwise, only the goal orientation.
+  Eigen::VectorXd goal_zero_vel = goal;
+  goal_zero_vel.segment(robot->nx_pr, robot->nx - robot->nx_pr).setZero();
+  std::vector<Eigen::VectorXd> templates{goal_zero_vel};
+  const size_t num_orientations = 16;
+  const size_t num_angles = robot->nx_pr > dim ? robot->nx_pr - dim : 0;
+  for (size_t i = 0; i < num_orientations; i++) {
+    double a = -M_PI + 2 * M_PI * i / num_orientations;
+    Eigen::VectorXd v = goal_zero_vel;
+    if (dim == 2 && num_angles > 0) {
+      v.segment(dim, num_angles).setConstant(a);
+    } else if (dim == 3 && num_angles == 4) {
+      v.segment<4>(dim) << 0, 0, std::sin(a / 2), std::cos(a / 2);
+    } else {
+      break;
+    }
+    templates.push_back(v);
+  }
+
+  // Lower bound of the time per unit of length, along the first axis
+  {
+    Eigen::VectorXd x1 = goal_zero_vel;
+    x1(0) += 1.;
+    time_per_distance = robot->lower_bound_time_pr(goal_zero_vel, x1);
+  }
+
+  auto point = [&](size_t i, size_t *cell) {
+    for (size_t k = 0; k < dim; k++) {
+      cell[k] = i % num_points[k];
+      i /= num_points[k];
+    }
+  };
+
+  // Rasterize
+  if (worker_robots.empty()) {
+    worker_robots.push_back(robot);
+  }
+  Thread_pool pool(worker_robots.size());
+  std::vector<char> is_free(total, 0);
+  const size_t chunk = 1024;
+  auto time_raster = timed_fun_void([&] {
+    pool.parallel_for((total + chunk - 1) / chunk, [&](size_t c,
+                                                       size_t worker_id) {
+      auto &worker_robot = *worker_robots.at(worker_id);
+      Eigen::VectorXd x(robot->nx);
+      size_t cell[3];
+      for (size_t i = c * chunk; i < std::min(total, (c + 1) * chunk); i++) {
+        point(i, cell);
+        for (auto &t : templates) {
+          x = t;
+          for (size_t k = 0; k < dim; k++) {
+            x(k) = lb(k) + cell[k] * resolution;
+          }
+          if (worker_robot.collision_check(x)) {
+            is_free[i] = 1;
+            break;
+          }
+        }
+      }
+    });
+  });
+
+  // Inflate the free points by one cell: the robot can pass between grid
+  // points that are in collision, or at an orientation between the sweep
+  {
+    std::vector<char> is_free_inflated = is_free;
+    const size_t num_offsets = dim == 2 ? 9 : 27;
+    size_t cell[3], next[3];
+    for (size_t i = 0; i < total; i++) {
+      if (!is_free[i]) {
+        continue;
+      }
+      point(i, cell);
+      for (size_t o = 0; o < num_offsets; o++) {
+        bool inside = true;
+        for (size_t k = 0, m = o; k < dim; k++, m /= 3) {
+          long n = static_cast<long>(cell[k]) + static_cast<long>(m % 3) - 1;
+          if (n < 0 || n >= static_cast<long>(num_points[k])) {
+            inside = false;
+            break;
+          }
+          next[k] = n;
+        }
+        if (inside) {
+          is_free_inflated[index(next)] = 1;
+        }
+      }
+    }
+    is_free = std::move(is_free_inflated);
+  }
+
+  // Wavefront from the goal
+  const float inf = std::numeric_limits<float>::infinity();
+  distance.assign(total, inf);
+
+  size_t goal_cell[3];
+  for (size_t k = 0; k < dim; k++) {
+    double c = std::round((goal(k) - lb(k)) / resolution);
+    goal_cell[k] = std::clamp<double>(c, 0, num_points[k] - 1);
+  }
+  size_t goal_index = index(goal_cell);
+  is_free[goal_index] = 1;
+
+  std::vector<std::array<int, 3>> offsets;
+  std::vector<float> offset_length;
+  for (int i = -1; i <= 1; i++) {
+    for (int j = -1; j <= 1; j++) {
+      for (int k = -1; k <= 1; k++) {
+        if ((dim == 2 && k != 0) || (i == 0 && j == 0 && k == 0)) {
+          continue;
+        }
+        offsets.push_back({i, j, k});
+        offset_length.push_back(resolution * std::sqrt(i * i + j * j + k * k));
+      }
+    }
+  }
+
+  auto time_wavefront = timed_fun_void([&] {
+    using Item = std::pair<float, size_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    distance[goal_index] = 0;
+    queue.push({0, goal_index});
+    size_t cell[3], next[3];
+    while (queue.size()) {
+      auto [d, i] = queue.top();
+      queue.pop();
+      if (d > distance[i]) {
+        continue;
+      }
+      point(i, cell);
+      for (size_t o = 0; o < offsets.size(); o++) {
+        bool inside = true;
+        for (size_t k = 0; k < dim; k++) {
+          long n = static_cast<long>(cell[k]) + offsets[o][k];
+          if (n < 0 || n >= static_cast<long>(num_points[k])) {
+            inside = false;
+            break;
+          }
+          next[k] = n;
+        }
+        if (!inside) {
+          continue;
+        }
+        size_t j = index(next);
+        float dj = d + offset_length[o];
+        if (is_free[j] && dj < distance[j]) {
+          distance[j] = dj;
+          queue.push({dj, j});
+        }
+      }
+    }
+  });
+
+  std::cout << "Heu_grid: points " << total << " rasterize [ms] "
+            << time_raster << " (threads " << pool.size() << ") wavefront [ms] "
+            << time_wavefront << std::endl;
+}
+
+double Heu_grid::h(const Eigen::VectorXd &x) {
+  assert(x.size() == robot->nx);
+
+  // multilinear interpolation between the reachable grid points around x
+  size_t base[3];
+  double frac[3];
+  for (size_t k = 0; k < dim; k++) {
+    double c = std::clamp<double>((x(k) - lb(k)) / resolution, 0,
+                                  num_points[k] - 1);
+    base[k] = std::min<size_t>(c, num_points[k] - 2);
+    frac[k] = c - base[k];
+  }
+
+  double sum = 0;
+  double sum_w = 0;
+  size_t cell[3];
+  for (size_t corner = 0; corner < (1u << dim); corner++) {
+    double w = 1;
+    for (size_t k = 0; k < dim; k++) {
+      bool up = corner & (1u << k);
+      cell[k] = base[k] + up;
+      w *= up ? frac[k] : 1 - frac[k];
+    }
+    float d = distance[index(cell)];
+    if (w > 0 && d < std::numeric_limits<float>::infinity()) {
+      sum += w * d;
+      sum_w += w;
+    }
+  }
+
+  if (sum_w == 0) {
+    return 1e8; // not reachable (as Heu_roadmap without neighbours)
+  }
+
+  // The 8/26-connected path is longer than the shortest path by up to
+  // 1/cos(pi/8) in 2D (1.1282 in 3D), and x is up to one cell from the
+  // grid points.
+  const double connectivity = dim == 2 ? 1.0824 : 1.1282;
+  double cell_diagonal = resolution * std::sqrt(double(dim));
+  double pos_h =
+      std::max(0., sum / sum_w / connectivity - cell_diagonal) *
+      time_per_distance;
+
+  double vel_h = robot->lower_bound_time_vel(x, goal);
+  return std::max(vel_h, pos_h);
+}
+
+Heu_cached::Heu_cached(std::shared_ptr<Heu_fun> heu, double resolution,
+                       size_t capacity)
+    : heu(heu), resolution(resolution) {
+  CHECK(heu, AT);
+  CHECK(resolution > 0, AT);
+  size_t size = 1;
+  while (size < capacity) {
+    size *= 2;
+  }
+  table.resize(size);
+  mask = size - 1;
+}
+
+double Heu_cached::h(const Eigen::VectorXd &x) {
+  Fnv_hash hash;
+  for (long k = 0; k < x.size(); k++) {
+    hash.add(static_cast<int64_t>(std::llround(x(k) / resolution)));
+  }
+  const uint64_t key = hash.value;
+
+  size_t slot = key & mask;
+  for (size_t i = 0; i < max_probes; i++) {
+    Entry &e = table[(key + i) & mask];
+    if (e.used && e.key == key) {
+      hits++;
+      return e.value;
+    }
+    if (!e.used) {
+      slot = (key + i) & mask;
+      break;
+    }
+  }
+
+  misses++;
+  double value = heu->h(x);
+  table[slot] = Entry{key, value, true};
+  return value;
+}
+
+void Heu_cached::collect(Time_benchmark &time_bench) {
+  time_bench.num_heu_cache_hits += hits;
+  time_bench.num_heu_cache_misses += misses;
+  hits = 0;
+  misses = 0;
 }
 
 Heu_roadmap::Heu_roadmap(std::shared_ptr<dynobench::Model_robot> robot,
@@ -174,35 +649,102 @@ void compute_heuristic_map_new(
   }
 }
 
+// Robot types whose nigh space (nigh_factory2) has the metric of
+// Model_robot::distance, so that the radius query of nigh finds all the
+// pairs of the all-pairs loop. For other robots (e.g. quad3d, with another
+// metric in SO(3)), the nigh distance can be larger and pairs are missed.
+static bool nigh_candidates_exact(const std::string &robot_type) {
+  return startsWith(robot_type, "unicycle1");
+}
+
 void build_heuristic_distance_new(
     const std::vector<Eigen::VectorXd> &batch_samples,
     std::shared_ptr<dynobench::Model_robot> &robot,
     std::vector<Heuristic_node> &heuristic_map, double distance_threshold,
-    double resolution) {
-
-  EdgeList edge_list;
-  DistanceList distance_list;
-
-  auto tic = std::chrono::high_resolution_clock::now();
-
-  auto out = timed_fun([&] {
-    for (size_t i = 0; i < batch_samples.size(); i++) {
-      std::cout << "i " << i << std::endl;
-      for (size_t j = i + 1; j < batch_samples.size(); j++) {
-        auto p1 = batch_samples.at(i);
-        auto p2 = batch_samples.at(j);
-        double d = robot->distance(p1, p2);
-        if (d < distance_threshold &&
-            dynobench::check_edge_at_resolution(p1, p2, robot, resolution)) {
-          edge_list.push_back({i, j});
-          distance_list.push_back(robot->lower_bound_time(p1, p2));
+    double resolution, const std::string &robot_type,
+    std::vector<std::shared_ptr<dynobench::Model_robot>> worker_robots) {
+
+  const size_t n = batch_samples.size();
+
+  // Candidate edges (i, j), j > i, with distance below the threshold. The
+  // radius query only reduces the number of pairs: the condition is the same
+  // as in the all-pairs loop.
+  std::vector<std::vector<size_t>> candidates(n);
+  auto time_candidates = timed_fun([&] {
+    if (robot_type.size() && nigh_candidates_exact(robot_type)) {
+      std::vector<Heuristic_node> nodes(n);
+      for (size_t i = 0; i < n; i++) {
+        nodes[i].x = batch_samples[i];
+      }
+      std::unique_ptr<ompl::NearestNeighbors<Heuristic_node *>> T(
+          nigh_factory2<Heuristic_node *>(robot_type, robot));
+      for (auto &node : nodes) {
+        T->add(&node);
+      }
+      std::vector<Heuristic_node *> neighbors;
+      for (size_t i = 0; i < n; i++) {
+        // slack for rounding: the exact check is below
+        T->nearestR(&nodes[i], distance_threshold * (1 + 1e-6), neighbors);
+        for (auto &nb : neighbors) {
+          size_t j = nb - nodes.data();
+          if (j > i && robot->distance(batch_samples[i], batch_samples[j]) <
+                           distance_threshold) {
+            candidates[i].push_back(j);
+          }
+        }
+        std::sort(candidates[i].begin(), candidates[i].end());
+      }
+    } else {
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+          if (robot->distance(batch_samples[i], batch_samples[j]) <
+              distance_threshold) {
+            candidates[i].push_back(j);
+          }
         }
       }
     }
     return 0;
   });
 
-  std::cout << "time building distance matrix " << out.second << std::endl;
+  // Collision check of the candidates, one row per task. Each worker uses its
+  // own robot, and writes only the rows it checks.
+  if (worker_robots.empty()) {
+    worker_robots.push_back(robot);
+  }
+  Thread_pool pool(worker_robots.size());
+  std::vector<std::vector<char>> valid(n);
+  auto time_check = timed_fun([&] {
+    pool.parallel_for(n, [&](size_t i, size_t worker_id) {
+      auto &worker_robot = worker_robots.at(worker_id);
+      valid[i].resize(candidates[i].size());
+      for (size_t k = 0; k < candidates[i].size(); k++) {
+        valid[i][k] = dynobench::check_edge_at_resolution(
+            batch_samples[i], batch_samples[candidates[i][k]], worker_robot,
+            resolution);
+      }
+    });
+    return 0;
+  });
+
+  // Same order as the all-pairs loop
+  EdgeList edge_list;
+  DistanceList distance_list;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t k = 0; k < candidates[i].size(); k++) {
+      if (valid[i][k]) {
+        size_t j = candidates[i][k];
+        edge_list.push_back({i, j});
+        distance_list.push_back(
+            robot->lower_bound_time(batch_samples[i], batch_samples[j]));
+      }
+    }
+  }
+
+  std::cout << "time building distance matrix: candidates "
+            << time_candidates.second << " collisions " << time_check.second
+            << " threads " << pool.size() << " edges " << edge_list.size()
+            << std::endl;
 
   compute_heuristic_map_new(edge_list, distance_list, batch_samples,
                             heuristic_map);
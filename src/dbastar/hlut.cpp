@@ -0,0 +1,310 @@
+#include "dynoplan/dbastar/hlut.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <queue>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/general_utils.hpp"
+#include "dynoplan/dbastar/dbastar.hpp"
+#include "dynoplan/dbastar/successor_table.hpp"
+#include "dynoplan/fnv_hash.hpp"
+#include "dynoplan/nigh_custom_spaces.hpp"
+#include "dynoplan/ompl/motion_registry.hpp"
+#include "dynoplan/tmp_file.hpp"
+
+namespace dynoplan {
+
+static const char hlut_magic[8] = "DBHLUT1";
+
+static int64_t quantize(double x, double resolution) {
+  return std::llround(x / resolution);
+}
+
+// Key of a state: its class, the position cells (dim_pos) and the cells of
+// the other components of x. The cells are hashed one by one, without a
+// buffer of the state.
+static uint64_t make_key(const Hlut &hlut, uint64_t class_key,
+                         const int64_t *pos_cells, const Eigen::VectorXd &x) {
+  Fnv_hash h;
+  h.add(class_key);
+  h.add(pos_cells, hlut.dim_pos * sizeof(int64_t));
+  for (size_t k = hlut.dim_pos; k < hlut.nx; k++) {
+    h.add(quantize(x(k), hlut.resolution_rest));
+  }
+  return h.value;
+}
+
+uint64_t Hlut::class_key(const Eigen::VectorXd &x) const {
+  Fnv_hash h;
+  for (size_t k = dim_pos; k < nx; k++) {
+    h.add(quantize(x(k), resolution_rest));
+  }
+  return h.value;
+}
+
+uint64_t Hlut::state_key(uint64_t class_key, const Eigen::VectorXd &x,
+                         const Eigen::VectorXd &origin) const {
+  int64_t pos_cells[max_dim_pos];
+  for (size_t k = 0; k < dim_pos; k++) {
+    pos_cells[k] = quantize(x(k) - origin(k), resolution_pos);
+  }
+  return make_key(*this, class_key, pos_cells, x);
+}
+
+void Hlut::build(dynobench::Model_robot &robot,
+                 ompl::NearestNeighbors<Motion *> &T_m, double radius,
+                 size_t max_expands) {
+
+  CHECK(radius > 0, AT);
+  CHECK(resolution_pos > 0 && resolution_rest > 0, AT);
+  nx = robot.nx;
+  dim_pos = robot.get_translation_invariance();
+  CHECK(dim_pos <= max_dim_pos, AT);
+  classes.clear();
+  cost.clear();
+
+  std::vector<Motion *> motions;
+  T_m.list(motions);
+  CHECK(motions.size(), AT);
+
+  // canonical start states, by class (ordered, so that the table does not
+  // depend on the order of T_m)
+  std::map<uint64_t, std::vector<Eigen::VectorXd>> sources;
+  size_t max_traj_size = 0;
+  Eigen::VectorXd x(nx);
+  for (auto &m : motions) {
+    robot.canonical_state(m->traj.states.front(), x);
+    sources[class_key(x)].push_back(x);
+    max_traj_size = std::max(max_traj_size, m->traj.states.size());
+  }
+
+  Expander expander(&robot, &T_m, radius);
+  expander.random = false;
+  std::vector<LazyTraj> lazy_trajs;
+  dynobench::TrajWrapper traj_wrapper;
+  traj_wrapper.allocate_size(max_traj_size, robot.nx, robot.nu);
+  const Eigen::VectorXd origin = Eigen::VectorXd::Zero(nx);
+
+  for (auto &[c, class_sources] : sources) {
+    classes.insert(c);
+
+    using Item = std::pair<float, size_t>; // cost, index in states
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    std::vector<Eigen::VectorXd> states;
+    std::unordered_set<uint64_t> closed;
+
+    for (auto &s : class_sources) {
+      states.push_back(s);
+      queue.push({0, states.size() - 1});
+    }
+
+    size_t expands = 0;
+    while (queue.size() && expands < max_expands) {
+      auto [g, i] = queue.top();
+      queue.pop();
+      uint64_t key = state_key(c, states[i], origin);
+      if (!closed.insert(key).second) {
+        continue;
+      }
+      cost.emplace(key, g);
+      expands++;
+
+      lazy_trajs.clear();
+      expander.expand_lazy(states[i], lazy_trajs);
+      for (auto &lazy_traj : lazy_trajs) {
+        double g_next = g + lazy_traj.motion->cost;
+        if (g_next > max_cost) {
+          continue;
+        }
+        if (robot.transform_primitive_last_state_available) {
+          robot.transform_primitive_last_state(
+              *lazy_traj.offset, lazy_traj.motion->traj.states,
+              lazy_traj.motion->traj.actions, x);
+        } else {
+          traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
+          lazy_traj.compute(traj_wrapper);
+          x = traj_wrapper.get_state(traj_wrapper.get_size() - 1);
+        }
+        if (!robot.is_state_valid(x) ||
+            closed.count(state_key(c, x, origin))) {
+          continue;
+        }
+        states.push_back(x);
+        queue.push({g_next, states.size() - 1});
+      }
+    }
+  }
+}
+
+double Hlut::lookup(const Eigen::VectorXd &x,
+                    const Eigen::VectorXd &goal) const {
+  assert(static_cast<size_t>(x.size()) == nx);
+  uint64_t c = class_key(x);
+  if (!classes.count(c)) {
+    return 0;
+  }
+
+  int64_t center[max_dim_pos];
+  int64_t pos_cells[max_dim_pos];
+  for (size_t k = 0; k < dim_pos; k++) {
+    center[k] = quantize(goal(k) - x(k), resolution_pos);
+  }
+
+  // min over the neighbouring position cells: the relative position is
+  // quantised at the start and at the goal
+  size_t num_neighbours = 1;
+  for (size_t k = 0; k < dim_pos; k++) {
+    num_neighbours *= 3;
+  }
+  float min = std::numeric_limits<float>::infinity();
+  for (size_t n = 0; n < num_neighbours; n++) {
+    size_t nn = n;
+    for (size_t k = 0; k < dim_pos; k++) {
+      pos_cells[k] = center[k] + static_cast<int64_t>(nn % 3) - 1;
+      nn /= 3;
+    }
+    if (auto it = cost.find(make_key(*this, c, pos_cells, goal));
+        it != cost.end()) {
+      min = std::min(min, it->second);
+    }
+  }
+  return min < std::numeric_limits<float>::infinity() ? min : 0.;
+}
+
+void Hlut::write(const std::string &file) const {
+
+  create_dir_if_necessary(file.c_str());
+  std::string tmp_file = tmp_file_name(file);
+  {
+    std::ofstream out(tmp_file, std::ios::binary);
+    CHECK(out.good(), "cannot write " + tmp_file);
+
+    auto write_u64 = [&](uint64_t x) {
+      out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    };
+    auto write_double = [&](double x) {
+      out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    };
+
+    out.write(hlut_magic, sizeof(hlut_magic));
+    write_u64(hash);
+    write_u64(nx);
+    write_u64(dim_pos);
+    write_double(resolution_pos);
+    write_double(resolution_rest);
+    write_double(max_cost);
+    write_u64(classes.size());
+    for (auto &c : classes) {
+      write_u64(c);
+    }
+    write_u64(cost.size());
+    for (auto &[key, value] : cost) {
+      write_u64(key);
+      out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+bool Hlut::read(const std::string &file) {
+
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    return false;
+  }
+
+  auto read_u64 = [&] {
+    uint64_t x = 0;
+    in.read(reinterpret_cast<char *>(&x), sizeof(x));
+    return x;
+  };
+  auto read_double = [&] {
+    double x = 0;
+    in.read(reinterpret_cast<char *>(&x), sizeof(x));
+    return x;
+  };
+
+  char magic[sizeof(hlut_magic)];
+  in.read(magic, sizeof(magic));
+  if (!in.good() || !std::equal(magic, magic + sizeof(magic), hlut_magic)) {
+    std::cout << "WARNING: " << file << " is not a hlut" << std::endl;
+    return false;
+  }
+
+  hash = read_u64();
+  nx = read_u64();
+  dim_pos = read_u64();
+  if (!in.good() || dim_pos > max_dim_pos || dim_pos > nx) {
+    std::cout << "WARNING: " << file << " has a wrong dimension" << std::endl;
+    return false;
+  }
+  resolution_pos = read_double();
+  resolution_rest = read_double();
+  max_cost = read_double();
+  classes.clear();
+  const size_t num_classes = read_u64();
+  for (size_t i = 0; i < num_classes; i++) {
+    classes.insert(read_u64());
+  }
+  cost.clear();
+  const size_t num_cost = read_u64();
+  cost.reserve(num_cost);
+  for (size_t i = 0; i < num_cost; i++) {
+    uint64_t key = read_u64();
+    float value;
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    cost.emplace(key, value);
+  }
+  CHECK(in.good(), "corrupted hlut " + file);
+  return true;
+}
+
+uint64_t hlut_hash(const std::string &motions_file,
+                   const std::string &robot_type, size_t num_motions,
+                   bool cut_actions, double radius) {
+  Fnv_hash h;
+  h.add(primitive_file_hash(motions_file));
+  h.add(robot_type);
+  h.add(static_cast<uint64_t>(num_motions));
+  h.add(cut_actions);
+  h.add(radius);
+  return h.value;
+}
+
+void build_hlut(Hlut &hlut, std::shared_ptr<dynobench::Model_robot> robot,
+                const std::string &robot_type, std::vector<Motion> &motions,
+                const std::string &motions_file, bool cut_actions,
+                size_t max_motions, double radius, size_t max_expands) {
+
+  std::unique_ptr<ompl::NearestNeighbors<Motion *>> T_m(
+      nigh_factory2<Motion *>(robot_type, robot));
+  for (size_t i = 0; i < std::min(motions.size(), max_motions); ++i) {
+    T_m->add(&motions.at(i));
+  }
+
+  // free space: no bounds on the position
+  Eigen::VectorXd x_lb = robot->x_lb;
+  Eigen::VectorXd x_ub = robot->x_ub;
+  robot->x_lb.head(robot->get_translation_invariance()).array() =
+      -std::numeric_limits<double>::max();
+  robot->x_ub.head(robot->get_translation_invariance()).array() =
+      std::numeric_limits<double>::max();
+
+  auto time = timed_fun_void(
+      [&] { hlut.build(*robot, *T_m, radius, max_expands); });
+  robot->x_lb = x_lb;
+  robot->x_ub = x_ub;
+  hlut.hash =
+      hlut_hash(motions_file, robot_type, T_m->size(), cut_actions, radius);
+
+  std::cout << "hlut: classes " << hlut.classes.size() << " entries "
+            << hlut.cost.size() << " time [ms] " << time << std::endl;
+}
+
+} // namespace dynoplan
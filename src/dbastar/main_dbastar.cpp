@@ -24,6 +24,7 @@
 #include <ompl/datastructures/NearestNeighborsGNATNoThreadSafety.h>
 #include <ompl/datastructures/NearestNeighborsSqrtApprox.h>
 
+#include "dynoplan/ompl/motion_registry.hpp"
 #include "dynoplan/ompl/robots.h"
 #include "ompl/base/ScopedState.h"
 
@@ -76,12 +77,12 @@ int main(int argc, char *argv[]) {
       (problem.models_base_path + problem.robotType + ".yaml").c_str(),
       problem.p_lb, problem.p_ub);
 
-  std::vector<Motion> motions;
-  load_motion_primitives_new(
-      options_dbastar.motionsFile, *robot, motions, options_dbastar.max_motions,
-      options_dbastar.cut_actions, false, options_dbastar.check_cols);
+  std::shared_ptr<std::vector<Motion>> motions =
+      Motion_registry::instance().load(
+          options_dbastar.motionsFile, *robot, options_dbastar.max_motions,
+          options_dbastar.cut_actions, false, options_dbastar.check_cols);
 
-  options_dbastar.motions_ptr = &motions;
+  options_dbastar.motions_ptr = motions.get();
 
   dbastar(problem, options_dbastar, traj, out_db);
 
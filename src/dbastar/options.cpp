@@ -36,9 +36,26 @@ void Options_dbastar::__load_data(void *source, bool boost, bool write,
   loader.set(VAR_WITH_NAME(search_timelimit));
   loader.set(VAR_WITH_NAME(max_size_heu_map));
   loader.set(VAR_WITH_NAME(heu_map_file));
+  loader.set(VAR_WITH_NAME(hlut_file));
+  loader.set(VAR_WITH_NAME(heu_map_cache_dir));
   loader.set(VAR_WITH_NAME(heu_connection_radius));
+  loader.set(VAR_WITH_NAME(heu_grid_resolution));
+  loader.set(VAR_WITH_NAME(heu_cache_resolution));
+  loader.set(VAR_WITH_NAME(heu_cache_size));
   loader.set(VAR_WITH_NAME(use_nigh_nn));
   loader.set(VAR_WITH_NAME(check_cols));
+  loader.set(VAR_WITH_NAME(num_threads_check));
+  loader.set(VAR_WITH_NAME(num_threads));
+  loader.set(VAR_WITH_NAME(num_threads_heu));
+  loader.set(VAR_WITH_NAME(output_mode));
+  loader.set(VAR_WITH_NAME(open_list));
+  loader.set(VAR_WITH_NAME(open_bucket_width));
+  loader.set(VAR_WITH_NAME(lazy_edges));
+  loader.set(VAR_WITH_NAME(successor_table));
+  loader.set(VAR_WITH_NAME(successor_table_dir));
+  loader.set(VAR_WITH_NAME(anytime));
+  loader.set(VAR_WITH_NAME(anytime_weight));
+  loader.set(VAR_WITH_NAME(anytime_weight_step));
 }
 
 void Options_dbastar::add_options(po::options_description &desc) {
@@ -0,0 +1,204 @@
+#include "dynoplan/dbastar/successor_table.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/general_utils.hpp"
+#include "dynoplan/fnv_hash.hpp"
+#include "dynoplan/tmp_file.hpp"
+
+namespace dynoplan {
+
+static const char successor_table_magic[8] = "DBSUCC1";
+
+static std::vector<Motion *> sorted_motions(
+    ompl::NearestNeighbors<Motion *> &T_m) {
+  std::vector<Motion *> motions;
+  T_m.list(motions);
+  std::sort(motions.begin(), motions.end(),
+            [](Motion *a, Motion *b) { return a->idx < b->idx; });
+  return motions;
+}
+
+uint64_t motions_hash(const std::string &robot_type,
+                      ompl::NearestNeighbors<Motion *> &T_m, double radius) {
+  Fnv_hash h;
+  h.add(robot_type);
+  h.add(radius);
+  for (auto &m : sorted_motions(T_m)) {
+    h.add(static_cast<uint64_t>(m->idx));
+    h.add(static_cast<uint64_t>(m->traj.states.size()));
+    for (auto &x : m->traj.states) {
+      h.add(x);
+    }
+    h.add(static_cast<uint64_t>(m->traj.actions.size()));
+    for (auto &u : m->traj.actions) {
+      h.add(u);
+    }
+  }
+  return h.value;
+}
+
+void Successor_table::build(dynobench::Model_robot &robot,
+                            ompl::NearestNeighbors<Motion *> &T_m,
+                            double radius) {
+
+  CHECK(radius > 0, AT);
+  nx = robot.nx;
+  this->radius = radius;
+
+  std::vector<Motion *> motions = sorted_motions(T_m);
+  CHECK(motions.size(), AT);
+  const size_t rows = motions.back()->idx + 1;
+
+  canonical_states.assign(rows, Eigen::VectorXd());
+  begin.assign(rows + 1, 0);
+  successors_idx.clear();
+  successors.clear();
+
+  Motion fakeMotion;
+  fakeMotion.idx = -1;
+  fakeMotion.traj.states.push_back(Eigen::VectorXd(nx));
+  std::vector<Motion *> neighbors_m;
+
+  size_t m = 0;
+  for (size_t i = 0; i < rows; i++) {
+    begin[i] = successors.size();
+    if (m < motions.size() && motions[m]->idx == i) {
+      Eigen::VectorXd &canonical_state = canonical_states[i];
+      canonical_state.resize(nx);
+      robot.canonical_state(motions[m]->traj.states.back(), canonical_state);
+      fakeMotion.traj.states.at(0) = canonical_state;
+      T_m.nearestR(&fakeMotion, radius, neighbors_m);
+      for (auto &n : neighbors_m) {
+        successors.push_back(n);
+        successors_idx.push_back(n->idx);
+      }
+      m++;
+    }
+  }
+  begin[rows] = successors.size();
+}
+
+void Successor_table::write(const std::string &file) const {
+
+  create_dir_if_necessary(file.c_str());
+  // write to a tmp file first, so that a concurrent reader never sees a
+  // partial table
+  std::string tmp_file = tmp_file_name(file);
+  {
+    std::ofstream out(tmp_file, std::ios::binary);
+    CHECK(out.good(), "cannot write " + tmp_file);
+
+    auto write_u64 = [&](uint64_t x) {
+      out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    };
+
+    out.write(successor_table_magic, sizeof(successor_table_magic));
+    write_u64(hash);
+    write_u64(nx);
+    out.write(reinterpret_cast<const char *>(&radius), sizeof(radius));
+    write_u64(num_rows());
+    for (auto &s : canonical_states) {
+      write_u64(s.size());
+      out.write(reinterpret_cast<const char *>(s.data()),
+                s.size() * sizeof(double));
+    }
+    out.write(reinterpret_cast<const char *>(begin.data()),
+              begin.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(successors_idx.data()),
+              successors_idx.size() * sizeof(uint32_t));
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+bool Successor_table::read(const std::string &file,
+                           ompl::NearestNeighbors<Motion *> &T_m,
+                           uint64_t expected_hash) {
+
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    return false;
+  }
+
+  auto read_u64 = [&] {
+    uint64_t x = 0;
+    in.read(reinterpret_cast<char *>(&x), sizeof(x));
+    return x;
+  };
+
+  char magic[sizeof(successor_table_magic)];
+  in.read(magic, sizeof(magic));
+  if (!in.good() ||
+      !std::equal(magic, magic + sizeof(magic), successor_table_magic) ||
+      read_u64() != expected_hash) {
+    std::cout << "WARNING: ignoring successor table " << file << std::endl;
+    return false;
+  }
+
+  hash = expected_hash;
+  nx = read_u64();
+  in.read(reinterpret_cast<char *>(&radius), sizeof(radius));
+  const size_t rows = read_u64();
+  canonical_states.resize(rows);
+  for (auto &s : canonical_states) {
+    s.resize(read_u64());
+    in.read(reinterpret_cast<char *>(s.data()), s.size() * sizeof(double));
+  }
+  begin.resize(rows + 1);
+  in.read(reinterpret_cast<char *>(begin.data()),
+          begin.size() * sizeof(uint32_t));
+  successors_idx.resize(begin.back());
+  in.read(reinterpret_cast<char *>(successors_idx.data()),
+          successors_idx.size() * sizeof(uint32_t));
+  CHECK(in.good(), "corrupted successor table " + file);
+
+  std::vector<Motion *> by_idx(rows, nullptr);
+  for (auto &m : sorted_motions(T_m)) {
+    CHECK(m->idx < rows, AT);
+    by_idx[m->idx] = m;
+  }
+  successors.resize(successors_idx.size());
+  for (size_t i = 0; i < successors_idx.size(); i++) {
+    CHECK(successors_idx[i] < rows && by_idx[successors_idx[i]], AT);
+    successors[i] = by_idx[successors_idx[i]];
+  }
+  return true;
+}
+
+std::unique_ptr<Successor_table>
+make_successor_table(dynobench::Model_robot &robot,
+                     const std::string &robot_type,
+                     ompl::NearestNeighbors<Motion *> &T_m, double radius,
+                     const std::string &cache_dir) {
+
+  auto table = std::make_unique<Successor_table>();
+  uint64_t hash = motions_hash(robot_type, T_m, radius);
+
+  std::string file;
+  if (cache_dir.size()) {
+    std::stringstream ss;
+    ss << cache_dir << "/successors_" << std::hex << hash << ".bin";
+    file = ss.str();
+    if (table->read(file, T_m, hash)) {
+      std::cout << "loaded successor table " << file << std::endl;
+      return table;
+    }
+  }
+
+  table->build(robot, T_m, radius);
+  table->hash = hash;
+  std::cout << "successor table: rows " << table->num_rows() << " successors "
+            << table->successors.size() << std::endl;
+
+  if (file.size()) {
+    table->write(file);
+  }
+  return table;
+}
+
+} // namespace dynoplan
@@ -24,6 +24,7 @@
 #include <ompl/datastructures/NearestNeighborsGNATNoThreadSafety.h>
 #include <ompl/datastructures/NearestNeighborsSqrtApprox.h>
 
+#include "dynoplan/ompl/motion_registry.hpp"
 #include "dynoplan/ompl/robots.h"
 #include "ompl/base/ScopedState.h"
 
@@ -77,19 +78,18 @@ int main(int argc, char *argv[]) {
   options_dbrrt.print(std::cout);
   std::cout << "***" << std::endl;
 
-  std::vector<Motion> motions;
-
   std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
       (problem.models_base_path + problem.robotType + ".yaml").c_str(),
       problem.p_lb, problem.p_ub);
 
   load_env(*robot, problem);
 
-  load_motion_primitives_new(
-      options_dbrrt.motionsFile, *robot, motions, options_dbrrt.max_motions,
-      options_dbrrt.cut_actions, false, options_dbrrt.check_cols);
+  std::shared_ptr<std::vector<Motion>> motions =
+      Motion_registry::instance().load(
+          options_dbrrt.motionsFile, *robot, options_dbrrt.max_motions,
+          options_dbrrt.cut_actions, false, options_dbrrt.check_cols);
 
-  options_dbrrt.motions_ptr = &motions;
+  options_dbrrt.motions_ptr = motions.get();
 
   // dbrrt(problem, options_dbrrt, options_trajopt, traj, out_db);
   idbrrt(problem, robot, options_dbrrt, options_trajopt, traj, out_db);
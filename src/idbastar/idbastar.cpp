@@ -1,7 +1,23 @@
 #include "dynoplan/idbastar/idbastar.hpp"
 
+#include "dynoplan/ompl/motion_registry.hpp"
+
 namespace dynoplan {
 
+// Write the trajectory to both filenames (latest and unique id), if the sink
+// keeps the output.
+static void write_traj_to_sink(Output_sink &sink,
+                               const dynobench::Trajectory &traj,
+                               const std::string &filename,
+                               const std::string &filename_id) {
+  for (auto &name : {filename, filename_id}) {
+    if (auto out = sink.open(name)) {
+      std::cout << "saving traj to: " << name << std::endl;
+      traj.to_yaml_format(*out);
+    }
+  }
+}
+
 /*
  * @bried: Iterative Discontinuity Bounded A* (iDb-A*)
  * See the paper for more details:
@@ -29,6 +45,10 @@ void idbA(const dynobench::Problem &problem,
   // Thus, we do a copy of the input, and only change our local copy
   Options_dbastar options_dbastar_local = options_dbastar;
 
+  // Debug outputs of idbA* follow the output options of dbastar.
+  Output_sink &sink = get_output_sink(options_dbastar.output_sink,
+                                      options_dbastar.output_mode);
+
   std::vector<Motion> motions;
 
   // Create a robot (necessary for loading the motion primitives)
@@ -38,11 +58,13 @@ void idbA(const dynobench::Problem &problem,
 
   CHECK(robot, AT);
 
-  // Load motion primitives
-  load_motion_primitives_new(options_dbastar_local.motionsFile, *robot, motions,
-                             options_idbas.max_motions_primitives,
-                             options_dbastar_local.cut_actions, false,
-                             options_dbastar_local.check_cols);
+  // Load motion primitives. The trajectories come from the Motion_registry
+  // (binary cache), the motions are ours: new primitives are added below
+  trajectories_to_motions(Motion_registry::instance().trajectories(
+                              options_dbastar_local.motionsFile, *robot,
+                              options_idbas.max_motions_primitives),
+                          *robot, motions, options_dbastar_local.cut_actions,
+                          false, options_dbastar_local.check_cols);
   options_dbastar_local.motions_ptr = &motions;
   std::cout << "Loading motion primitives -- DONE " << std::endl;
 
@@ -98,9 +120,12 @@ void idbA(const dynobench::Problem &problem,
     } else {
       std::cout << "not heu map provided. Computing one .... " << std::endl;
       // there is not
-      generate_heuristic_map(problem, robot, options_dbastar_local, heu_map);
-      std::cout << "writing heu map " << std::endl;
-      write_heu_map(heu_map, "tmp_heu_map.yaml");
+      generate_heuristic_map_cached(problem, robot, options_dbastar_local,
+                                    heu_map);
+      if (auto out = sink.open("tmp_heu_map.yaml")) {
+        std::cout << "writing heu map " << std::endl;
+        write_heu_map(heu_map, *out);
+      }
     }
     options_dbastar_local.heu_map_ptr = &heu_map;
   }
@@ -175,20 +200,9 @@ void idbA(const dynobench::Problem &problem,
     info_out_idbastar.infos_raw.push_back(out_info_db.data);
 
     if (out_info_db.solved) {
-      {
-        // write trajectory to file for debugging
-        std::string filename = "/tmp/dynoplan/i_traj_db.yaml";
-        std::string filename_id = "/tmp/dynoplan/i_traj_db_" + id_db + ".yaml";
-        std::cout << "saving traj to: " << filename << std::endl;
-        std::cout << "saving traj to: " << filename_id << std::endl;
-        create_dir_if_necessary(filename.c_str());
-        create_dir_if_necessary(filename_id.c_str());
-        std::ofstream out(filename_id);
-        traj_db.to_yaml_format(out);
-        std::filesystem::copy(
-            filename_id, filename.c_str(),
-            std::filesystem::copy_options::overwrite_existing);
-      }
+      // write trajectory to file for debugging
+      write_traj_to_sink(sink, traj_db, "/tmp/dynoplan/i_traj_db.yaml",
+                         "/tmp/dynoplan/i_traj_db_" + id_db + ".yaml");
 
       // Start Trajectory optimization
       std::cout << "***Trajectory Optimization -- START ***" << std::endl;
@@ -199,21 +213,10 @@ void idbA(const dynobench::Problem &problem,
           stopwatch.elapsed_ms() - std::stof(result.data.at("time_ddp_total"));
       std::cout << "***Trajectory Optimization -- DONE ***" << std::endl;
 
-      {
-        // write trajectory to file for debugging
-        std::string filename = "/tmp/dynoplan/i_traj_opt.yaml";
-        std::string filename_id =
-            "/tmp/dynoplan/i_traj_opt_" + gen_random(6) + ".yaml";
-        std::cout << "saving traj to: " << filename << std::endl;
-        std::cout << "saving traj to: " << filename_id << std::endl;
-        create_dir_if_necessary(filename.c_str());
-        create_dir_if_necessary(filename_id.c_str());
-        std::ofstream out(filename_id);
-        traj.to_yaml_format(out);
-        std::filesystem::copy(
-            filename_id, filename,
-            std::filesystem::copy_options::overwrite_existing);
-      }
+      // write trajectory to file for debugging
+      write_traj_to_sink(sink, traj, "/tmp/dynoplan/i_traj_opt.yaml",
+                         "/tmp/dynoplan/i_traj_opt_" + gen_random(6) +
+                             ".yaml");
 
       traj.time_stamp =
           get_time_stamp_ms() - int(use_non_counter_time) * non_counter_time;
@@ -245,10 +248,13 @@ void idbA(const dynobench::Problem &problem,
           make_trajs_canonical(*robot, new_trajectories.data,
                                trajs_canonical.data);
 
-          {
-            std::string filename =
-                "/tmp/dynoplan/trajs_cuts_canonical_" + gen_random(6) + ".yaml";
-            trajs_canonical.save_file_yaml(filename.c_str());
+          if (auto out = sink.open("/tmp/dynoplan/trajs_cuts_canonical_" +
+                                   gen_random(6) + ".yaml")) {
+            *out << "trajs:" << std::endl;
+            for (auto &t : trajs_canonical.data) {
+              *out << "  - " << std::endl;
+              t.to_yaml_format(*out, "    ");
+            }
           }
 
           // Add a little bit of noise, because NIGH sometimes
@@ -314,20 +320,9 @@ void idbA(const dynobench::Problem &problem,
   }
   // we have finised the search!
 
-  {
-    // write solution to file
-    std::string filename = "/tmp/dynoplan/i_traj_out.yaml";
-    std::string filename_id =
-        "/tmp/dynoplan/i_traj_out_" + gen_random(6) + ".yaml";
-    std::cout << "saving traj to: " << filename << std::endl;
-    std::cout << "saving traj to: " << filename_id << std::endl;
-    create_dir_if_necessary(filename.c_str());
-    create_dir_if_necessary(filename_id.c_str());
-    std::ofstream out(filename_id);
-    traj_out.to_yaml_format(out);
-    std::filesystem::copy(filename_id, filename,
-                          std::filesystem::copy_options::overwrite_existing);
-  }
+  // write solution to file
+  write_traj_to_sink(sink, traj_out, "/tmp/dynoplan/i_traj_out.yaml",
+                     "/tmp/dynoplan/i_traj_out_" + gen_random(6) + ".yaml");
 
   std::cout << "exit criteria: "
             << static_cast<int>(info_out_idbastar.exit_criteria) << std::endl;
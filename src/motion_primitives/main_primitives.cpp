@@ -1,4 +1,5 @@
 
+#include "dynoplan/dbastar/hlut.hpp"
 #include "dynoplan/motion_primitives/motion_primitives.hpp"
 
 enum class PRIMITIVE_MODE {
@@ -17,6 +18,7 @@ enum class PRIMITIVE_MODE {
   yamltobin = 12,
   sort_with_rand_config = 13,
   reduce_set = 14,
+  hlut = 15,
 };
 
 using namespace dynobench;
@@ -420,6 +422,30 @@ int main(int argc, const char *argv[]) {
     trajectories.compute_stats("/tmp/tmp_stats.yaml");
   }
 
+  if (mode == PRIMITIVE_MODE::hlut) {
+    std::vector<dynoplan::Motion> motions;
+    int max_motions = options_primitives.max_num_primitives > 0
+                          ? options_primitives.max_num_primitives
+                          : std::numeric_limits<int>::max();
+    load_motion_primitives_new(in_file, *robot_model, motions, max_motions,
+                               options_primitives.hlut_cut_actions, false,
+                               false);
+
+    Hlut hlut;
+    hlut.resolution_pos = options_primitives.hlut_resolution_pos;
+    hlut.resolution_rest = options_primitives.hlut_resolution_rest;
+    hlut.max_cost = options_primitives.hlut_max_cost;
+    build_hlut(hlut, robot_model, options_primitives.dynamics, motions,
+               in_file, options_primitives.hlut_cut_actions, max_motions,
+               options_primitives.hlut_alpha * options_primitives.hlut_delta,
+               options_primitives.hlut_max_expands);
+
+    if (out_file == "auto") {
+      out_file = in_file + ".hlut.bin";
+    }
+    hlut.write(out_file);
+  }
+
   std::ofstream log(out_file + ".log");
   log << "argv: " << std::endl;
   for (int i = 0; i < argc; i++) {
@@ -0,0 +1,269 @@
+#include "dynoplan/ompl/motion_registry.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <yaml-cpp/yaml.h>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynobench/general_utils.hpp"
+#include "dynoplan/fnv_hash.hpp"
+#include "dynoplan/tmp_file.hpp"
+
+namespace dynoplan {
+
+static const char primitive_cache_magic[8] = "DBMOTN1";
+
+Motion_registry::Motion_registry() {
+  const std::string base = "../../new_format_motions/";
+  files["unicycle1_v0"] = base + "unicycle1_v0/unicycle1_v0.msgpack";
+  files["unicycle1_sphere_v0"] = files["unicycle1_v0"];
+  files["unicycle2_v0"] = base + "unicycle2_v0/unicycle2_v0.msgpack";
+  files["car1_v0"] = base + "car_with_trailers/car_with_trailers.msgpack";
+  files["integrator2_2d_v0"] =
+      base + "integrator2_2d_v0/integrator2_2d_v0.msgpack";
+  files["integrator2_3d_v0"] =
+      base + "integrator2_3d_v0/integrator2_3d_v0.bin.im.bin.sp.bin";
+}
+
+Motion_registry &Motion_registry::instance() {
+  static Motion_registry registry;
+  return registry;
+}
+
+void Motion_registry::set_motions_file(const std::string &robot_type,
+                                       const std::string &motions_file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  files[robot_type] = motions_file;
+}
+
+std::string Motion_registry::motions_file(const std::string &robot_type) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = files.find(robot_type);
+  if (it == files.end()) {
+    throw std::runtime_error("Unknown motion filename for this robottype! " +
+                             robot_type);
+  }
+  return it->second;
+}
+
+void Motion_registry::read_from_yaml(const std::string &file) {
+  YAML::Node node = YAML::LoadFile(file);
+  for (const auto &kv : node) {
+    set_motions_file(kv.first.as<std::string>(), kv.second.as<std::string>());
+  }
+}
+
+size_t Motion_registry::num_loads() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return loads;
+}
+
+size_t Motion_registry::num_hits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return hits;
+}
+
+// the primitive file (path, size and time) and the processing of the
+// trajectories
+uint64_t primitive_file_hash(const std::string &motions_file) {
+  Fnv_hash h;
+  h.add(std::filesystem::absolute(motions_file).string());
+  h.add(static_cast<uint64_t>(std::filesystem::file_size(motions_file)));
+  h.add(static_cast<int64_t>(std::filesystem::last_write_time(motions_file)
+                                 .time_since_epoch()
+                                 .count()));
+  return h.value;
+}
+
+static uint64_t primitive_cache_hash(const std::string &motions_file,
+                                     const dynobench::Model_robot &robot,
+                                     size_t max_motions) {
+  Fnv_hash h;
+  h.add(primitive_file_hash(motions_file));
+  h.add(robot.name);
+  h.add(static_cast<uint64_t>(robot.nx));
+  h.add(static_cast<uint64_t>(max_motions));
+  return h.value;
+}
+
+dynobench::Trajectories
+Motion_registry::trajectories(const std::string &motions_file,
+                              dynobench::Model_robot &robot,
+                              size_t max_motions) {
+
+  std::string file;
+  uint64_t hash = 0;
+  if (cache_dir.size()) {
+    hash = primitive_cache_hash(motions_file, robot, max_motions);
+    std::stringstream ss;
+    ss << cache_dir << "/motions_" << std::hex << hash << ".bin";
+    file = ss.str();
+    dynobench::Trajectories trajs;
+    if (read_primitive_cache(file, hash, trajs)) {
+      std::cout << "loaded primitive cache " << file << std::endl;
+      return trajs;
+    }
+  }
+
+  dynobench::Trajectories trajs =
+      load_primitive_trajectories(motions_file, robot, max_motions);
+  if (file.size()) {
+    write_primitive_cache(file, hash, trajs);
+  }
+  return trajs;
+}
+
+std::shared_ptr<std::vector<Motion>>
+Motion_registry::load(const std::string &motions_file,
+                      dynobench::Model_robot &robot, size_t max_motions,
+                      bool cut_actions, bool shuffle, bool compute_col) {
+
+  std::stringstream key;
+  key << motions_file << "|" << robot.name << "|" << max_motions << "|"
+      << cut_actions << shuffle << compute_col;
+
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Entry> &e = entries[key.str()];
+    if (!e) {
+      e = std::make_shared<Entry>();
+    }
+    entry = e;
+  }
+
+  // only this set waits for the load
+  std::lock_guard<std::mutex> lock_entry(entry->mutex);
+  if (entry->motions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    hits++;
+    return entry->motions;
+  }
+
+  Stopwatch watch;
+  auto motions = std::make_shared<std::vector<Motion>>();
+  trajectories_to_motions(trajectories(motions_file, robot, max_motions),
+                          robot, *motions, cut_actions, shuffle, compute_col);
+  CHECK(motions->size(), AT);
+  std::cout << "motion registry: " << motions_file << " " << motions->size()
+            << " motions in " << watch.elapsed_ms() << " ms" << std::endl;
+  entry->motions = motions;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  loads++;
+  return motions;
+}
+
+void write_primitive_cache(const std::string &file, uint64_t hash,
+                           const dynobench::Trajectories &trajs) {
+
+  create_dir_if_necessary(file.c_str());
+  // write to a tmp file first, so that a concurrent reader never sees a
+  // partial cache
+  std::string tmp_file = tmp_file_name(file);
+  {
+    std::ofstream out(tmp_file, std::ios::binary);
+    CHECK(out.good(), "cannot write " + tmp_file);
+
+    auto write_u64 = [&](uint64_t x) {
+      out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    };
+    auto write_vectors = [&](const std::vector<Eigen::VectorXd> &xs) {
+      write_u64(xs.size());
+      for (auto &x : xs) {
+        write_u64(x.size());
+        out.write(reinterpret_cast<const char *>(x.data()),
+                  x.size() * sizeof(double));
+      }
+    };
+
+    out.write(primitive_cache_magic, sizeof(primitive_cache_magic));
+    write_u64(hash);
+    write_u64(trajs.data.size());
+    for (auto &traj : trajs.data) {
+      out.write(reinterpret_cast<const char *>(&traj.cost),
+                sizeof(traj.cost));
+      write_vectors(traj.states);
+      write_vectors(traj.actions);
+    }
+  }
+  std::filesystem::rename(tmp_file, file);
+}
+
+bool read_primitive_cache(const std::string &file, uint64_t hash,
+                          dynobench::Trajectories &trajs) {
+
+  std::ifstream in(file, std::ios::binary);
+  if (!in.good()) {
+    return false;
+  }
+
+  // every count is checked against the bytes left in the file, so that a
+  // truncated or corrupted cache is reloaded instead of allocating garbage
+  uint64_t left = std::filesystem::file_size(file);
+  auto read = [&](void *x, uint64_t size) {
+    if (size > left) {
+      left = 0;
+      in.setstate(std::ios::failbit);
+      return false;
+    }
+    left -= size;
+    in.read(reinterpret_cast<char *>(x), size);
+    return in.good();
+  };
+  auto read_count = [&](uint64_t &n, uint64_t min_size) {
+    return read(&n, sizeof(n)) && n <= left / min_size;
+  };
+  auto read_vectors = [&](std::vector<Eigen::VectorXd> &xs) {
+    uint64_t n = 0;
+    if (!read_count(n, sizeof(uint64_t))) {
+      return false;
+    }
+    xs.resize(n);
+    for (auto &x : xs) {
+      uint64_t size = 0;
+      if (!read_count(size, sizeof(double))) {
+        return false;
+      }
+      x.resize(size);
+      if (!read(x.data(), size * sizeof(double))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  char magic[sizeof(primitive_cache_magic)];
+  uint64_t file_hash = 0;
+  if (!read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), primitive_cache_magic) ||
+      !read(&file_hash, sizeof(file_hash)) || file_hash != hash) {
+    std::cout << "WARNING: ignoring primitive cache " << file << std::endl;
+    return false;
+  }
+
+  // a trajectory has at least a cost and two counts
+  uint64_t num_trajs = 0;
+  bool ok = read_count(num_trajs, sizeof(double) + 2 * sizeof(uint64_t));
+  if (ok) {
+    trajs.data.resize(num_trajs);
+  }
+  for (size_t i = 0; ok && i < trajs.data.size(); i++) {
+    auto &traj = trajs.data[i];
+    ok = read(&traj.cost, sizeof(traj.cost)) && read_vectors(traj.states) &&
+         read_vectors(traj.actions);
+  }
+  if (!ok || left) {
+    std::cout << "WARNING: ignoring primitive cache " << file << ", wrong size"
+              << std::endl;
+    trajs.data.clear();
+    return false;
+  }
+  return true;
+}
+
+} // namespace dynoplan
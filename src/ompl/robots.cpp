@@ -3058,12 +3058,10 @@ robot_factory_ompl(const dynobench::Problem &problem) {
   return out;
 }
 
-void load_motion_primitives_new(const std::string &motionsFile,
-                                dynobench::Model_robot &robot,
-                                std::vector<Motion> &motions, int max_motions,
-                                bool cut_actions, bool shuffle,
-                                bool compute_col,
-                                MotionPrimitiveFormat format) {
+dynobench::Trajectories
+load_primitive_trajectories(const std::string &motionsFile,
+                            dynobench::Model_robot &robot, int max_motions,
+                            MotionPrimitiveFormat format) {
 
   dynobench::Trajectories trajs;
 
@@ -3108,8 +3106,6 @@ void load_motion_primitives_new(const std::string &motionsFile,
   std::cout << "first state is " << std::endl;
   CSTR_V(trajs.data.front().states.front());
 
-  motions.resize(trajs.data.size());
-
   bool add_noise_first_state = true;
   CSTR_(add_noise_first_state);
 
@@ -3136,6 +3132,15 @@ void load_motion_primitives_new(const std::string &motionsFile,
     }
   }
 
+  return trajs;
+}
+
+void trajectories_to_motions(const dynobench::Trajectories &trajs,
+                             dynobench::Model_robot &robot,
+                             std::vector<Motion> &motions, bool cut_actions,
+                             bool shuffle, bool compute_col) {
+
+  motions.resize(trajs.data.size());
   CSTR_(trajs.data.size());
   std::cout << "from boost to motion " << std::endl;
 
@@ -3173,6 +3178,17 @@ void load_motion_primitives_new(const std::string &motionsFile,
   }
 }
 
+void load_motion_primitives_new(const std::string &motionsFile,
+                                dynobench::Model_robot &robot,
+                                std::vector<Motion> &motions, int max_motions,
+                                bool cut_actions, bool shuffle,
+                                bool compute_col,
+                                MotionPrimitiveFormat format) {
+  trajectories_to_motions(
+      load_primitive_trajectories(motionsFile, robot, max_motions, format),
+      robot, motions, cut_actions, shuffle, compute_col);
+}
+
 void traj_to_motion(const dynobench::Trajectory &traj,
                     dynobench::Model_robot &robot, Motion &motion_out,
                     bool compute_col) {
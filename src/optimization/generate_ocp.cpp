@@ -517,6 +517,15 @@ std::vector<ReportCost> report_problem(ptr<crocoddyl::ShootingProblem> problem,
                                        const std::vector<Vxd> &xs,
                                        const std::vector<Vxd> &us,
                                        const char *file_name) {
+  create_dir_if_necessary(file_name);
+  std::ofstream reports_file(file_name);
+  return report_problem(problem, xs, us, reports_file);
+}
+
+std::vector<ReportCost> report_problem(ptr<crocoddyl::ShootingProblem> problem,
+                                       const std::vector<Vxd> &xs,
+                                       const std::vector<Vxd> &us,
+                                       std::ostream &reports_file) {
   std::vector<ReportCost> reports;
 
   for (size_t i = 0; i < problem->get_runningModels().size(); i++) {
@@ -550,9 +559,6 @@ std::vector<ReportCost> report_problem(ptr<crocoddyl::ShootingProblem> problem,
   std::string two_space = "  ";
   std::string four_space = "    ";
 
-  create_dir_if_necessary(file_name);
-
-  std::ofstream reports_file(file_name);
   for (auto &report : reports) {
     reports_file << "-" << one_space << "name: " << report.name << std::endl;
     reports_file << two_space << "time: " << report.time << std::endl;
@@ -14,6 +14,7 @@
 #include "dynobench/quadrotor_payload_n.hpp"
 #include "dynobench/robot_models.hpp"
 #include "dynoplan/optimization/croco_models.hpp"
+#include "dynoplan/output_sink.hpp"
 
 using vstr = std::vector<std::string>;
 using V2d = Eigen::Vector2d;
@@ -548,25 +549,29 @@ void write_states_controls(const std::vector<Eigen::VectorXd> &xs,
                            const std::vector<Eigen::VectorXd> &us,
                            std::shared_ptr<dynobench::Model_robot> model_robot,
                            const dynobench::Problem &problem,
-                           const char *filename) {
+                           const std::string &filename, Output_sink &sink) {
 
-  // store the init guess:
-  dynobench::Trajectory __traj;
-  __traj.actions = us;
-  __traj.states = xs;
-
-  {
-    std::ofstream out(filename + std::string(".raw.yaml"));
-    out << "states:" << std::endl;
+  if (auto out = sink.open(filename + ".raw.yaml")) {
+    *out << "states:" << std::endl;
     for (auto &x : xs) {
-      out << "- " << x.format(FMT) << std::endl;
+      *out << "- " << x.format(FMT) << std::endl;
     }
-    out << "actions:" << std::endl;
+    *out << "actions:" << std::endl;
     for (auto &u : us) {
-      out << "- " << u.format(FMT) << std::endl;
+      *out << "- " << u.format(FMT) << std::endl;
     }
   }
 
+  auto init_guess = sink.open(filename);
+  if (!init_guess) {
+    return;
+  }
+
+  // store the init guess:
+  dynobench::Trajectory __traj;
+  __traj.actions = us;
+  __traj.states = xs;
+
   if (__traj.actions.front().size() > model_robot->nu) {
     for (size_t i = 0; i < __traj.actions.size(); i++) {
       __traj.actions.at(i) =
@@ -580,25 +585,15 @@ void write_states_controls(const std::vector<Eigen::VectorXd> &xs,
     }
   }
 
-  // }
-
   __traj.start = problem.start;
   __traj.goal = problem.goal;
 
-  // create directory if necessary
-  if (const std::filesystem::path path =
-          std::filesystem::path(filename).parent_path();
-      !path.empty()) {
-    std::filesystem::create_directories(path);
-  }
-
-  std::ofstream init_guess(filename);
   CSTR_(filename);
 
   std::cout << "Check traj in controls " << std::endl;
   __traj.check(model_robot, true);
   std::cout << "Check traj in controls -- DONE " << std::endl;
-  __traj.to_yaml_format(init_guess);
+  __traj.to_yaml_format(*init_guess);
 }
 
 void fix_problem_quaternion(Eigen::VectorXd &start, Eigen::VectorXd &goal,
@@ -957,15 +952,19 @@ void solve_for_fixed_penalty(
     add_noise(options_trajopt_local.noise_level, xs, us, model_robot);
   }
 
+  Output_sink &sink = get_output_sink(options_trajopt_local.output_sink,
+                                      options_trajopt_local.output_mode);
+
   // store init guess
-  report_problem(problem_croco, xs, us, "/tmp/dynoplan/report-0.yaml");
+  if (auto out = sink.open("/tmp/dynoplan/report-0.yaml")) {
+    report_problem(problem_croco, xs, us, *out);
+  }
   std::cout << "solving with croco " << AT << std::endl;
 
   std::string random_id = gen_random(6);
-  {
-    std::string filename = folder_tmptraj + "init_guess_" + random_id + ".yaml";
-    write_states_controls(xs, us, model_robot, problem, filename.c_str());
-  }
+  write_states_controls(xs, us, model_robot, problem,
+                        folder_tmptraj + "init_guess_" + random_id + ".yaml",
+                        sink);
 
   // solve
   crocoddyl::SolverBoxFDDP ddp(problem_croco);
@@ -1002,8 +1001,10 @@ void solve_for_fixed_penalty(
     model_robot->ensure(x);
   }
 
-  write_states_controls(xs_out, us_out, model_robot, problem, filename.c_str());
-  report_problem(problem_croco, xs_out, us_out, "/tmp/dynoplan/report-1.yaml");
+  write_states_controls(xs_out, us_out, model_robot, problem, filename, sink);
+  if (auto out = sink.open("/tmp/dynoplan/report-1.yaml")) {
+    report_problem(problem_croco, xs_out, us_out, *out);
+  }
 };
 
 void __trajectory_optimization(
@@ -1039,6 +1040,8 @@ void __trajectory_optimization(
   const bool modify_to_match_goal_start = false;
   const bool store_iterations = false;
   const std::string folder_tmptraj = "/tmp/dynoplan/";
+  Output_sink &sink = get_output_sink(options_trajopt_local.output_sink,
+                                      options_trajopt_local.output_mode);
 
   std::cout
       << "WARNING: "
@@ -1087,7 +1090,7 @@ void __trajectory_optimization(
   }
 
   write_states_controls(xs_init, us_init, model_robot, problem,
-                        (folder_tmptraj + "init_guess.yaml").c_str());
+                        folder_tmptraj + "init_guess.yaml", sink);
 
   size_t num_smooth_iterations =
       dt > .05 ? 3 : 5; // TODO: put this as an option in command line
@@ -1116,14 +1119,17 @@ void __trajectory_optimization(
   }
 
   write_states_controls(xs_init, us_init, model_robot, problem,
-                        (folder_tmptraj + "init_guess_smooth.yaml").c_str());
+                        folder_tmptraj + "init_guess_smooth.yaml", sink);
 
   bool success = false;
   std::vector<Vxd> xs_out, us_out;
 
-  create_dir_if_necessary(options_trajopt_local.debug_file_name.c_str());
-  std::ofstream debug_file_yaml(options_trajopt_local.debug_file_name);
-  {
+  // Debug file of the optimization, written only if the sink keeps it
+  std::unique_ptr<std::ostream> debug_out =
+      sink.open(options_trajopt_local.debug_file_name);
+  std::ostream debug_null(nullptr);
+  std::ostream &debug_file_yaml = debug_out ? *debug_out : debug_null;
+  if (debug_out) {
     debug_file_yaml << "robotType: " << problem.robotType << std::endl;
     debug_file_yaml << "N: " << N << std::endl;
     debug_file_yaml << "start: " << start.format(FMT) << std::endl;
@@ -1162,7 +1168,9 @@ void __trajectory_optimization(
     xs_opt.push_back(start);
     xs_init_rewrite.at(0) = start;
 
-    debug_file_yaml << "opti:" << std::endl;
+    if (debug_out) {
+      debug_file_yaml << "opti:" << std::endl;
+    }
 
     auto times = Vxd::LinSpaced(xs_init.size(), 0, (xs_init.size() - 1) * dt);
 
@@ -1433,15 +1441,16 @@ void __trajectory_optimization(
         add_noise(options_trajopt_local.noise_level, xs, us, model_robot);
       }
 
-      report_problem(problem_croco, xs, us, "/tmp/dynoplan/report-0.yaml");
+      if (auto out = sink.open("/tmp/dynoplan/report-0.yaml")) {
+        report_problem(problem_croco, xs, us, *out);
+      }
 
       std::string random_id = gen_random(6);
 
-      {
-        std::string filename =
-            folder_tmptraj + "init_guess_" + random_id + ".yaml";
-        write_states_controls(xs, us, model_robot, problem, filename.c_str());
-      }
+      write_states_controls(xs, us, model_robot, problem,
+                            folder_tmptraj + "init_guess_" + random_id +
+                                ".yaml",
+                            sink);
 
       std::cout << "CROCO optimize" << AT << std::endl;
       crocoddyl::Timer timer;
@@ -1456,22 +1465,24 @@ void __trajectory_optimization(
       {
         std::string filename = folder_tmptraj + "opt_" + random_id + ".yaml";
         write_states_controls(ddp.get_xs(), ddp.get_us(), model_robot, problem,
-                              filename.c_str());
-
-        std::string filename_raw =
-            folder_tmptraj + "opt_" + random_id + ".raw.yaml";
-        dynobench::Trajectory traj;
-        traj.states = ddp.get_xs();
-        traj.actions = ddp.get_us();
-        traj.to_yaml_format(filename_raw.c_str());
+                              filename, sink);
+
+        if (auto out = sink.open(folder_tmptraj + "opt_" + random_id +
+                                 ".raw.yaml")) {
+          dynobench::Trajectory traj;
+          traj.states = ddp.get_xs();
+          traj.actions = ddp.get_us();
+          traj.to_yaml_format(*out);
+        }
       }
 
       double time_i = timer.get_duration();
       size_t iterations_i = ddp.get_iter();
       ddp_iterations += ddp.get_iter();
       ddp_time += timer.get_duration();
-      report_problem(problem_croco, ddp.get_xs(), ddp.get_us(),
-                     "/tmp/dynoplan/report-1.yaml");
+      if (auto out = sink.open("/tmp/dynoplan/report-1.yaml")) {
+        report_problem(problem_croco, ddp.get_xs(), ddp.get_us(), *out);
+      }
 
       std::cout << "time: " << time_i << std::endl;
       std::cout << "iterations: " << iterations_i << std::endl;
@@ -1613,33 +1624,38 @@ void __trajectory_optimization(
       }
 
       // DEBUGGING
-      debug_file_yaml << "  - xs0:" << std::endl;
-      for (auto &x : xs)
-        debug_file_yaml << "    - " << x.format(FMT) << std::endl;
+      if (debug_out) {
+        debug_file_yaml << "  - xs0:" << std::endl;
+        for (auto &x : xs)
+          debug_file_yaml << "    - " << x.format(FMT) << std::endl;
 
-      debug_file_yaml << "    us0:" << std::endl;
-      for (auto &u : us)
-        debug_file_yaml << "    - " << u.format(FMT) << std::endl;
+        debug_file_yaml << "    us0:" << std::endl;
+        for (auto &u : us)
+          debug_file_yaml << "    - " << u.format(FMT) << std::endl;
 
-      debug_file_yaml << "    xsOPT:" << std::endl;
-      for (auto &x : xs_i_sol)
-        debug_file_yaml << "    - " << x.format(FMT) << std::endl;
+        debug_file_yaml << "    xsOPT:" << std::endl;
+        for (auto &x : xs_i_sol)
+          debug_file_yaml << "    - " << x.format(FMT) << std::endl;
 
-      debug_file_yaml << "    usOPT:" << std::endl;
-      for (auto &u : us_i_sol)
-        debug_file_yaml << "    - " << u.format(FMT) << std::endl;
+        debug_file_yaml << "    usOPT:" << std::endl;
+        for (auto &u : us_i_sol)
+          debug_file_yaml << "    - " << u.format(FMT) << std::endl;
 
-      debug_file_yaml << "    start: " << xs.front().format(FMT) << std::endl;
+        debug_file_yaml << "    start: " << xs.front().format(FMT)
+                        << std::endl;
 
-      if (solver == SOLVER::mpc || solver == SOLVER::mpc_adaptative) {
-        debug_file_yaml << "    goal: " << goal_mpc.format(FMT) << std::endl;
-      } else if (solver == SOLVER::mpcc || solver == SOLVER::mpcc_linear) {
-        double alpha_mpcc = ddp.get_xs().back()(_nx);
-        Vxd out(_nx);
-        Vxd Jout(_nx);
-        path->interpolate(alpha_mpcc, out, Jout);
-        debug_file_yaml << "    alpha: " << alpha_mpcc << std::endl;
-        debug_file_yaml << "    state_alpha: " << out.format(FMT) << std::endl;
+        if (solver == SOLVER::mpc || solver == SOLVER::mpc_adaptative) {
+          debug_file_yaml << "    goal: " << goal_mpc.format(FMT)
+                          << std::endl;
+        } else if (solver == SOLVER::mpcc || solver == SOLVER::mpcc_linear) {
+          double alpha_mpcc = ddp.get_xs().back()(_nx);
+          Vxd out(_nx);
+          Vxd Jout(_nx);
+          path->interpolate(alpha_mpcc, out, Jout);
+          debug_file_yaml << "    alpha: " << alpha_mpcc << std::endl;
+          debug_file_yaml << "    state_alpha: " << out.format(FMT)
+                          << std::endl;
+        }
       }
 
       DYNO_CHECK_EQ(us_i_sol.size() + 1, xs_i_sol.size(), AT);
@@ -1664,13 +1680,15 @@ void __trajectory_optimization(
     xs_out = xs_opt;
     us_out = us_opt;
 
-    debug_file_yaml << "xsOPT: " << std::endl;
-    for (auto &x : xs_out)
-      debug_file_yaml << "  - " << x.format(FMT) << std::endl;
+    if (debug_out) {
+      debug_file_yaml << "xsOPT: " << std::endl;
+      for (auto &x : xs_out)
+        debug_file_yaml << "  - " << x.format(FMT) << std::endl;
 
-    debug_file_yaml << "usOPT: " << std::endl;
-    for (auto &u : us_out)
-      debug_file_yaml << "  - " << u.format(FMT) << std::endl;
+      debug_file_yaml << "usOPT: " << std::endl;
+      for (auto &u : us_out)
+        debug_file_yaml << "  - " << u.format(FMT) << std::endl;
+    }
 
     // checking feasibility
     Trajectory traj;
@@ -1835,7 +1853,7 @@ void __trajectory_optimization(
     }
 
     // write out the solution
-    {
+    if (debug_out) {
       debug_file_yaml << "xsOPT: " << std::endl;
       for (auto &x : xs_out)
         debug_file_yaml << "  - " << x.format(FMT) << std::endl;
@@ -1848,8 +1866,6 @@ void __trajectory_optimization(
 
   // END OF Optimization
 
-  std::ofstream file_out_debug("/tmp/dynoplan/out.yaml");
-
   opti_out.success = success;
   // in some s
   // opti_out.feasible = feasible;
@@ -1882,7 +1898,9 @@ void __trajectory_optimization(
               "ddp_time=" +
               std::to_string(ddp_time) + "\"";
 
-  traj.to_yaml_format(file_out_debug);
+  if (auto out = sink.open("/tmp/dynoplan/out.yaml")) {
+    traj.to_yaml_format(*out);
+  }
 
   opti_out.data.insert({"ddp_time", std::to_string(ddp_time)});
 
@@ -0,0 +1,230 @@
+#include "dynoplan/tdbastar/cbs.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+#include "dynobench/general_utils.hpp"
+#include "dynobench/robot_models.hpp"
+#include "dynoplan/tdbastar/tdbastar.hpp"
+#include "dynoplan/thread_pool.hpp"
+
+namespace dynoplan {
+
+void Options_cbs::__load_data(void *source, bool boost, bool write,
+                              const std::string &be) {
+  Loader loader;
+  loader.use_boost = boost;
+  loader.print = write;
+  loader.source = source;
+  loader.be = be;
+
+  loader.set(VAR_WITH_NAME(max_expands));
+  loader.set(VAR_WITH_NAME(timelimit));
+  loader.set(VAR_WITH_NAME(num_threads));
+  loader.set(VAR_WITH_NAME(reverse_heuristic));
+  loader.set(VAR_WITH_NAME(incremental));
+}
+
+void Options_cbs::add_options(po::options_description &desc) {
+  __load_data(&desc, true);
+}
+
+void Options_cbs::print(std::ostream &out, const std::string &be,
+                        const std::string &af) const {
+  auto ptr = const_cast<Options_cbs *>(this);
+  ptr->__load_data(&out, false, true, be);
+}
+
+void Options_cbs::read_from_yaml(const YAML::Node &node) {
+  __load_data(&const_cast<YAML::Node &>(node), false);
+}
+
+namespace {
+
+// node of the constraint tree
+struct Cbs_node {
+  std::vector<std::vector<Constraint>> constraints; // one list per robot
+  std::vector<dynobench::Trajectory> trajs;
+  double cost = 0;
+  size_t id = 0;
+};
+
+struct compare_cbs_node {
+  bool operator()(const Cbs_node *a, const Cbs_node *b) const {
+    // lowest cost first, then oldest first
+    if (a->cost != b->cost) {
+      return a->cost > b->cost;
+    }
+    return a->id > b->id;
+  }
+};
+
+} // namespace
+
+void cbs(dynobench::Problem &problem,
+         const std::map<std::string, Options_tdbastar> &options_tdbastar,
+         const Options_cbs &options_cbs,
+         std::vector<dynobench::Trajectory> &trajs_out,
+         Out_info_cbs &out_info_cbs) {
+
+  Stopwatch watch;
+  const size_t num_robots = problem.robotTypes.size();
+  CHECK(num_robots, AT);
+  DYNO_CHECK_EQ(problem.starts.size(), num_robots, AT);
+  DYNO_CHECK_EQ(problem.goals.size(), num_robots, AT);
+
+  std::vector<std::shared_ptr<dynobench::Model_robot>> robots(num_robots);
+  for (size_t i = 0; i < num_robots; i++) {
+    CHECK(options_tdbastar.count(problem.robotTypes[i]),
+          "no options for robot type " + problem.robotTypes[i]);
+    robots[i] = dynobench::robot_factory(
+        (problem.models_base_path + problem.robotTypes[i] + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub);
+    load_env(*robots[i], problem);
+    // constraints are indexed by time step
+    DYNO_CHECK_EQ(robots[i]->ref_dt, robots[0]->ref_dt, AT);
+  }
+  const double delta = options_tdbastar.at(problem.robotTypes[0]).delta;
+  const double ref_dt = robots[0]->ref_dt;
+  const Conflict_detector conflict_detector(robots, problem.robotTypes, delta);
+
+  Thread_pool pool(options_cbs.num_threads);
+  std::mutex mutex;
+  std::map<std::string, std::shared_ptr<const Primitive_library>> libraries =
+      load_primitive_libraries(problem.robotTypes, robots,
+                               options_tdbastar, pool);
+
+  std::vector<Search_tree> heuristics(num_robots);
+  std::vector<Tdbastar_cache> caches(num_robots);
+
+  // tdbastar for one robot. Returns false if the robot does not reach the
+  // goal
+  auto low_level = [&](size_t robot_id,
+                       const std::vector<Constraint> &constraints,
+                       dynobench::Trajectory &traj, bool reverse_search) {
+    const std::string &robot_type = problem.robotTypes[robot_id];
+    Options_tdbastar options = options_tdbastar.at(robot_type);
+    options.primitives_ptr = libraries.at(robot_type).get();
+
+    Stopwatch watch_low_level;
+    Out_info_tdb out_tdb;
+    std::vector<dynobench::Trajectory> expanded_trajs;
+    traj = dynobench::Trajectory();
+    size_t id = robot_id;
+    tdbastar(problem, options, traj, constraints, out_tdb, id, reverse_search,
+             expanded_trajs, heuristics[robot_id].T_n.get(),
+             reverse_search ? &heuristics[robot_id] : nullptr,
+             !reverse_search && options_cbs.incremental ? &caches[robot_id]
+                                                        : nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    out_info_cbs.time_low_level += watch_low_level.elapsed_ms();
+    if (!reverse_search) {
+      out_info_cbs.num_replans++;
+    }
+    return static_cast<bool>(out_tdb.solved);
+  };
+
+  if (options_cbs.reverse_heuristic) {
+    pool.parallel_for(num_robots, [&](size_t i, size_t) {
+      dynobench::Trajectory traj;
+      low_level(i, {}, traj, true);
+    });
+  }
+
+  std::vector<std::unique_ptr<Cbs_node>> all_nodes;
+  std::priority_queue<Cbs_node *, std::vector<Cbs_node *>, compare_cbs_node>
+      open;
+
+  auto cost = [](const std::vector<dynobench::Trajectory> &trajs) {
+    double c = 0;
+    for (auto &traj : trajs) {
+      c += traj.cost;
+    }
+    return c;
+  };
+
+  {
+    all_nodes.push_back(std::make_unique<Cbs_node>());
+    Cbs_node *root = all_nodes.back().get();
+    root->constraints.resize(num_robots);
+    root->trajs.resize(num_robots);
+    std::vector<char> solved(num_robots, false);
+    pool.parallel_for(num_robots, [&](size_t i, size_t) {
+      solved[i] = low_level(i, {}, root->trajs[i], false);
+    });
+    if (std::all_of(solved.begin(), solved.end(), [](char s) { return s; })) {
+      root->cost = cost(root->trajs);
+      open.push(root);
+    } else {
+      std::cout << "cbs: no solution for a robot without constraints"
+                << std::endl;
+    }
+  }
+
+  Cbs_conflict conflict;
+  while (open.size()) {
+
+    if (out_info_cbs.expands >= options_cbs.max_expands) {
+      std::cout << "cbs: max expands" << std::endl;
+      break;
+    }
+    if (watch.elapsed_ms() > options_cbs.timelimit) {
+      std::cout << "cbs: max time" << std::endl;
+      break;
+    }
+
+    Cbs_node *node = open.top();
+    open.pop();
+    out_info_cbs.expands++;
+
+    if (!conflict_detector.first_conflict(node->trajs, conflict, &pool)) {
+      out_info_cbs.solved = true;
+      out_info_cbs.cost = node->cost;
+      trajs_out = node->trajs;
+      break;
+    }
+
+    std::cout << "cbs: expands " << out_info_cbs.expands << " cost "
+              << node->cost << " conflict " << conflict.robot_a << " "
+              << conflict.robot_b << " at " << conflict.time_step << std::endl;
+
+    // one child for each robot of the conflict, replanned in parallel
+    std::array<std::unique_ptr<Cbs_node>, 2> children;
+    std::array<size_t, 2> robot_ids{conflict.robot_a, conflict.robot_b};
+    std::array<char, 2> solved{false, false};
+    for (size_t k = 0; k < 2; k++) {
+      children[k] = std::make_unique<Cbs_node>(*node);
+      children[k]->constraints[robot_ids[k]].push_back(
+          {conflict.time_step * ref_dt,
+           k == 0 ? conflict.state_a : conflict.state_b});
+    }
+    pool.parallel_for(2, [&](size_t k, size_t) {
+      size_t i = robot_ids[k];
+      solved[k] = low_level(i, children[k]->constraints[i],
+                            children[k]->trajs[i], false);
+    });
+
+    for (size_t k = 0; k < 2; k++) {
+      if (solved[k]) {
+        children[k]->cost = cost(children[k]->trajs);
+        children[k]->id = all_nodes.size();
+        open.push(children[k].get());
+        all_nodes.push_back(std::move(children[k]));
+      }
+    }
+  }
+
+  for (auto &cache : caches) {
+    out_info_cbs.cache_hits += cache.hits;
+  }
+  out_info_cbs.time_search = watch.elapsed_ms();
+  std::cout << "cbs:" << std::endl;
+  out_info_cbs.write_yaml(std::cout);
+}
+
+} // namespace dynoplan
@@ -0,0 +1,175 @@
+#include "dynoplan/tdbastar/conflicts.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#include "dynobench/dyno_macros.hpp"
+
+namespace dynoplan {
+
+static Eigen::Ref<const Eigen::VectorXd>
+state_at(const dynobench::Trajectory &traj, size_t time_step) {
+  return traj.states.at(std::min(time_step, traj.states.size() - 1));
+}
+
+static size_t max_time_steps(const std::vector<dynobench::Trajectory> &trajs) {
+  size_t max_size = 0;
+  for (auto &traj : trajs) {
+    CHECK(traj.states.size(), AT);
+    max_size = std::max(max_size, traj.states.size());
+  }
+  return max_size;
+}
+
+Conflict_detector::Conflict_detector(
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta)
+    : robots(robots), robot_types(robot_types), delta(delta) {
+
+  DYNO_CHECK_EQ(robots.size(), robot_types.size(), AT);
+  radius = delta;
+  for (auto &robot : robots) {
+    auto &w = robot->distance_weights;
+    if (!robot->get_translation_invariance() || !w.size() || w(0) <= 0) {
+      radius = std::numeric_limits<double>::infinity();
+      break;
+    }
+    radius = std::max(radius, delta / w(0));
+  }
+}
+
+bool Conflict_detector::in_conflict(
+    size_t a, size_t b, const Eigen::Ref<const Eigen::VectorXd> &x_a,
+    const Eigen::Ref<const Eigen::VectorXd> &x_b) const {
+  if (robot_types[a] == robot_types[b]) {
+    return robots[a]->distance(x_a, x_b) <= delta;
+  }
+  size_t dim = std::min(robots[a]->get_translation_invariance(),
+                        robots[b]->get_translation_invariance());
+  return (x_a.head(dim) - x_b.head(dim)).norm() <= delta;
+}
+
+bool Conflict_detector::first_conflict_in(
+    const std::vector<dynobench::Trajectory> &trajs, size_t t_begin,
+    size_t t_end, Cbs_conflict &conflict) const {
+
+  const size_t n = trajs.size();
+  std::vector<size_t> order(n);
+  std::vector<double> key(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+
+  for (size_t t = t_begin; t < t_end; t++) {
+    for (size_t i = 0; i < n; i++) {
+      key[i] = state_at(trajs[i], t)(0);
+    }
+    // insertion sort, starting from the order of the previous time step
+    for (size_t i = 1; i < n; i++) {
+      size_t r = order[i];
+      size_t j = i;
+      for (; j > 0 && key[order[j - 1]] > key[r]; j--) {
+        order[j] = order[j - 1];
+      }
+      order[j] = r;
+    }
+
+    bool found = false;
+    size_t best_a = 0, best_b = 0;
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = i + 1; j < n && key[order[j]] - key[order[i]] <= radius;
+           j++) {
+        size_t a = std::min(order[i], order[j]);
+        size_t b = std::max(order[i], order[j]);
+        if (found && std::make_pair(a, b) >= std::make_pair(best_a, best_b)) {
+          continue;
+        }
+        if (in_conflict(a, b, state_at(trajs[a], t), state_at(trajs[b], t))) {
+          found = true;
+          best_a = a;
+          best_b = b;
+        }
+      }
+    }
+    if (found) {
+      conflict = {best_a, best_b, t, state_at(trajs[best_a], t),
+                  state_at(trajs[best_b], t)};
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Conflict_detector::first_conflict(
+    const std::vector<dynobench::Trajectory> &trajs, Cbs_conflict &conflict,
+    Thread_pool *pool) const {
+
+  DYNO_CHECK_EQ(trajs.size(), robots.size(), AT);
+  const size_t max_size = max_time_steps(trajs);
+  CHECK(window > 0, AT);
+
+  if (!pool || pool->size() == 1 || max_size <= window) {
+    return first_conflict_in(trajs, 0, max_size, conflict);
+  }
+
+  const size_t num_windows = (max_size + window - 1) / window;
+  std::vector<Cbs_conflict> conflicts(num_windows);
+  std::vector<char> found(num_windows, false);
+  std::atomic<size_t> first_found{num_windows};
+  pool->parallel_for(num_windows, [&](size_t k, size_t) {
+    if (k > first_found.load()) {
+      return;
+    }
+    found[k] = first_conflict_in(trajs, k * window,
+                                 std::min(max_size, (k + 1) * window),
+                                 conflicts[k]);
+    if (found[k]) {
+      size_t current = first_found.load();
+      while (k < current && !first_found.compare_exchange_weak(current, k)) {
+      }
+    }
+  });
+
+  if (first_found.load() == num_windows) {
+    return false;
+  }
+  conflict = conflicts[first_found.load()];
+  return true;
+}
+
+bool first_conflict(
+    const std::vector<dynobench::Trajectory> &trajs,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta,
+    Cbs_conflict &conflict, Thread_pool *pool) {
+  return Conflict_detector(robots, robot_types, delta)
+      .first_conflict(trajs, conflict, pool);
+}
+
+bool first_conflict_brute_force(
+    const std::vector<dynobench::Trajectory> &trajs,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta,
+    Cbs_conflict &conflict) {
+
+  DYNO_CHECK_EQ(trajs.size(), robots.size(), AT);
+  Conflict_detector detector(robots, robot_types, delta);
+  const size_t max_size = max_time_steps(trajs);
+  for (size_t t = 0; t < max_size; t++) {
+    for (size_t a = 0; a < trajs.size(); a++) {
+      auto x_a = state_at(trajs[a], t);
+      for (size_t b = a + 1; b < trajs.size(); b++) {
+        auto x_b = state_at(trajs[b], t);
+        if (detector.in_conflict(a, b, x_a, x_b)) {
+          conflict = {a, b, t, x_a, x_b};
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace dynoplan
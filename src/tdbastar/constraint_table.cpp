@@ -0,0 +1,152 @@
+#include "dynoplan/tdbastar/constraint_table.hpp"
+
+#include <cmath>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynoplan/fnv_hash.hpp"
+
+namespace dynoplan {
+
+Constraint_table::Constraint_table(const std::vector<Constraint> &constraints,
+                                   dynobench::Model_robot &robot,
+                                   double delta)
+    : constraints(constraints), robot(robot), delta(delta),
+      ref_dt(robot.ref_dt) {
+
+  CHECK(ref_dt > 0, AT);
+  if (robot.distance_weights.size() && robot.distance_weights(0) > 0 &&
+      delta > 0) {
+    dim_pos = robot.get_translation_invariance();
+    cell_size = delta / robot.distance_weights(0);
+  }
+
+  all.resize(constraints.size());
+  for (size_t c = 0; c < constraints.size(); c++) {
+    all[c] = c;
+    buckets[std::lround(constraints[c].time / ref_dt)].all.push_back(c);
+  }
+
+  if (!dim_pos) {
+    return;
+  }
+
+  if (all.size() >= min_spatial) {
+    for (auto &c : all) {
+      cells_all[cell_key(constraints[c].constrained_state, 0)].push_back(c);
+    }
+  }
+  for (auto &[k, bucket] : buckets) {
+    if (bucket.all.size() >= min_spatial) {
+      for (auto &c : bucket.all) {
+        auto key = cell_key(constraints[c].constrained_state, 0);
+        bucket.cells[key].push_back(c);
+      }
+    }
+  }
+}
+
+int Constraint_table::time_index(size_t c, float g0) const {
+  // same rounding as the linear check: the offset is a float
+  float time_offset = constraints[c].time - g0;
+  return std::lround(time_offset / ref_dt);
+}
+
+bool Constraint_table::violated(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                size_t c) const {
+  return robot.distance(x, constraints[c].constrained_state) <= delta;
+}
+
+size_t Constraint_table::num_neighbours() const {
+  size_t n = 1;
+  for (size_t k = 0; k < dim_pos; k++) {
+    n *= 3;
+  }
+  return n;
+}
+
+// neighbour 0 is the cell of x, the others are the 3^dim_pos - 1 cells
+// around it
+uint64_t Constraint_table::cell_key(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                    size_t neighbour) const {
+  Fnv_hash h;
+  for (size_t k = 0; k < dim_pos; k++) {
+    int64_t cell = std::floor(x(k) / cell_size);
+    int64_t d = neighbour % 3;
+    h.add(cell + (d == 2 ? -1 : d));
+    neighbour /= 3;
+  }
+  return h.value;
+}
+
+template <typename Fun>
+bool Constraint_table::any_near(const Cells &cells,
+                                const std::vector<size_t> &list,
+                                const Eigen::Ref<const Eigen::VectorXd> &x,
+                                Fun f) const {
+  if (cells.empty()) {
+    for (auto &c : list) {
+      if (f(c)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  const size_t n = num_neighbours();
+  for (size_t i = 0; i < n; i++) {
+    if (auto it = cells.find(cell_key(x, i)); it != cells.end()) {
+      for (auto &c : it->second) {
+        if (f(c)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool Constraint_table::violated_after(
+    const Eigen::Ref<const Eigen::VectorXd> &x, double t_min) const {
+  return any_near(cells_all, all, x, [&](size_t c) {
+    return constraints[c].time >= t_min && violated(x, c);
+  });
+}
+
+bool Constraint_table::violated_trajectory(dynobench::TrajWrapper &traj,
+                                           float g0, bool reaches_goal) const {
+
+  if (constraints.empty()) {
+    return false;
+  }
+
+  const int size = traj.get_size();
+  // the time index of a constraint in bucket k is k - k0 - 1, k - k0 or
+  // k - k0 + 1 (both times are rounded)
+  const long k0 = std::lround(g0 / ref_dt);
+  auto it = buckets.lower_bound(k0 - 1);
+  auto end = buckets.upper_bound(k0 + size - 1);
+  for (; it != end; it++) {
+    auto &[k, bucket] = *it;
+    for (long i = k - k0 - 1; i <= k - k0 + 1; i++) {
+      if (i < 0 || i >= size - 1) {
+        continue;
+      }
+      auto x = traj.get_state(i);
+      if (any_near(bucket.cells, bucket.all, x, [&](size_t c) {
+            return time_index(c, g0) == i && violated(x, c);
+          })) {
+        return true;
+      }
+    }
+  }
+
+  if (reaches_goal) {
+    // the robot stays at the goal
+    auto x = traj.get_state(size - 1);
+    return any_near(cells_all, all, x, [&](size_t c) {
+      return time_index(c, g0) >= size - 1 && violated(x, c);
+    });
+  }
+  return false;
+}
+
+} // namespace dynoplan
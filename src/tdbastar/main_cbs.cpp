@@ -0,0 +1,153 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+
+// BOOST
+#include <boost/program_options.hpp>
+// DYNOPLAN
+#include "dynoplan/ompl/motion_registry.hpp"
+#include "dynoplan/tdbastar/cbs.hpp"
+#include "dynoplan/tdbastar/prioritized.hpp"
+#include "dynoplan/tdbastar/tdbastar.hpp"
+// DYNOBENCH
+#include "dynobench/general_utils.hpp"
+
+using namespace dynoplan;
+#define DYNOBENCH_BASE "../dynobench/"
+// Run from dynoplan/build
+
+int main(int argc, char *argv[]) {
+
+  namespace po = boost::program_options;
+  po::options_description desc("Allowed options");
+  std::string inputFile;
+  std::string outputFile;
+  std::string cfgFile;
+  std::string motionsRegistry;
+  std::string motionsCache;
+  double timeLimit;
+  bool use_prioritized = false;
+  size_t num_restarts = 8;
+  Options_cbs options_cbs;
+  options_cbs.add_options(desc);
+
+  desc.add_options()("help", "produce help message")(
+      "input,i", po::value<std::string>(&inputFile)->required(),
+      "input file (yaml)")("output,o",
+                           po::value<std::string>(&outputFile)->required(),
+                           "output file (yaml)")(
+      "cfg,c", po::value<std::string>(&cfgFile)->required(),
+      "configuration file (yaml)")(
+      "time_limit,t", po::value<double>(&timeLimit)->required(),
+      "time limit for search")(
+      "prioritized", po::bool_switch(&use_prioritized),
+      "prioritized planning instead of cbs")(
+      "num_restarts", po::value<size_t>(&num_restarts),
+      "priority orders of prioritized planning")(
+      "motions_registry", po::value<std::string>(&motionsRegistry),
+      "primitive file of each robot type (yaml)")(
+      "motions_cache", po::value<std::string>(&motionsCache),
+      "folder of the binary cache of the primitives");
+
+  try {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") != 0u) {
+      std::cout << desc << "\n";
+      return 0;
+    }
+  } catch (po::error &e) {
+    std::cerr << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  YAML::Node cfg = YAML::LoadFile(cfgFile);
+  cfg = cfg["db-cbs"]["default"];
+  options_cbs.timelimit = timeLimit;
+
+  dynobench::Problem problem(inputFile);
+  problem.models_base_path = DYNOBENCH_BASE + std::string("models/");
+
+  Motion_registry &registry = Motion_registry::instance();
+  registry.cache_dir = motionsCache;
+  if (motionsRegistry != "") {
+    registry.read_from_yaml(motionsRegistry);
+  }
+
+  // same low level options as main_tdbastar, for each robot type
+  std::map<std::string, Options_tdbastar> options_tdbastar;
+  for (auto &robot_type : problem.robotTypes) {
+    Options_tdbastar &options = options_tdbastar[robot_type];
+    options.outFile = outputFile;
+    options.search_timelimit = timeLimit;
+    options.cost_delta_factor = 0;
+    options.delta = cfg["delta_0"].as<float>();
+    options.fix_seed = 1;
+    options.max_motions = cfg["num_primitives_0"].as<size_t>();
+    options.motionsFile = registry.motions_file(robot_type);
+  }
+  std::vector<dynobench::Trajectory> trajs;
+  std::ofstream results(outputFile);
+  bool solved;
+  if (use_prioritized) {
+    // same threads, time and heuristic as cbs
+    Options_prioritized options_prioritized;
+    options_prioritized.num_restarts = num_restarts;
+    options_prioritized.num_threads = options_cbs.num_threads;
+    options_prioritized.timelimit = options_cbs.timelimit;
+    options_prioritized.reverse_heuristic = options_cbs.reverse_heuristic;
+    std::cout << "*** options_prioritized ***" << std::endl;
+    options_prioritized.print(std::cout);
+    std::cout << "***" << std::endl;
+
+    Out_info_prioritized out_prioritized;
+    prioritized(problem, options_tdbastar, options_prioritized, trajs,
+                out_prioritized);
+    solved = out_prioritized.solved;
+
+    results << "alg: prioritized" << std::endl;
+    results << "time_stamp: " << get_time_stamp() << std::endl;
+    results << "env_file: " << inputFile << std::endl;
+    results << "cfg_file: " << cfgFile << std::endl;
+    results << "options_prioritized:" << std::endl;
+    options_prioritized.print(results, "  ");
+    out_prioritized.write_yaml(results);
+  } else {
+    std::cout << "*** options_cbs ***" << std::endl;
+    options_cbs.print(std::cout);
+    std::cout << "***" << std::endl;
+
+    Out_info_cbs out_cbs;
+    cbs(problem, options_tdbastar, options_cbs, trajs, out_cbs);
+    solved = out_cbs.solved;
+
+    results << "alg: cbs" << std::endl;
+    results << "time_stamp: " << get_time_stamp() << std::endl;
+    results << "env_file: " << inputFile << std::endl;
+    results << "cfg_file: " << cfgFile << std::endl;
+    results << "options_cbs:" << std::endl;
+    options_cbs.print(results, "  ");
+    out_cbs.write_yaml(results);
+  }
+
+  if (!solved) {
+    return EXIT_FAILURE;
+  }
+
+  results << "result:" << std::endl;
+  for (auto &traj : trajs) {
+    results << "  - states:" << std::endl;
+    for (auto &x : traj.states) {
+      results << "      - " << x.format(dynobench::FMT) << std::endl;
+    }
+    results << "    actions:" << std::endl;
+    for (auto &u : traj.actions) {
+      results << "      - " << u.format(dynobench::FMT) << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
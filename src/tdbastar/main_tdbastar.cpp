@@ -15,6 +15,7 @@
 #include "dynobench/general_utils.hpp"
 #include "dynobench/robot_models_base.hpp"
 
+#include "dynoplan/ompl/motion_registry.hpp"
 #include "dynoplan/ompl/robots.h"
 
 using namespace dynoplan;
@@ -50,6 +51,8 @@ int main(int argc, char *argv[]) {
   std::string outputFile;
   std::string constraintsFile;
   std::string cfgFile;
+  std::string motionsRegistry;
+  std::string motionsCache;
   double timeLimit;
 
   desc.add_options()("help", "produce help message")(
@@ -62,7 +65,11 @@ int main(int argc, char *argv[]) {
                                  po::value<std::string>(&cfgFile)->required(),
                                  "configuration file (yaml)")(
       "time_limit,t", po::value<double>(&timeLimit)->required(),
-      "time limit for search");
+      "time limit for search")(
+      "motions_registry", po::value<std::string>(&motionsRegistry),
+      "primitive file of each robot type (yaml)")(
+      "motions_cache", po::value<std::string>(&motionsCache),
+      "folder of the binary cache of the primitives");
 
   try {
     po::variables_map vm;
@@ -89,6 +96,10 @@ int main(int argc, char *argv[]) {
   options_tdbastar.delta = cfg["delta_0"].as<float>();
   options_tdbastar.fix_seed = 1;
   options_tdbastar.max_motions = cfg["num_primitives_0"].as<size_t>();
+  if (cfg["record_expanded_trajs"]) {
+    options_tdbastar.record_expanded_trajs =
+        cfg["record_expanded_trajs"].as<int>();
+  }
   std::cout << "*** options_tdbastar ***" << std::endl;
   options_tdbastar.print(std::cout);
   std::cout << "***" << std::endl;
@@ -122,36 +133,28 @@ int main(int argc, char *argv[]) {
       i++;
     }
   }
-  bool save_expanded_trajs = false;
+  bool save_expanded_trajs = options_tdbastar.record_expanded_trajs != 0;
   const auto robot_type = problem.robotTypes[robot_id];
-  std::string motionsFile;
-  std::vector<Motion> motions;
-  if (robot_type == "unicycle1_v0" || robot_type == "unicycle1_sphere_v0") {
-    motionsFile = "../../new_format_motions/unicycle1_v0/unicycle1_v0.msgpack";
-  } else if (robot_type == "unicycle2_v0") {
-    motionsFile = "../../new_format_motions/unicycle2_v0/unicycle2_v0.msgpack";
-  } else if (robot_type == "car1_v0") {
-    motionsFile =
-        "../../new_format_motions/car_with_trailers/car_with_trailers.msgpack";
-  } else if (robot_type == "integrator2_2d_v0") {
-    motionsFile =
-        "../../new_format_motions/integrator2_2d_v0/integrator2_2d_v0.msgpack";
-  } else if (robot_type == "integrator2_3d_v0") {
-    motionsFile = "../../new_format_motions/integrator2_3d_v0/"
-                  "integrator2_3d_v0.bin.im.bin.sp.bin";
-  } else {
-    throw std::runtime_error("Unknown motion filename for this robottype!");
+  Motion_registry &registry = Motion_registry::instance();
+  registry.cache_dir = motionsCache;
+  if (motionsRegistry != "") {
+    registry.read_from_yaml(motionsRegistry);
   }
-  options_tdbastar.motionsFile = motionsFile;
+  options_tdbastar.motionsFile = registry.motions_file(robot_type);
   std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
       (problem.models_base_path + robot_type + ".yaml").c_str(), problem.p_lb,
       problem.p_ub);
 
-  load_motion_primitives_new(options_tdbastar.motionsFile, *robot, motions,
-                             options_tdbastar.max_motions,
-                             options_tdbastar.cut_actions, true,
-                             options_tdbastar.check_cols);
-  options_tdbastar.motions_ptr = &motions;
+  std::shared_ptr<std::vector<Motion>> motions =
+      registry.motions(robot_type, *robot, options_tdbastar.max_motions,
+                       options_tdbastar.cut_actions, true,
+                       options_tdbastar.check_cols);
+  options_tdbastar.motions_ptr = motions.get();
+  if (options_tdbastar.fix_seed) {
+    srand(0);
+  } else {
+    srand(time(0));
+  }
   std::vector<dynobench::Trajectory> expanded_trajs_tmp;
   tdbastar(problem, options_tdbastar, trajectory, constraints, out_tdb,
            robot_id, /*reverse_search*/ false, expanded_trajs_tmp, nullptr,
@@ -37,8 +37,16 @@ void Options_tdbastar::__load_data(void *source, bool boost, bool write,
   loader.set(VAR_WITH_NAME(max_size_heu_map));
   loader.set(VAR_WITH_NAME(heu_map_file));
   loader.set(VAR_WITH_NAME(heu_connection_radius));
+  loader.set(VAR_WITH_NAME(heu_grid_resolution));
+  loader.set(VAR_WITH_NAME(num_threads_heu));
+  loader.set(VAR_WITH_NAME(heu_cache_resolution));
+  loader.set(VAR_WITH_NAME(heu_cache_size));
   loader.set(VAR_WITH_NAME(use_nigh_nn));
   loader.set(VAR_WITH_NAME(check_cols));
+  loader.set(VAR_WITH_NAME(record_expanded_trajs));
+  loader.set(VAR_WITH_NAME(record_expanded_size));
+  loader.set(VAR_WITH_NAME(record_expanded_every));
+  loader.set(VAR_WITH_NAME(expanded_trajs_file));
 }
 
 void Options_tdbastar::add_options(po::options_description &desc) {
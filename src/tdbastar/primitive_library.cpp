@@ -0,0 +1,97 @@
+#include "dynoplan/tdbastar/primitive_library.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "dynobench/general_utils.hpp"
+#include "dynoplan/ompl/motion_registry.hpp"
+#include "dynoplan/nigh_custom_spaces.hpp"
+
+namespace dynoplan {
+
+static dynobench::Model_robot &
+checked(const std::shared_ptr<dynobench::Model_robot> &robot) {
+  CHECK(robot, AT);
+  return *robot;
+}
+
+Primitive_library::Primitive_library(
+    const std::string &robot_type,
+    const std::shared_ptr<dynobench::Model_robot> &robot,
+    const Options_tdbastar &options)
+    : robot_type(robot_type), motions_file(options.motionsFile), robot(robot),
+      shared_motions(Motion_registry::instance().load(
+          motions_file, checked(robot), options.max_motions,
+          options.cut_actions, false, options.check_cols)),
+      motions(*shared_motions), max_motions(options.max_motions),
+      cut_actions(options.cut_actions), check_cols(options.check_cols),
+      use_nigh_nn(options.use_nigh_nn),
+      grid_radius(options.alpha * options.delta) {
+
+  Stopwatch watch;
+  CHECK(motions.size(), AT);
+
+  for (bool reverse_search : {false, true}) {
+    std::unique_ptr<ompl::NearestNeighbors<Motion *>> &tree =
+        reverse_search ? T_m_reverse : T_m;
+    if (use_nigh_nn) {
+      tree.reset(nigh_factory_t<Motion *>(robot_type, robot, reverse_search));
+    } else {
+      tree.reset(grid_factory2<Motion *>(
+          robot_type, robot, grid_radius, [reverse_search](Motion *m) {
+            return reverse_search ? m->getLastStateEig() : m->getStateEig();
+          }));
+    }
+    for (auto &m : *shared_motions) {
+      tree->add(&m);
+    }
+  }
+  std::cout << "primitive library " << robot_type << ": " << motions.size()
+            << " motions, trees in " << watch.elapsed_ms() << " ms"
+            << std::endl;
+}
+
+bool Primitive_library::compatible(const std::string &robot_type,
+                                   const Options_tdbastar &options) const {
+  return robot_type == this->robot_type &&
+         options.motionsFile == motions_file &&
+         options.max_motions == max_motions &&
+         options.cut_actions == cut_actions &&
+         options.check_cols == check_cols &&
+         options.use_nigh_nn == use_nigh_nn &&
+         (use_nigh_nn ||
+          std::abs(options.alpha * options.delta - grid_radius) < 1e-9);
+}
+
+std::map<std::string, std::shared_ptr<const Primitive_library>>
+load_primitive_libraries(
+    const std::vector<std::string> &robot_types,
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::map<std::string, Options_tdbastar> &options,
+    Thread_pool &pool) {
+
+  DYNO_CHECK_EQ(robot_types.size(), robots.size(), AT);
+  // first robot of each type
+  std::vector<size_t> firsts;
+  for (size_t i = 0; i < robot_types.size(); i++) {
+    if (std::find(robot_types.begin(), robot_types.begin() + i,
+                  robot_types[i]) == robot_types.begin() + i) {
+      firsts.push_back(i);
+    }
+  }
+
+  std::vector<std::shared_ptr<const Primitive_library>> loaded(firsts.size());
+  pool.parallel_for(firsts.size(), [&](size_t k, size_t) {
+    const std::string &robot_type = robot_types[firsts[k]];
+    loaded[k] = std::make_shared<const Primitive_library>(
+        robot_type, robots[firsts[k]], options.at(robot_type));
+  });
+
+  std::map<std::string, std::shared_ptr<const Primitive_library>> out;
+  for (size_t k = 0; k < firsts.size(); k++) {
+    out[robot_types[firsts[k]]] = loaded[k];
+  }
+  return out;
+}
+
+} // namespace dynoplan
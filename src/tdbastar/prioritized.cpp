@@ -0,0 +1,193 @@
+#include "dynoplan/tdbastar/prioritized.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+
+#include "dynobench/general_utils.hpp"
+#include "dynobench/robot_models.hpp"
+#include "dynoplan/tdbastar/tdbastar.hpp"
+#include "dynoplan/thread_pool.hpp"
+
+namespace dynoplan {
+
+void Options_prioritized::__load_data(void *source, bool boost, bool write,
+                                      const std::string &be) {
+  Loader loader;
+  loader.use_boost = boost;
+  loader.print = write;
+  loader.source = source;
+  loader.be = be;
+
+  loader.set(VAR_WITH_NAME(num_restarts));
+  loader.set(VAR_WITH_NAME(seed));
+  loader.set(VAR_WITH_NAME(timelimit));
+  loader.set(VAR_WITH_NAME(num_threads));
+  loader.set(VAR_WITH_NAME(reverse_heuristic));
+  loader.set(VAR_WITH_NAME(stop_at_first));
+}
+
+void Options_prioritized::add_options(po::options_description &desc) {
+  __load_data(&desc, true);
+}
+
+void Options_prioritized::print(std::ostream &out, const std::string &be,
+                                const std::string &af) const {
+  auto ptr = const_cast<Options_prioritized *>(this);
+  ptr->__load_data(&out, false, true, be);
+}
+
+void Options_prioritized::read_from_yaml(const YAML::Node &node) {
+  __load_data(&const_cast<YAML::Node &>(node), false);
+}
+
+namespace {
+
+// Collision checks of each robot in the orders of the thread
+struct Prioritized_worker {
+  std::vector<Tdbastar_cache> caches;
+};
+
+} // namespace
+
+void prioritized(
+    dynobench::Problem &problem,
+    const std::map<std::string, Options_tdbastar> &options_tdbastar,
+    const Options_prioritized &options_prioritized,
+    std::vector<dynobench::Trajectory> &trajs_out,
+    Out_info_prioritized &out_info) {
+
+  Stopwatch watch;
+  const size_t num_robots = problem.robotTypes.size();
+  CHECK(num_robots, AT);
+  DYNO_CHECK_EQ(problem.starts.size(), num_robots, AT);
+  DYNO_CHECK_EQ(problem.goals.size(), num_robots, AT);
+  CHECK(options_prioritized.num_restarts, AT);
+
+  std::vector<std::shared_ptr<dynobench::Model_robot>> robots(num_robots);
+  for (size_t i = 0; i < num_robots; i++) {
+    CHECK(options_tdbastar.count(problem.robotTypes[i]),
+          "no options for robot type " + problem.robotTypes[i]);
+    robots[i] = dynobench::robot_factory(
+        (problem.models_base_path + problem.robotTypes[i] + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub);
+    load_env(*robots[i], problem);
+  }
+  const double delta = options_tdbastar.at(problem.robotTypes[0]).delta;
+
+  Thread_pool pool(options_prioritized.num_threads);
+  std::vector<Prioritized_worker> workers(pool.size());
+  for (auto &worker : workers) {
+    worker.caches.resize(num_robots);
+  }
+  std::mutex mutex;
+  std::map<std::string, std::shared_ptr<const Primitive_library>> libraries =
+      load_primitive_libraries(problem.robotTypes, robots,
+                               options_tdbastar, pool);
+
+  std::vector<Search_tree> heuristics(num_robots);
+
+  // tdbastar for one robot, in the thread worker_id. Returns false if the
+  // robot does not reach the goal
+  auto low_level = [&](size_t robot_id, size_t worker_id,
+                       const Reservation_table *reservations,
+                       dynobench::Trajectory &traj, bool reverse_search) {
+    const std::string &robot_type = problem.robotTypes[robot_id];
+    Options_tdbastar options = options_tdbastar.at(robot_type);
+    Prioritized_worker &worker = workers[worker_id];
+    options.primitives_ptr = libraries.at(robot_type).get();
+    options.reservations_ptr = reservations;
+
+    Stopwatch watch_low_level;
+    Out_info_tdb out_tdb;
+    std::vector<dynobench::Trajectory> expanded_trajs;
+    traj = dynobench::Trajectory();
+    size_t id = robot_id;
+    tdbastar(problem, options, traj, {}, out_tdb, id, reverse_search,
+             expanded_trajs, heuristics[robot_id].T_n.get(),
+             reverse_search ? &heuristics[robot_id] : nullptr,
+             reverse_search ? nullptr : &worker.caches[robot_id]);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    out_info.time_low_level += watch_low_level.elapsed_ms();
+    if (!reverse_search) {
+      out_info.num_replans++;
+    }
+    return static_cast<bool>(out_tdb.solved);
+  };
+
+  if (options_prioritized.reverse_heuristic) {
+    pool.parallel_for(num_robots, [&](size_t i, size_t worker_id) {
+      dynobench::Trajectory traj;
+      low_level(i, worker_id, nullptr, traj, true);
+    });
+  }
+
+  // the orders are generated up front, so they do not depend on the threads
+  std::vector<std::vector<size_t>> orders(options_prioritized.num_restarts);
+  std::mt19937 g(options_prioritized.seed);
+  for (size_t k = 0; k < orders.size(); k++) {
+    orders[k].resize(num_robots);
+    std::iota(orders[k].begin(), orders[k].end(), 0);
+    if (k > 0) {
+      std::shuffle(orders[k].begin(), orders[k].end(), g);
+    }
+  }
+
+  bool stop = false; // protected by mutex
+  pool.parallel_for(orders.size(), [&](size_t k, size_t worker_id) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stop || watch.elapsed_ms() > options_prioritized.timelimit) {
+        return;
+      }
+      out_info.num_restarts++;
+    }
+
+    Reservation_table reservations(robots, problem.robotTypes, delta);
+    std::vector<dynobench::Trajectory> trajs(num_robots);
+    double cost = 0;
+    for (auto &i : orders[k]) {
+      if (!low_level(i, worker_id, &reservations, trajs[i], false)) {
+        std::cout << "prioritized: order " << k << " fails at robot " << i
+                  << std::endl;
+        return;
+      }
+      reservations.add(i, trajs[i]);
+      cost += trajs[i].cost;
+    }
+    // sanity check, as the one of tdbastar with the constraints: an order
+    // with a conflict is not solved
+    Cbs_conflict conflict;
+    if (first_conflict(trajs, robots, problem.robotTypes, delta, conflict)) {
+      std::cout << "prioritized: VIOLATION in order " << k << ", robots "
+                << conflict.robot_a << " " << conflict.robot_b << " at "
+                << conflict.time_step << std::endl;
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::cout << "prioritized: order " << k << " cost " << cost << std::endl;
+    out_info.num_solved++;
+    // ties: the smallest order, so the result does not depend on the threads
+    if (!out_info.solved || cost < out_info.cost ||
+        (cost == out_info.cost && orders[k] < out_info.order)) {
+      out_info.solved = true;
+      out_info.cost = cost;
+      out_info.order = orders[k];
+      trajs_out = std::move(trajs);
+    }
+    if (options_prioritized.stop_at_first) {
+      stop = true;
+    }
+  });
+
+  out_info.time_search = watch.elapsed_ms();
+  std::cout << "prioritized:" << std::endl;
+  out_info.write_yaml(std::cout);
+}
+
+} // namespace dynoplan
@@ -0,0 +1,150 @@
+#include "dynoplan/tdbastar/reservation_table.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include "dynobench/dyno_macros.hpp"
+#include "dynoplan/fnv_hash.hpp"
+
+namespace dynoplan {
+
+Reservation_table::Reservation_table(
+    const std::vector<std::shared_ptr<dynobench::Model_robot>> &robots,
+    const std::vector<std::string> &robot_types, double delta)
+    : detector(robots, robot_types, delta) {
+
+  CHECK(robots.size(), AT);
+  ref_dt = robots[0]->ref_dt;
+  CHECK(ref_dt > 0, AT);
+  for (auto &robot : robots) {
+    DYNO_CHECK_EQ(robot->ref_dt, ref_dt, AT);
+  }
+  if (std::isfinite(detector.radius)) {
+    dim_pos = std::numeric_limits<size_t>::max();
+    for (auto &robot : robots) {
+      dim_pos = std::min(dim_pos, robot->get_translation_invariance());
+    }
+  }
+}
+
+// neighbour 0 is the cell of x, the others are the 3^dim_pos - 1 cells
+// around it
+uint64_t
+Reservation_table::cell_key(const Eigen::Ref<const Eigen::VectorXd> &x,
+                            size_t neighbour) const {
+  Fnv_hash h;
+  for (size_t k = 0; k < dim_pos; k++) {
+    int64_t cell = std::floor(x(k) / detector.radius);
+    int64_t d = neighbour % 3;
+    h.add(cell + (d == 2 ? -1 : d));
+    neighbour /= 3;
+  }
+  return h.value;
+}
+
+void Reservation_table::insert(Bucket &bucket, const Reservation &r) {
+  if (dim_pos) {
+    bucket.cells[cell_key(r.state, 0)].push_back(bucket.all.size());
+  }
+  bucket.all.push_back(r);
+}
+
+void Reservation_table::add(size_t robot,
+                            const dynobench::Trajectory &traj) {
+  CHECK(traj.states.size(), AT);
+  for (size_t t = 0; t < traj.states.size(); t++) {
+    Reservation r{robot, static_cast<long>(t), traj.states[t]};
+    insert(buckets[r.time_step], r);
+    insert(all, r);
+    num_states++;
+  }
+  parked.push_back(
+      {robot, static_cast<long>(traj.states.size() - 1), traj.states.back()});
+}
+
+template <typename Fun>
+bool Reservation_table::any_near(const Bucket &bucket,
+                                 const Eigen::Ref<const Eigen::VectorXd> &x,
+                                 Fun f) const {
+  if (!dim_pos) {
+    for (auto &r : bucket.all) {
+      if (f(r)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  size_t n = 1;
+  for (size_t k = 0; k < dim_pos; k++) {
+    n *= 3;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (auto it = bucket.cells.find(cell_key(x, i));
+        it != bucket.cells.end()) {
+      for (auto &idx : it->second) {
+        if (f(bucket.all[idx])) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool Reservation_table::in_conflict(
+    size_t robot, const Eigen::Ref<const Eigen::VectorXd> &x, long t) const {
+  auto conflict = [&](const Reservation &r) {
+    return r.robot != robot && detector.in_conflict(robot, r.robot, x, r.state);
+  };
+  if (auto it = buckets.find(t);
+      it != buckets.end() && any_near(it->second, x, conflict)) {
+    return true;
+  }
+  for (auto &r : parked) {
+    if (r.time_step < t && conflict(r)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Reservation_table::violated_after(
+    size_t robot, const Eigen::Ref<const Eigen::VectorXd> &x,
+    double time) const {
+  const long t = std::lround(time / ref_dt);
+  auto conflict = [&](const Reservation &r) {
+    return r.robot != robot && detector.in_conflict(robot, r.robot, x, r.state);
+  };
+  // the parked robots are there at all the times after their arrival
+  for (auto &r : parked) {
+    if (conflict(r)) {
+      return true;
+    }
+  }
+  return any_near(all, x, [&](const Reservation &r) {
+    return r.time_step >= t && conflict(r);
+  });
+}
+
+bool Reservation_table::violated_trajectory(size_t robot,
+                                            dynobench::TrajWrapper &traj,
+                                            float g0,
+                                            bool reaches_goal) const {
+  if (!num_states) {
+    return false;
+  }
+  const int size = traj.get_size();
+  const long k0 = std::lround(g0 / ref_dt);
+  for (int i = 0; i < size - 1; i++) {
+    if (in_conflict(robot, traj.get_state(i), k0 + i)) {
+      return true;
+    }
+  }
+  if (reaches_goal) {
+    return violated_after(robot, traj.get_state(size - 1),
+                          (k0 + size - 1) * ref_dt);
+  }
+  return false;
+}
+
+} // namespace dynoplan
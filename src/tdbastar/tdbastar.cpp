@@ -37,6 +37,7 @@
 
 #include "dynobench/general_utils.hpp"
 
+#include "dynoplan/fnv_hash.hpp"
 #include "dynoplan/nigh_custom_spaces.hpp"
 
 namespace dynoplan {
@@ -54,8 +55,8 @@ using Sample_ = ob::State;
 
 const char *duplicate_detection_str[] = {"NO", "HARD", "SOFT"};
 
-bool compareAStarNode::operator()(const std::shared_ptr<AStarNode> a,
-                                  const std::shared_ptr<AStarNode> b) const {
+bool compareAStarNode::operator()(const AStarNode *a,
+                                  const AStarNode *b) const {
   // Sort order
   // 1. lowest fScore
   // 2. highest gScore
@@ -118,21 +119,20 @@ void disable_motions(std::shared_ptr<dynobench::Model_robot> &robot,
             << std::endl;
 }
 
-void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
-                                    const std::vector<Motion> &motions,
-                                    std::shared_ptr<AStarNode> solution,
-                                    const dynobench::Problem &problem,
-                                    dynobench::Trajectory &traj_out,
-                                    std::ofstream *out) {
-  std::vector<std::pair<std::shared_ptr<AStarNode>, size_t>> result;
+void from_solution_to_yaml_and_traj(
+    dynobench::Model_robot &robot, const std::vector<Motion> &motions,
+    AStarNode *solution, const std::vector<AStarNode::arrival> &arrivals,
+    const dynobench::Problem &problem, dynobench::Trajectory &traj_out,
+    std::ofstream *out) {
+  std::vector<std::pair<AStarNode *, size_t>> result;
   CHECK(solution, AT);
   // TODO: check what happens if a solution is a single state?
 
-  std::shared_ptr<AStarNode> n = solution;
+  AStarNode *n = solution;
   size_t arrival_idx = n->current_arrival_idx;
   while (n != nullptr) {
     result.push_back(std::make_pair(n, arrival_idx));
-    const auto &arrival = n->arrivals[arrival_idx];
+    const auto &arrival = arrivals.at(arrival_idx);
     n = arrival.came_from;
     arrival_idx = arrival.arrival_idx;
   }
@@ -163,8 +163,8 @@ void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
   // get states
   for (size_t i = 0; i < result.size() - 1; ++i) {
     const auto node_state = result[i].first->state_eig;
-    const auto &motion = motions.at(
-        result[i + 1].first->arrivals[result[i + 1].second].used_motion);
+    const auto &motion =
+        motions.at(arrivals.at(result[i + 1].second).used_motion);
     int take_until = result[i + 1].first->intermediate_state;
     if (take_until != -1) {
       if (out) {
@@ -254,8 +254,8 @@ void from_solution_to_yaml_and_traj(dynobench::Model_robot &robot,
   }
 
   for (size_t i = 0; i < result.size() - 1; ++i) {
-    const auto &motion = motions.at(
-        result[i + 1].first->arrivals[result[i + 1].second].used_motion);
+    const auto &motion =
+        motions.at(arrivals.at(result[i + 1].second).used_motion);
     int take_until = result[i + 1].first->intermediate_state;
     if (take_until != -1) {
       if (out) {
@@ -315,11 +315,16 @@ bool check_lazy_trajectory(
     LazyTraj &lazy_traj, dynobench::Model_robot &robot,
     const Eigen::Ref<const Eigen::VectorXd> &goal, Time_benchmark &time_bench,
     dynobench::TrajWrapper &tmp_traj,
-    const std::vector<Constraint> &constraints, const float best_node_gScore,
+    const Constraint_table &constraints, const float best_node_gScore,
     float delta, Eigen::Ref<Eigen::VectorXd> aux_last_state,
     std::function<bool(Eigen::Ref<Eigen::VectorXd>)> *check_state,
-    int *num_valid_states, bool forward) {
+    int *num_valid_states, bool forward, bool check_collisions,
+    bool *collision_free, bool const_motion) {
 
+  // set to true when the bounds and collision checks pass
+  if (collision_free) {
+    *collision_free = false;
+  }
   time_bench.time_alloc_primitive += 0; // no memory allocation :)
   // preliminary check only on bounds of last state
   if (robot.transform_primitive_last_state_available) {
@@ -372,9 +377,12 @@ bool check_lazy_trajectory(
 
   time_bench.check_bounds += watch_check_motion.elapsed_ms();
 
-  bool motion_valid;
+  bool motion_valid = true;
   auto &motion = lazy_traj.motion;
   time_bench.time_collisions += timed_fun_void([&] {
+    if (!check_collisions) {
+      return; // known to be collision free
+    }
     if (robot.invariance_reuse_col_shape) {
       Eigen::VectorXd offset = *lazy_traj.offset;
       assert(offset.size() == 2 || offset.size() == 3);
@@ -387,6 +395,11 @@ bool check_lazy_trajectory(
       assert(motion);
       assert(motion->collision_manager);
       assert(robot.env.get());
+      if (const_motion) {
+        motion_valid = !collide_shifted(motion->collision_objects, __offset,
+                                        robot.env.get());
+        return;
+      }
       std::vector<fcl::CollisionObject<double> *> objs;
       motion->collision_manager->getObjects(objs);
       motion->collision_manager->shift(__offset);
@@ -399,7 +412,12 @@ bool check_lazy_trajectory(
       motion_valid = dynobench::is_motion_collision_free(tmp_traj, robot);
     }
   });
-  time_bench.num_col_motions++;
+  if (check_collisions) {
+    time_bench.num_col_motions++;
+  }
+  if (collision_free) {
+    *collision_free = motion_valid;
+  }
   // check with constraints
   // std::cout << "Printing the tmp traj: " << std::endl;
   // for (auto tr : tmp_traj.get_states()){
@@ -413,34 +431,12 @@ bool check_lazy_trajectory(
   } else {
     reachesGoal = robot.distance(tmp_traj.get_state(0), goal) <= delta;
   }
-  for (const auto &constraint : constraints) {
-    // a constraint violation can only occur between t in [current->gScore,
-    // tentative_gScore]
-    float time_offset = constraint.time - best_node_gScore;
-    int time_index = std::lround(time_offset / robot.ref_dt);
-    Eigen::VectorXd state_to_check;
-    if (reachesGoal && time_index >= (int)tmp_traj.get_size() - 1) {
-      state_to_check = tmp_traj.get_state(tmp_traj.get_size() - 1);
-    }
-    if (time_index >= 0 && time_index < (int)tmp_traj.get_size() - 1) {
-      state_to_check = tmp_traj.get_state(time_index);
-    }
-
-    if (state_to_check.size() > 0) {
-      bool violation =
-          robot.distance(state_to_check, constraint.constrained_state) <= delta;
-      if (violation) {
-        motion_valid = false;
-        // std::cout << "VIOLATION inside lazy traj check" << time_index << " "
-        // << tmp_traj.get_size() << std::endl; std::cout << "State to check: "
-        // << state_to_check.format(dynobench::FMT) << std::endl; std::cout <<
-        // "Constraint state: " <<
-        // constraint.constrained_state.format(dynobench::FMT) << std::endl;
-        // throw std::runtime_error("Internal error: constraint violation in
-        // check lazy trajectory!");
-        break;
-      }
-    }
+  // a constraint violation can only occur between t in [current->gScore,
+  // tentative_gScore]
+  if (motion_valid &&
+      constraints.violated_trajectory(tmp_traj, best_node_gScore,
+                                      reachesGoal)) {
+    motion_valid = false;
   }
   // std::cout << "Motion validity: " << motion_valid << std::endl;
   return motion_valid;
@@ -474,6 +470,34 @@ void check_goal(dynobench::Model_robot &robot, Eigen::Ref<Eigen::VectorXd> x,
   }
 };
 
+const bool *Tdbastar_cache::find(const Eigen::Ref<const Eigen::VectorXd> &x,
+                                  size_t motion_idx) const {
+  Fnv_hash h;
+  h.add(x);
+  auto it = states.find(h.value);
+  if (it == states.end() || it->second.state != x) {
+    return nullptr;
+  }
+  auto it_m = it->second.collision_free.find(motion_idx);
+  return it_m == it->second.collision_free.end() ? nullptr : &it_m->second;
+}
+
+void Tdbastar_cache::add(const Eigen::Ref<const Eigen::VectorXd> &x,
+                         size_t motion_idx, bool collision_free) {
+  Fnv_hash h;
+  h.add(x);
+  auto it = states.find(h.value);
+  if (it == states.end()) {
+    if (states.size() >= max_states) {
+      return;
+    }
+    it = states.emplace(h.value, Entry{x, {}}).first;
+  } else if (it->second.state != x) {
+    return; // hash collision: the first state keeps the entry
+  }
+  it->second.collision_free[motion_idx] = collision_free;
+}
+
 // for standalone_tdbastar
 void export_constraints(const std::vector<Constraint> &constrained_states,
                         std::string robot_type, size_t robot_id,
@@ -505,13 +529,58 @@ void export_node_expansion(std::vector<dynobench::Trajectory> &expanded_trajs,
   }
 };
 
+Expanded_trajs_recorder::Expanded_trajs_recorder(
+    const Options_tdbastar &options)
+    : mode(static_cast<Record_expanded>(options.record_expanded_trajs)),
+      max_size(options.record_expanded_size),
+      every(options.record_expanded_every) {
+  CHECK(options.record_expanded_trajs >= 0 &&
+            options.record_expanded_trajs <= 3,
+        "unknown record_expanded_trajs " +
+            std::to_string(options.record_expanded_trajs));
+  CHECK(mode != Record_expanded::ring || max_size > 0, AT);
+  CHECK(mode != Record_expanded::sample || every > 0, AT);
+}
+
+void Expanded_trajs_recorder::offer(dynobench::TrajWrapper &traj,
+                                    double cost) {
+  size_t i = num_offered++;
+  switch (mode) {
+  case Record_expanded::none:
+    return;
+  case Record_expanded::all:
+    break;
+  case Record_expanded::ring:
+    if (trajs.size() == max_size) {
+      trajs[next] = dynobench::trajWrapper_2_Trajectory(traj);
+      trajs[next].cost = cost;
+      next = (next + 1) % max_size;
+      return;
+    }
+    break;
+  case Record_expanded::sample:
+    if (i % every) {
+      return;
+    }
+    break;
+  }
+  trajs.push_back(dynobench::trajWrapper_2_Trajectory(traj));
+  trajs.back().cost = cost;
+}
+
+void Expanded_trajs_recorder::get(
+    std::vector<dynobench::Trajectory> &out) const {
+  out.insert(out.end(), trajs.begin() + next, trajs.end());
+  out.insert(out.end(), trajs.begin(), trajs.begin() + next);
+}
+
 void tdbastar(
     dynobench::Problem &problem, Options_tdbastar options_tdbastar,
     Trajectory &traj_out, const std::vector<Constraint> &constraints,
     Out_info_tdb &out_info_tdb, size_t &robot_id, bool reverse_search,
     std::vector<dynobench::Trajectory> &expanded_trajs,
-    ompl::NearestNeighbors<std::shared_ptr<AStarNode>> *heuristic_nn,
-    ompl::NearestNeighbors<std::shared_ptr<AStarNode>> **heuristic_result) {
+    ompl::NearestNeighbors<AStarNode *> *heuristic_nn,
+    Search_tree *heuristic_result, Tdbastar_cache *cache) {
 
   // #ifdef DBG_PRINTS
   std::cout << "Running tdbA* for robot " << robot_id << std::endl;
@@ -527,13 +596,27 @@ void tdbastar(
       problem.p_lb, problem.p_ub);
   load_env(*robot, problem);
   const int nx = robot->nx;
+  // indexed by time step, for the checks of the primitives and the goal
+  const Constraint_table constraint_table(constraints, *robot,
+                                          options_tdbastar.delta);
+  const Reservation_table *reservations = options_tdbastar.reservations_ptr;
+  CHECK(!reservations || !reverse_search, AT);
+  Expanded_trajs_recorder expanded_recorder(options_tdbastar);
   // clean
   traj_out.states.clear();
   traj_out.actions.clear();
   traj_out.cost = 0;
-  CHECK(options_tdbastar.motions_ptr,
+  // shared primitives and trees, or the motions of this search
+  const Primitive_library *library = options_tdbastar.primitives_ptr;
+  CHECK(options_tdbastar.motions_ptr || library,
         "motions should be loaded before calling dbastar");
-  std::vector<Motion> &motions = *options_tdbastar.motions_ptr;
+  if (library) {
+    CHECK(library->compatible(problem.robotTypes[robot_id], options_tdbastar),
+          "primitive library " + library->robot_type +
+              " does not match the options");
+  }
+  const std::vector<Motion> &motions =
+      library ? library->motions : *options_tdbastar.motions_ptr;
   // for the reverse search debug
   // std::ofstream out2("../dynoplan/expanded_trajs.yaml");
   // out2 << "trajs:" << std::endl;
@@ -552,19 +635,19 @@ void tdbastar(
   Time_benchmark time_bench;
   // build kd-tree for motion primitives
   ompl::NearestNeighbors<Motion *> *T_m = nullptr;
-  ompl::NearestNeighbors<std::shared_ptr<AStarNode>> *T_n = nullptr;
+  std::unique_ptr<ompl::NearestNeighbors<AStarNode *>> T_n;
 
   if (options_tdbastar.use_nigh_nn) {
-    T_n = nigh_factory2<std::shared_ptr<AStarNode>>(
-        problem.robotTypes[robot_id], robot);
+    T_n.reset(nigh_factory2<AStarNode *>(problem.robotTypes[robot_id], robot));
   } else {
-    NOT_IMPLEMENTED;
+    // the novelty radius is fixed during the search
+    T_n.reset(grid_factory2<AStarNode *>(
+        problem.robotTypes[robot_id], robot,
+        (1. - options_tdbastar.alpha) * options_tdbastar.delta));
   }
-  // // for the initial heuristics
-  if (heuristic_result) {
-    *heuristic_result = T_n;
-  }
-  if (options_tdbastar.use_nigh_nn) {
+  if (library) {
+    T_m = library->nn(reverse_search);
+  } else if (options_tdbastar.use_nigh_nn) {
     // if (reverse_search){
     //    T_m = nigh_factory2<Motion *>(problem.robotTypes[robot_id], robot,
     //    [](Motion& m) { return m->getLastStateEig(); });
@@ -575,15 +658,22 @@ void tdbastar(
     T_m = nigh_factory_t<Motion *>(problem.robotTypes[robot_id], robot,
                                    reverse_search);
   } else {
-    NOT_IMPLEMENTED;
+    T_m = grid_factory2<Motion *>(
+        problem.robotTypes[robot_id], robot,
+        options_tdbastar.alpha * options_tdbastar.delta,
+        [reverse_search](Motion *m) {
+          return reverse_search ? m->getLastStateEig() : m->getStateEig();
+        });
   }
 
-  time_bench.time_nearestMotion += timed_fun_void([&] {
-    for (size_t i = 0;
-         i < std::min(motions.size(), options_tdbastar.max_motions); ++i) {
-      T_m->add(&motions.at(i));
-    }
-  });
+  if (!library) {
+    time_bench.time_nearestMotion += timed_fun_void([&] {
+      for (size_t i = 0;
+           i < std::min(motions.size(), options_tdbastar.max_motions); ++i) {
+        T_m->add(&options_tdbastar.motions_ptr->at(i));
+      }
+    });
+  }
 
   Expander expander(robot.get(), T_m,
                     options_tdbastar.alpha * options_tdbastar.delta);
@@ -601,17 +691,28 @@ void tdbastar(
 
   if (reverse_search) {
     h_fun = std::make_shared<Heu_blind>();
+  } else if (options_tdbastar.heuristic == 2) {
+    time_bench.build_heuristic += timed_fun_void([&] {
+      h_fun = std::make_shared<Heu_grid>(
+          robot, problem.goals[robot_id], problem.p_lb, problem.p_ub,
+          options_tdbastar.heu_grid_resolution,
+          make_worker_robots(problem, problem.robotTypes[robot_id], robot,
+                             options_tdbastar.num_threads_heu));
+    });
   } else {
-    h_fun = std::make_shared<
-        Heu_roadmap_bwd<std::shared_ptr<AStarNode>, AStarNode>>(
+    h_fun = std::make_shared<Heu_roadmap_bwd<AStarNode>>(
         robot, heuristic_nn, problem.goals[robot_id]);
+    if (heuristic_nn && options_tdbastar.heu_cache_resolution > 0) {
+      h_fun = std::make_shared<Heu_cached>(
+          h_fun, options_tdbastar.heu_cache_resolution,
+          options_tdbastar.heu_cache_size);
+    }
   }
-  // all_nodes manages the memory.
-  // c-pointer don't have onwership.
-  std::vector<std::shared_ptr<AStarNode>> all_nodes;
-  all_nodes.push_back(std::make_shared<AStarNode>());
+  // the pool manages the memory of the nodes and the arrivals.
+  // raw pointers to the nodes do not have ownership.
+  auto pool = std::make_unique<AStarNode_pool>();
 
-  auto start_node = all_nodes.at(0);
+  AStarNode *start_node = pool->allocate();
   start_node->gScore = 0;
   start_node->state_eig = problem.starts[robot_id];
   start_node->hScore =
@@ -621,17 +722,17 @@ void tdbastar(
   start_node->reaches_goal =
       (robot->distance(problem.starts[robot_id], problem.goals[robot_id]) <=
        options_tdbastar.delta);
-  start_node->arrivals.push_back({.gScore = 0,
-                                  .came_from = nullptr,
-                                  .used_motion = (size_t)-1,
-                                  .arrival_idx = (size_t)-1});
-  start_node->current_arrival_idx = 0;
+  start_node->current_arrival_idx =
+      pool->add_arrival({.gScore = 0,
+                         .came_from = nullptr,
+                         .used_motion = (size_t)-1,
+                         .arrival_idx = (size_t)-1});
 
   DYNO_CHECK_GEQ(start_node->hScore, 0, "hScore should be positive");
   DYNO_CHECK_LEQ(start_node->hScore, 1e5, "hScore should be bounded");
 
-  auto goal_node = std::make_shared<AStarNode>();
-  goal_node->state_eig = problem.goals[robot_id];
+  AStarNode goal_node;
+  goal_node.state_eig = problem.goals[robot_id];
   open_t open;
   start_node->handle = open.push(start_node);
 
@@ -639,8 +740,8 @@ void tdbastar(
   fakeMotion.idx = -1;
   fakeMotion.traj.states.push_back(Eigen::VectorXd::Zero(robot->nx));
 
-  auto tmp_node = std::make_shared<AStarNode>();
-  tmp_node->state_eig = Eigen::VectorXd::Zero(robot->nx);
+  AStarNode tmp_node;
+  tmp_node.state_eig = Eigen::VectorXd::Zero(robot->nx);
 
   double best_distance_to_goal =
       robot->distance(start_node->state_eig, problem.goals[robot_id]);
@@ -649,12 +750,11 @@ void tdbastar(
 
   double cost_bound = options_tdbastar.maxCost;
 
+  // only the generators of this search: cbs and prioritized run tdbastar
+  // in parallel, the global rand() is seeded by the single-threaded callers
   if (options_tdbastar.fix_seed) {
     expander.seed(0);
     g = std::mt19937{0};
-    srand(0);
-  } else {
-    srand(time(0));
   }
 
   time_bench.time_nearestNode_add +=
@@ -694,8 +794,8 @@ void tdbastar(
     return false;
   };
 
-  std::shared_ptr<AStarNode> best_node;
-  std::vector<std::shared_ptr<AStarNode>> neighbors_n;
+  AStarNode *best_node = nullptr;
+  std::vector<AStarNode *> neighbors_n;
 
   const bool debug = false;
 
@@ -752,18 +852,12 @@ void tdbastar(
     bool is_at_goal_no_constraints = false;
     if (distance_to_goal <
         options_tdbastar.delta_factor_goal * options_tdbastar.delta) {
-      is_at_goal_no_constraints = true;
-      for (const auto &constraint : constraints) {
-        if (constraint.time >= best_node->gScore - 1e-6) {
-          bool violation = robot->distance(best_node->state_eig,
-                                           constraint.constrained_state) <=
-                           options_tdbastar.delta;
-          if (violation) {
-            is_at_goal_no_constraints = false;
-            break;
-          }
-        }
-      }
+      is_at_goal_no_constraints =
+          !constraint_table.violated_after(best_node->state_eig,
+                                           best_node->gScore - 1e-6) &&
+          !(reservations &&
+            reservations->violated_after(robot_id, best_node->state_eig,
+                                         best_node->gScore - 1e-6));
     }
     if (is_at_goal_no_constraints) {
       std::cout << "FOUND SOLUTION" << std::endl;
@@ -786,10 +880,29 @@ void tdbastar(
       int num_valid_states = -1;
       traj_wrapper.set_size(lazy_traj.motion->traj.states.size());
 
+      const bool *cached = nullptr;
+      if (cache) {
+        cached = cache->find(best_node->state_eig, lazy_traj.motion->idx);
+        if (cached) {
+          cache->hits++;
+        } else {
+          cache->misses++;
+        }
+        if (cached && !*cached) {
+          continue;
+        }
+      }
+      bool collision_free;
       bool motion_valid = check_lazy_trajectory(
           lazy_traj, *robot, problem.goals[robot_id], time_bench, traj_wrapper,
-          constraints, best_node->gScore, options_tdbastar.delta,
-          aux_last_state, &ff, &num_valid_states, !reverse_search);
+          constraint_table, best_node->gScore, options_tdbastar.delta,
+          aux_last_state, &ff, &num_valid_states, !reverse_search,
+          /*check_collisions*/ !cached, &collision_free,
+          /*const_motion*/ library != nullptr);
+      if (cache && !cached) {
+        cache->add(best_node->state_eig, lazy_traj.motion->idx,
+                   collision_free);
+      }
       if (!motion_valid) {
         continue;
       }
@@ -797,19 +910,24 @@ void tdbastar(
       // Additional CHECK: if a intermediate state is close to goal. It really
       // helps!
       int chosen_index = -1;
-      check_goal(*robot, tmp_node->state_eig, problem.goals[robot_id],
+      check_goal(*robot, tmp_node.state_eig, problem.goals[robot_id],
                  traj_wrapper,
                  options_tdbastar.delta_factor_goal * options_tdbastar.delta,
                  num_check_goal, chosen_index, !reverse_search);
 
       // for the Node, if it reaches after the motion being transferred
       bool reachesGoal =
-          robot->distance(tmp_node->state_eig, problem.goals[robot_id]) <=
+          robot->distance(tmp_node.state_eig, problem.goals[robot_id]) <=
           options_tdbastar.delta;
+      if (reservations &&
+          reservations->violated_trajectory(robot_id, traj_wrapper,
+                                            best_node->gScore, reachesGoal)) {
+        continue;
+      }
       // Tentative hScore, gScore
       double hScore;
       time_bench.time_hfun +=
-          timed_fun_void([&] { hScore = h_fun->h(tmp_node->state_eig); });
+          timed_fun_void([&] { hScore = h_fun->h(tmp_node.state_eig); });
       assert(hScore >= 0);
       double cost_motion = chosen_index != -1
                                ? chosen_index * robot->ref_dt
@@ -822,21 +940,18 @@ void tdbastar(
                           robot->lower_bound_time(best_node->state_eig,
                                                   traj_wrapper.get_state(0));
 
-      auto tmp_traj = dynobench::trajWrapper_2_Trajectory(traj_wrapper);
-      tmp_traj.cost = best_node->gScore;
-      expanded_trajs.push_back(tmp_traj);
+      expanded_recorder.offer(traj_wrapper, best_node->gScore);
       // CHECK if new State is NOVEL
       time_bench.time_nearestNode_search += timed_fun_void([&] {
-        T_n->nearestR(tmp_node,
+        T_n->nearestR(&tmp_node,
                       (1. - options_tdbastar.alpha) * options_tdbastar.delta,
                       neighbors_n);
       });
       if (!neighbors_n.size() || chosen_index != -1) {
         // STATE is NOVEL, we add the node
         num_expansion_best_node++;
-        all_nodes.push_back(std::make_shared<AStarNode>());
-        auto __node = all_nodes.back();
-        __node->state_eig = tmp_node->state_eig;
+        AStarNode *__node = pool->allocate();
+        __node->state_eig = tmp_node.state_eig;
         __node->gScore = gScore;
         __node->hScore = hScore;
         __node->fScore = gScore + hScore;
@@ -844,12 +959,11 @@ void tdbastar(
           __node->intermediate_state = chosen_index;
         __node->is_in_open = true;
         __node->reaches_goal = reachesGoal;
-        __node->arrivals.push_back(
+        __node->current_arrival_idx = pool->add_arrival(
             {.gScore = gScore,
              .came_from = best_node,
              .used_motion = lazy_traj.motion->idx,
              .arrival_idx = best_node->current_arrival_idx});
-        __node->current_arrival_idx = 0;
         time_bench.time_queue +=
             timed_fun_void([&] { __node->handle = open.push(__node); });
         time_bench.time_nearestNode_add +=
@@ -861,34 +975,27 @@ void tdbastar(
             // STATE is not novel, we udpate
             if (float tentative_g =
                     gScore + options_tdbastar.cost_delta_factor *
-                                 robot->lower_bound_time(tmp_node->state_eig,
+                                 robot->lower_bound_time(tmp_node.state_eig,
                                                          n->state_eig);
                 tentative_g < n->gScore) {
-              bool update_valid = true;
-              if (n->reaches_goal) {
-                for (const auto &constraint : constraints) {
-                  if (constraint.time >= best_node->gScore - 1e-6) {
-                    bool violation =
-                        robot->distance(n->state_eig,
-                                        constraint.constrained_state) <=
-                        options_tdbastar.delta;
-                    if (violation) {
-                      update_valid = false;
-                      break;
-                    }
-                  }
-                }
-              }
+              // same times as the goal check of the expansion (from the
+              // parent on, which includes the new arrival at n)
+              bool update_valid =
+                  !n->reaches_goal ||
+                  (!constraint_table.violated_after(n->state_eig,
+                                                    best_node->gScore - 1e-6) &&
+                   !(reservations &&
+                     reservations->violated_after(robot_id, n->state_eig,
+                                                  best_node->gScore - 1e-6)));
               if (update_valid) {
                 n->gScore = tentative_g;
                 n->fScore = tentative_g + n->hScore;
                 n->intermediate_state = -1; // reset intermediate state.
-                n->arrivals.push_back(
+                n->current_arrival_idx = pool->add_arrival(
                     {.gScore = tentative_g,
                      .came_from = best_node,
                      .used_motion = lazy_traj.motion->idx,
                      .arrival_idx = best_node->current_arrival_idx});
-                ++n->current_arrival_idx;
                 if (n->is_in_open) {
                   time_bench.time_queue +=
                       timed_fun_void([&] { open.increase(n->handle); });
@@ -909,6 +1016,24 @@ void tdbastar(
   } // out of while loop
 
   time_bench.time_search = watch.elapsed_ms();
+  if (auto h_cached = std::dynamic_pointer_cast<Heu_cached>(h_fun)) {
+    h_cached->collect(time_bench);
+  }
+
+  if (expanded_recorder.enabled()) {
+    size_t num_before = expanded_trajs.size();
+    expanded_recorder.get(expanded_trajs);
+    std::cout << "recorded " << expanded_trajs.size() - num_before << " of "
+              << expanded_recorder.num_offered << " expanded trajs"
+              << std::endl;
+    if (options_tdbastar.expanded_trajs_file.size()) {
+      dynobench::Trajectories trajs;
+      trajs.data.assign(expanded_trajs.begin() + num_before,
+                        expanded_trajs.end());
+      create_dir_if_necessary(options_tdbastar.expanded_trajs_file.c_str());
+      trajs.save_file_msgpack(options_tdbastar.expanded_trajs_file.c_str());
+    }
+  }
 
   time_bench.time_nearestMotion += expander.time_in_nn;
   time_bench.time_nearestNode =
@@ -933,16 +1058,16 @@ void tdbastar(
   std::cout << "time_bench:" << std::endl;
   time_bench.write(std::cout);
 
-  std::shared_ptr<AStarNode> solution;
+  AStarNode *solution = nullptr;
 
   if (status == Terminate_status::SOLVED) {
     solution = best_node;
     out_info_tdb.solved = true;
   } else {
     if (!reverse_search) {
-      auto nearest = T_n->nearest(goal_node);
+      auto nearest = T_n->nearest(&goal_node);
       std::cout << "Close distance T_n to goal: "
-                << robot->distance(goal_node->getStateEig(),
+                << robot->distance(goal_node.getStateEig(),
                                    nearest->getStateEig())
                 << std::endl;
       solution = nearest;
@@ -951,8 +1076,8 @@ void tdbastar(
   }
 
   if (status == Terminate_status::SOLVED) {
-    from_solution_to_yaml_and_traj(*robot, motions, solution, problem,
-                                   traj_out);
+    from_solution_to_yaml_and_traj(*robot, motions, solution, pool->arrivals,
+                                   problem, traj_out);
     traj_out.start = problem.starts[robot_id];
     traj_out.goal = problem.goals[robot_id];
     traj_out.check(robot, false);
@@ -1004,6 +1129,18 @@ void tdbastar(
       std::make_pair("delta", std::to_string(options_tdbastar.delta)));
   out_info_tdb.data.insert(
       std::make_pair("num_primitives", std::to_string(motions.size())));
+  if (cache) {
+    out_info_tdb.data.insert(
+        std::make_pair("cache_hits", std::to_string(cache->hits)));
+    out_info_tdb.data.insert(
+        std::make_pair("cache_states", std::to_string(cache->size())));
+  }
+
+  // for the initial heuristics
+  if (heuristic_result) {
+    heuristic_result->pool = std::move(pool);
+    heuristic_result->T_n = std::move(T_n);
+  }
 }
 
 } // namespace dynoplan
@@ -1,5 +1,6 @@
 
 #include "dynoplan/dbastar/dbastar.hpp"
+#include "dynoplan/dbastar/hlut.hpp"
 
 // #define BOOST_TEST_MODULE test module name
 // #define BOOST_TEST_DYN_LINK
@@ -31,6 +32,35 @@
 using namespace dynoplan;
 using namespace dynobench;
 
+// unicycle1_v0 in bugtrap_0 with 300 primitives, setup of the search tests
+struct Bugtrap_fixture {
+  Bugtrap_fixture()
+      : problem(DYNOBENCH_BASE "envs/unicycle1_v0/bugtrap_0.yaml") {
+    problem.models_base_path = DYNOBENCH_BASE "models/";
+
+    options_dbastar.max_motions = 300;
+    options_dbastar.fix_seed = true;
+    options_dbastar.motionsFile =
+        BASE_PATH_MOTIONS "unicycle1_v0__ispso__2023_04_03__14_56_57.bin.im."
+                          "bin.im.bin.small5000.msgpack";
+
+    robot = dynobench::robot_factory(
+        (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub);
+
+    load_motion_primitives_new(options_dbastar.motionsFile, *robot, motions,
+                               options_dbastar.max_motions,
+                               options_dbastar.cut_actions, false,
+                               options_dbastar.check_cols);
+    options_dbastar.motions_ptr = &motions;
+  }
+
+  Problem problem;
+  Options_dbastar options_dbastar;
+  std::shared_ptr<dynobench::Model_robot> robot;
+  std::vector<Motion> motions;
+};
+
 BOOST_AUTO_TEST_CASE(extra_time) {
 
   Problem problem(DYNOBENCH_BASE "envs/quad2d_v0/quad_bugtrap.yaml");
@@ -278,3 +308,704 @@ BOOST_AUTO_TEST_CASE(test_eval_multiple) {
 
   // continue here!!
 }
+
+BOOST_AUTO_TEST_CASE(test_node_pool) {
+
+  const size_t nx = 3;
+  const size_t num_nodes = 10000;
+  NodePool pool(nx, 128);
+
+  std::vector<SearchNode *> nodes;
+  for (size_t i = 0; i < num_nodes; i++) {
+    SearchNode *n = pool.allocate();
+    n->state_eig = Eigen::Vector3d(i, 2. * i, 3. * i);
+    n->gScore = i;
+    n->came_from = nodes.size() ? nodes.back() : nullptr;
+    nodes.push_back(n);
+  }
+
+  BOOST_TEST(pool.size() == num_nodes);
+  // pointers and states are stable
+  for (size_t i = 0; i < num_nodes; i++) {
+    BOOST_TEST(pool[i] == nodes[i]);
+    BOOST_TEST(nodes[i]->state_eig(2) == 3. * i);
+    BOOST_TEST(nodes[i]->gScore == i);
+  }
+
+  // reuse the memory
+  size_t bytes = pool.memory_bytes();
+  pool.clear();
+  BOOST_TEST(pool.size() == 0);
+  SearchNode *n = pool.allocate();
+  BOOST_TEST(n == nodes.front());
+  BOOST_TEST(n->came_from == nullptr);
+  BOOST_TEST(n->gScore == 0);
+  BOOST_TEST(pool.memory_bytes() == bytes);
+
+  pool.release();
+  BOOST_TEST(pool.memory_bytes() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_parallel_check, Bugtrap_fixture) {
+
+  options_dbastar.search_timelimit = 1e5; // in ms
+
+  // The parallel check should not change the search
+  std::vector<Out_info_db> infos;
+  for (size_t num_threads : {1, 4}) {
+    options_dbastar.num_threads_check = num_threads;
+    Trajectory traj_out;
+    Out_info_db out_info_db;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, out_info_db));
+    BOOST_TEST(out_info_db.solved);
+    infos.push_back(out_info_db);
+  }
+
+  BOOST_TEST(infos.at(0).cost == infos.at(1).cost);
+  BOOST_TEST(infos.at(0).data.at("expands") == infos.at(1).data.at("expands"));
+  // ... but it can check more primitives than necessary
+  BOOST_TEST(std::stoi(infos.at(0).data.at("num_col_motions")) <=
+             std::stoi(infos.at(1).data.at("num_col_motions")));
+}
+
+BOOST_AUTO_TEST_CASE(bench_dbastar_parallel, *boost::unit_test::disabled()) {
+
+  // Compare expands per second of dbastar and dbastar_parallel
+  Problem problem(DYNOBENCH_BASE "envs/quad2d_v0/quad_bugtrap.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+
+  Options_dbastar options_dbastar;
+  options_dbastar.delta = .55;
+  options_dbastar.limit_branching_factor = 20;
+  options_dbastar.max_motions = 350;
+  options_dbastar.search_timelimit = 30000;
+  options_dbastar.fix_seed = true;
+  options_dbastar.motionsFile =
+      BASE_PATH_MOTIONS "quad2d_v0_all_im.bin.sp.bin.ca.bin."
+                        "small5000.msgpack";
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+
+  std::vector<Motion> motions;
+  load_motion_primitives_new(
+      options_dbastar.motionsFile, *robot, motions, options_dbastar.max_motions,
+      options_dbastar.cut_actions, false, options_dbastar.check_cols);
+  options_dbastar.motions_ptr = &motions;
+
+  auto expands_per_second = [](const Out_info_db &info) {
+    return std::stod(info.data.at("expands")) / info.time_search * 1000.;
+  };
+
+  {
+    Trajectory traj_out;
+    Out_info_db out_info_db;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, out_info_db));
+    BOOST_TEST(out_info_db.solved);
+    std::cout << "dbastar: expands/s " << expands_per_second(out_info_db)
+              << " time_search " << out_info_db.time_search << " cost "
+              << out_info_db.cost << std::endl;
+  }
+
+  for (size_t num_threads : {1, 2, 4, 8}) {
+    options_dbastar.num_threads = num_threads;
+    Trajectory traj_out;
+    Out_info_db out_info_db;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar_parallel(problem, options_dbastar, traj_out, out_info_db));
+    BOOST_TEST(out_info_db.solved);
+    BOOST_TEST(traj_out.feasible);
+    std::cout << "dbastar_parallel: threads " << num_threads << " expands/s "
+              << expands_per_second(out_info_db) << " time_search "
+              << out_info_db.time_search << " cost " << out_info_db.cost
+              << std::endl;
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_dbastar_parallel_grid, Bugtrap_fixture) {
+
+  // dbastar_parallel with the nigh trees and with the hash grids
+  options_dbastar.num_threads = 2;
+  for (bool use_nigh_nn : {true, false}) {
+    options_dbastar.use_nigh_nn = use_nigh_nn;
+    Trajectory traj_out;
+    Out_info_db info;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar_parallel(problem, options_dbastar, traj_out, info));
+    BOOST_TEST(info.solved);
+    BOOST_TEST(traj_out.feasible);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_planner_queries, Bugtrap_fixture) {
+
+  DbAStarPlanner planner(problem, options_dbastar);
+
+  // The same query twice gives the same result
+  std::vector<Out_info_db> infos(2);
+  for (auto &info : infos) {
+    Trajectory traj_out;
+    BOOST_REQUIRE_NO_THROW(
+        planner.plan(problem.start, problem.goal, traj_out, info));
+    BOOST_TEST(info.solved);
+    BOOST_TEST(traj_out.feasible);
+  }
+  BOOST_TEST(infos.at(0).cost == infos.at(1).cost);
+  BOOST_TEST(infos.at(0).data.at("expands") == infos.at(1).data.at("expands"));
+
+  // Swap start and goal
+  {
+    Trajectory traj_out;
+    Out_info_db info;
+    BOOST_REQUIRE_NO_THROW(
+        planner.plan(problem.goal, problem.start, traj_out, info));
+    BOOST_TEST(info.solved);
+    BOOST_TEST(traj_out.feasible);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_output_sink, Bugtrap_fixture) {
+
+  // Default: no outputs
+  BOOST_TEST(!get_output_sink(options_dbastar.output_sink,
+                              options_dbastar.output_mode)
+                  .open("/tmp/dynoplan/dbastar_out.yaml"));
+
+  Memory_sink sink;
+  options_dbastar.output_sink = &sink;
+
+  Trajectory traj_out;
+  Out_info_db info;
+  BOOST_REQUIRE_NO_THROW(dbastar(problem, options_dbastar, traj_out, info));
+  BOOST_TEST(info.solved);
+
+  BOOST_TEST(sink.has("/tmp/dynoplan/dbastar_out.yaml"));
+  std::string out = sink.get("/tmp/dynoplan/dbastar_out.yaml");
+  BOOST_TEST(out.find("solved: 1") != std::string::npos);
+  BOOST_TEST(out.find("result:") != std::string::npos);
+  BOOST_TEST(sink.names().size() == 2); // dbastar_out and traj_db_<id>
+}
+
+BOOST_FIXTURE_TEST_CASE(test_anytime, Bugtrap_fixture) {
+  options_dbastar.anytime = true;
+  options_dbastar.anytime_weight = 3;
+  options_dbastar.search_timelimit = 20000;
+
+  std::vector<double> costs;
+  std::vector<double> bounds;
+  options_dbastar.anytime_callback = [&](const Trajectory &traj,
+                                         double bound) {
+    costs.push_back(traj.cost);
+    bounds.push_back(bound);
+  };
+
+  Trajectory traj_out;
+  Out_info_db info;
+  BOOST_REQUIRE_NO_THROW(dbastar(problem, options_dbastar, traj_out, info));
+  BOOST_TEST(info.solved);
+  BOOST_TEST(traj_out.feasible);
+
+  BOOST_REQUIRE(costs.size() >= 1);
+  BOOST_TEST(int(costs.size()) ==
+             std::stoi(info.data.at("anytime_solutions")));
+  for (size_t i = 0; i < bounds.size(); i++) {
+    BOOST_TEST(bounds.at(i) >= 1.);
+    BOOST_TEST(bounds.at(i) <= options_dbastar.anytime_weight);
+  }
+  BOOST_TEST(costs.back() == info.cost, boost::test_tools::tolerance(1e-6));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_lazy_edges, Bugtrap_fixture) {
+
+  std::vector<Out_info_db> infos(2);
+  for (size_t i = 0; i < infos.size(); i++) {
+    options_dbastar.lazy_edges = i == 1;
+    Trajectory traj_out;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, infos.at(i)));
+    BOOST_TEST(infos.at(i).solved);
+    BOOST_TEST(traj_out.feasible);
+  }
+
+  // Lazy search checks fewer motions for collisions
+  BOOST_TEST(std::stoi(infos.at(1).data.at("num_col_motions")) <
+             std::stoi(infos.at(0).data.at("num_col_motions")));
+}
+
+BOOST_AUTO_TEST_CASE(bench_open_list, *boost::unit_test::disabled()) {
+
+  // Throughput of push, increase and pop with 1e6 entries. All the open lists
+  // have to pop the nodes in the same order.
+  const size_t num_nodes = 1e6;
+  const size_t num_increase = 5e5;
+  const double max_f = 100;
+
+  std::vector<std::vector<uint32_t>> pop_orders;
+  for (auto type : {Open_list_type::boost_heap, Open_list_type::heap4,
+                    Open_list_type::heap8, Open_list_type::bucket}) {
+
+    std::unique_ptr<Open_list> open =
+        make_open_list(static_cast<int>(type), .1);
+    NodePool pool(1, 1 << 16);
+    std::mt19937 g(0);
+    std::uniform_real_distribution<float> rand_f(0, max_f);
+
+    double time_push = timed_fun_void([&] {
+      for (size_t i = 0; i < num_nodes; i++) {
+        SearchNode *n = pool.allocate();
+        n->used_motion = i; // id of the node
+        n->gScore = rand_f(g);
+        n->fScore = n->gScore + rand_f(g);
+        open->push(n);
+      }
+    });
+
+    double time_increase = timed_fun_void([&] {
+      for (size_t i = 0; i < num_increase; i++) {
+        SearchNode *n = pool[g() % num_nodes];
+        n->fScore *= .9;
+        open->increase(n);
+      }
+    });
+
+    std::vector<uint32_t> pop_order;
+    pop_order.reserve(num_nodes);
+    double time_pop = timed_fun_void([&] {
+      while (!open->empty()) {
+        pop_order.push_back(open->top()->used_motion);
+        open->pop();
+      }
+    });
+    BOOST_TEST(pop_order.size() == num_nodes);
+
+    std::cout << "open_list " << static_cast<int>(type) << " push (Mops/s) "
+              << num_nodes / time_push / 1e3 << " increase (Mops/s) "
+              << num_increase / time_increase / 1e3 << " pop (Mops/s) "
+              << num_nodes / time_pop / 1e3 << std::endl;
+
+    pop_orders.push_back(std::move(pop_order));
+  }
+
+  for (size_t i = 1; i < pop_orders.size(); i++) {
+    BOOST_TEST((pop_orders.at(i) == pop_orders.front()));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_nn_grid, Bugtrap_fixture) {
+
+  // The hash grid gives the same neighbours as nigh
+  const double radius = .3;
+  std::unique_ptr<ompl::NearestNeighbors<SearchNode *>> T_nigh(
+      nigh_factory2<SearchNode *>(problem.robotType, robot));
+  std::unique_ptr<ompl::NearestNeighbors<SearchNode *>> T_grid(
+      grid_factory2<SearchNode *>(problem.robotType, robot, radius));
+
+  const size_t num_nodes = 20000;
+  NodePool pool(robot->nx, 1024);
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(0, 1);
+  auto sample = [&](SearchNode *n) {
+    n->state_eig = Eigen::Vector3d(5 * dist(gen), 5 * dist(gen),
+                                   M_PI * (2 * dist(gen) - 1));
+  };
+  for (size_t i = 0; i < num_nodes; i++) {
+    SearchNode *n = pool.allocate();
+    sample(n);
+    T_nigh->add(n);
+    T_grid->add(n);
+  }
+
+  SearchNode *query = pool.allocate();
+  std::vector<SearchNode *> nbh_nigh, nbh_grid;
+  for (size_t i = 0; i < 1000; i++) {
+    sample(query);
+    // also radius larger than the one of the grid
+    double r = i % 2 ? radius : 3 * radius;
+    T_nigh->nearestR(query, r, nbh_nigh);
+    T_grid->nearestR(query, r, nbh_grid);
+    std::sort(nbh_nigh.begin(), nbh_nigh.end());
+    std::sort(nbh_grid.begin(), nbh_grid.end());
+    BOOST_TEST(nbh_nigh == nbh_grid);
+  }
+  BOOST_TEST(T_nigh->nearest(query) == T_grid->nearest(query));
+
+  // The search is the same
+  std::vector<Out_info_db> infos(2);
+  for (size_t i = 0; i < infos.size(); i++) {
+    options_dbastar.use_nigh_nn = i == 0;
+    Trajectory traj_out;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, infos.at(i)));
+    BOOST_TEST(infos.at(i).solved);
+    std::cout << "use_nigh_nn " << !i << " time_search "
+              << infos.at(i).time_search << std::endl;
+  }
+  BOOST_TEST(infos.at(0).cost == infos.at(1).cost);
+  BOOST_TEST(infos.at(0).data.at("expands") == infos.at(1).data.at("expands"));
+}
+
+BOOST_FIXTURE_TEST_CASE(test_successor_table, Bugtrap_fixture) {
+
+  std::string cache_dir = "/tmp/dynoplan/test_successor_table";
+  std::filesystem::remove_all(cache_dir);
+
+  // 0: kd-tree, 1: table (computed), 2: table (from the cache)
+  std::vector<Out_info_db> infos(3);
+  for (size_t i = 0; i < infos.size(); i++) {
+    options_dbastar.successor_table = i > 0;
+    options_dbastar.successor_table_dir = cache_dir;
+    Trajectory traj_out;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, infos.at(i)));
+    BOOST_TEST(infos.at(i).solved);
+    std::cout << "successor_table " << i << " time_nearestMotion "
+              << infos.at(i).data.at("time_nearestMotion") << std::endl;
+    if (i == 1) {
+      BOOST_TEST(!std::filesystem::is_empty(cache_dir));
+    }
+  }
+
+  // Same search, but most of the expansions do not query T_m
+  for (size_t i = 1; i < infos.size(); i++) {
+    BOOST_TEST(infos.at(0).cost == infos.at(i).cost);
+    BOOST_TEST(infos.at(0).data.at("expands") ==
+               infos.at(i).data.at("expands"));
+    BOOST_TEST(std::stoi(infos.at(i).data.at("num_successor_table")) > 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bench_heu_map, *boost::unit_test::disabled()) {
+
+  // Time to build the ROADMAP heuristic with all pairs (sequential) and with
+  // candidates from nigh and a thread pool. The maps have to be equal.
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/bugtrap_0.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+  load_env(*robot, problem);
+
+  const size_t num_threads = 8;
+  std::vector<std::shared_ptr<dynobench::Model_robot>> worker_robots{robot};
+  for (size_t i = 1; i < num_threads; i++) {
+    worker_robots.push_back(dynobench::robot_factory(
+        (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub));
+    load_env(*worker_robots.back(), problem);
+  }
+
+  srand(0);
+  const double radius = .5;
+  const double resolution = .1;
+  for (size_t num_samples : {1000, 5000, 20000}) {
+    std::vector<Eigen::VectorXd> samples;
+    Eigen::VectorXd v(robot->nx);
+    while (samples.size() < num_samples) {
+      robot->sample_uniform(v);
+      if (robot->collision_check(v)) {
+        samples.push_back(v);
+      }
+    }
+
+    std::vector<Heuristic_node> heu_map_nigh;
+    auto time_nigh = timed_fun_void([&] {
+      build_heuristic_distance_new(samples, robot, heu_map_nigh, radius,
+                                   resolution, problem.robotType,
+                                   worker_robots);
+    });
+    std::cout << "samples " << num_samples << " nigh + " << num_threads
+              << " threads [ms] " << time_nigh << std::endl;
+
+    if (num_samples > 5000) {
+      continue; // all pairs is too slow
+    }
+
+    std::vector<Heuristic_node> heu_map;
+    auto time_all_pairs = timed_fun_void([&] {
+      build_heuristic_distance_new(samples, robot, heu_map, radius,
+                                   resolution);
+    });
+    std::cout << "samples " << num_samples << " all pairs [ms] "
+              << time_all_pairs << std::endl;
+
+    BOOST_TEST_REQUIRE(heu_map.size() == heu_map_nigh.size());
+    for (size_t i = 0; i < heu_map.size(); i++) {
+      BOOST_TEST(heu_map[i].d == heu_map_nigh[i].d);
+      BOOST_TEST(heu_map[i].p == heu_map_nigh[i].p);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_heu_map_candidates) {
+
+  // The roadmap with the candidates of nigh (robot_type given) is the one of
+  // all the pairs, also for a robot whose nigh metric is not robot->distance
+  for (auto env : {"envs/unicycle1_v0/bugtrap_0.yaml",
+                   "envs/quadrotor_v0/quad_one_obs.yaml"}) {
+    Problem problem(DYNOBENCH_BASE + std::string(env));
+    problem.models_base_path = DYNOBENCH_BASE "models/";
+
+    std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+        (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub);
+    load_env(*robot, problem);
+
+    srand(0);
+    std::vector<Eigen::VectorXd> samples;
+    Eigen::VectorXd v(robot->nx);
+    while (samples.size() < 500) {
+      robot->sample_uniform(v);
+      if (robot->collision_check(v)) {
+        samples.push_back(v);
+      }
+    }
+
+    std::vector<Heuristic_node> heu_map, heu_map_nigh;
+    build_heuristic_distance_new(samples, robot, heu_map, 1., .1);
+    build_heuristic_distance_new(samples, robot, heu_map_nigh, 1., .1,
+                                 problem.robotType);
+    BOOST_TEST_REQUIRE(heu_map.size() == heu_map_nigh.size());
+    for (size_t i = 0; i < heu_map.size(); i++) {
+      BOOST_TEST(heu_map[i].d == heu_map_nigh[i].d);
+      BOOST_TEST(heu_map[i].p == heu_map_nigh[i].p);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_heu_map_cache) {
+
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/bugtrap_0.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+  load_env(*robot, problem);
+
+  Options_dbastar options;
+  options.max_size_heu_map = 500;
+  options.num_sample_trials = 1000;
+  options.heu_map_cache_dir = "/tmp/dynoplan/test_heu_map_cache";
+  std::filesystem::remove_all(options.heu_map_cache_dir);
+
+  auto equal = [](const std::vector<Heuristic_node> &a,
+                  const std::vector<Heuristic_node> &b) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+      if (a[i].x != b[i].x || a[i].d != b[i].d || a[i].p != b[i].p) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // computed and written to the cache
+  std::vector<Heuristic_node> heu_map;
+  generate_heuristic_map_cached(problem, robot, options, heu_map);
+  BOOST_TEST(!std::filesystem::is_empty(options.heu_map_cache_dir));
+
+  // binary format (also with load_heu_map)
+  std::string file = "/tmp/dynoplan/test_heu_map.bin";
+  write_heu_map_bin(heu_map, file);
+  std::vector<Heuristic_node> heu_map_bin;
+  load_heu_map(file.c_str(), heu_map_bin);
+  BOOST_TEST(equal(heu_map, heu_map_bin));
+
+  // from the cache
+  std::vector<Heuristic_node> heu_map_cache;
+  auto time_cache = timed_fun_void([&] {
+    generate_heuristic_map_cached(problem, robot, options, heu_map_cache);
+  });
+  std::cout << "time loading the cached heu map [ms] " << time_cache
+            << std::endl;
+  BOOST_TEST(equal(heu_map, heu_map_cache));
+
+  // a truncated file is rejected
+  std::filesystem::resize_file(file, std::filesystem::file_size(file) - 4);
+  BOOST_TEST(!load_heu_map_bin(file, heu_map_bin));
+
+  // other start -> other map (the start is a node of the map)
+  const uint64_t hash = heu_map_hash(problem, options);
+  BOOST_TEST(hash != 0);
+  Problem problem_other = problem;
+  problem_other.start(0) += .1;
+  BOOST_TEST(heu_map_hash(problem_other, options) != hash);
+
+  // other options -> other map, the cached one is not loaded
+  options.heu_connection_radius *= 2;
+  BOOST_TEST(heu_map_hash(problem, options) != hash);
+  for (auto &entry :
+       std::filesystem::directory_iterator(options.heu_map_cache_dir)) {
+    std::vector<Heuristic_node> heu_map_other;
+    BOOST_TEST(!load_heu_map_bin(entry.path(), heu_map_other,
+                                 heu_map_hash(problem, options)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_heu_grid) {
+
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/bugtrap_0.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+  load_env(*robot, problem);
+
+  Heu_grid heu_grid(robot, problem.goal, problem.p_lb, problem.p_ub, .1);
+  Heu_euclidean heu_euclidean(robot, problem.goal);
+
+  BOOST_TEST(heu_grid.h(problem.goal) < .5);
+
+  // the start is inside the trap: the grid knows that the robot has to go
+  // around the obstacles
+  double h_grid = heu_grid.h(problem.start);
+  double h_euclidean = heu_euclidean.h(problem.start);
+  std::cout << "h start: grid " << h_grid << " euclidean " << h_euclidean
+            << std::endl;
+  BOOST_TEST(h_grid > h_euclidean);
+
+  Options_dbastar options_dbastar;
+  options_dbastar.max_motions = 100;
+  options_dbastar.heuristic = 2;
+  options_dbastar.motionsFile =
+      BASE_PATH_MOTIONS "unicycle1_v0__ispso__2023_04_03__14_56_57.bin.im.bin."
+                        "im.bin.small5000.msgpack";
+
+  Trajectory traj_out;
+  Out_info_db out_info_db;
+  BOOST_REQUIRE_NO_THROW(
+      dbastar(problem, options_dbastar, traj_out, out_info_db));
+  BOOST_TEST(out_info_db.solved);
+  BOOST_TEST(out_info_db.cost < 100.);
+}
+
+BOOST_AUTO_TEST_CASE(test_hlut) {
+
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/bugtrap_0.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str());
+
+  Options_dbastar options_dbastar;
+  options_dbastar.max_motions = 100;
+  options_dbastar.motionsFile =
+      BASE_PATH_MOTIONS "unicycle1_v0__ispso__2023_04_03__14_56_57.bin.im.bin."
+                        "im.bin.small5000.msgpack";
+
+  std::vector<Motion> motions;
+  load_motion_primitives_new(options_dbastar.motionsFile, *robot, motions,
+                             options_dbastar.max_motions, false, false,
+                             options_dbastar.check_cols);
+
+  Hlut hlut;
+  hlut.max_cost = 3;
+  build_hlut(hlut, robot, problem.robotType, motions,
+             options_dbastar.motionsFile, false, options_dbastar.max_motions,
+             options_dbastar.alpha * options_dbastar.delta, 1e4);
+  BOOST_TEST(hlut.classes.size());
+  BOOST_TEST(hlut.cost.size());
+
+  std::string file = "/tmp/dynoplan/test_hlut.bin";
+  hlut.write(file);
+  Hlut hlut_file;
+  BOOST_TEST(hlut_file.read(file));
+  BOOST_TEST(hlut_file.hash == hlut.hash);
+  BOOST_TEST((hlut_file.cost == hlut.cost));
+  BOOST_TEST((hlut_file.classes == hlut.classes));
+
+  // from the start of a primitive to its last state: at most the cost of
+  // the primitive, and never below the lower bound
+  auto hlut_ptr = std::make_shared<const Hlut>(hlut);
+  size_t tighter = 0;
+  for (auto &m : motions) {
+    Eigen::VectorXd x0 = m.traj.states.front();
+    Eigen::VectorXd x1 = m.traj.states.back();
+    Heu_hlut heu_hlut(robot, x1, hlut_ptr);
+    double h = heu_hlut.h(x0);
+    BOOST_TEST(h >= robot->lower_bound_time(x0, x1));
+    BOOST_TEST(hlut.lookup(x0, x1) <= m.cost + 1e-6);
+    if (h > robot->lower_bound_time(x0, x1) + 1e-6) {
+      tighter++;
+    }
+  }
+  std::cout << "hlut tighter than lower_bound_time: " << tighter << "/"
+            << motions.size() << std::endl;
+
+  // search with the hlut, with the same motions and with the motions of
+  // another load (other random noise in the states, as main_primitives)
+  srand(1);
+  std::vector<Motion> motions_search;
+  load_motion_primitives_new(options_dbastar.motionsFile, *robot,
+                             motions_search, options_dbastar.max_motions,
+                             false, false, options_dbastar.check_cols);
+  options_dbastar.heuristic = 3;
+  options_dbastar.hlut_file = file;
+  for (auto motions_ptr : {&motions, &motions_search}) {
+    options_dbastar.motions_ptr = motions_ptr;
+    Trajectory traj_out;
+    Out_info_db out_info_db;
+    BOOST_REQUIRE_NO_THROW(
+        dbastar(problem, options_dbastar, traj_out, out_info_db));
+    BOOST_TEST(out_info_db.solved);
+  }
+
+  // the table is rejected with other primitives or another expansion radius
+  Trajectory traj_out;
+  Out_info_db out_info_db;
+  Options_dbastar options_other = options_dbastar;
+  options_other.max_motions = 50;
+  BOOST_CHECK_THROW(dbastar(problem, options_other, traj_out, out_info_db),
+                    std::exception);
+  options_other = options_dbastar;
+  options_other.cut_actions = true;
+  BOOST_CHECK_THROW(dbastar(problem, options_other, traj_out, out_info_db),
+                    std::exception);
+  options_other = options_dbastar;
+  options_other.delta *= 2;
+  BOOST_CHECK_THROW(dbastar(problem, options_other, traj_out, out_info_db),
+                    std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_heu_cached) {
+
+  struct Heu_count : Heu_fun {
+    size_t calls = 0;
+    virtual double h(const Eigen::VectorXd &x) override {
+      calls++;
+      return x.norm();
+    }
+  };
+
+  auto heu = std::make_shared<Heu_count>();
+  Heu_cached heu_cached(heu, .1, 4);
+
+  Eigen::VectorXd x(3);
+  x << 1, 2, 3;
+  BOOST_TEST(heu_cached.h(x) == x.norm());
+  BOOST_TEST(heu_cached.h(x) == x.norm());
+  // same cell: the value of the first state
+  Eigen::VectorXd y = x + Eigen::VectorXd::Constant(3, .01);
+  BOOST_TEST(heu_cached.h(y) == x.norm());
+  BOOST_TEST(heu->calls == 1);
+
+  // more cells than entries: the table is bounded, the values are correct
+  for (size_t i = 0; i < 100; i++) {
+    Eigen::VectorXd z = Eigen::VectorXd::Random(3);
+    BOOST_TEST(std::abs(heu_cached.h(z) - z.norm()) < .1 * std::sqrt(3.));
+  }
+
+  Time_benchmark time_bench;
+  heu_cached.collect(time_bench);
+  BOOST_TEST(time_bench.num_heu_cache_hits >= 2);
+  BOOST_TEST(time_bench.num_heu_cache_hits + time_bench.num_heu_cache_misses ==
+             103);
+  BOOST_TEST(heu_cached.hits == 0);
+}
@@ -1,11 +1,17 @@
 
 #include "Eigen/Core"
 #include "dynobench/motions.hpp"
+#include "dynoplan/ompl/motion_registry.hpp"
+#include "dynoplan/tdbastar/cbs.hpp"
+#include "dynoplan/tdbastar/primitive_library.hpp"
+#include "dynoplan/tdbastar/prioritized.hpp"
 #include "dynoplan/tdbastar/tdbastar.hpp"
 #include <Eigen/Dense>
 #include <boost/program_options.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include <regex>
@@ -16,6 +22,37 @@
 
 using namespace dynoplan;
 using namespace dynobench;
+
+// first robot of swap1_unicycle with 100 primitives, setup of the search tests
+struct Swap_fixture {
+  Swap_fixture()
+      : problem(DYNOBENCH_BASE "envs/unicycle1_v0/swap/swap1_unicycle.yaml") {
+    problem.models_base_path = DYNOBENCH_BASE "models/";
+
+    o_uni1.max_motions = 100;
+    o_uni1.delta = .5;
+    o_uni1.fix_seed = true;
+    o_uni1.search_timelimit = 40 * 10e3;
+    o_uni1.motionsFile =
+        BASE_PATH_MOTIONS "unicycle1_v0__ispso__2023_04_03__14_56_57.bin.im."
+                          "bin.im.bin.small5000.msgpack";
+
+    robot = dynobench::robot_factory(
+        (problem.models_base_path + problem.robotTypes[0] + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub);
+
+    load_motion_primitives_new(o_uni1.motionsFile, *robot, motions,
+                               o_uni1.max_motions, o_uni1.cut_actions, false,
+                               o_uni1.check_cols);
+    o_uni1.motions_ptr = &motions;
+  }
+
+  Problem problem;
+  Options_tdbastar o_uni1;
+  std::shared_ptr<dynobench::Model_robot> robot;
+  std::vector<Motion> motions;
+};
+
 // Run from dynoplan build
 BOOST_AUTO_TEST_CASE(test_eval_multiple) {
 
@@ -110,8 +147,7 @@ BOOST_AUTO_TEST_CASE(test_eval_reverse) {
   // save expanded nodes
   // std::string output_folder = "../reverse_expansion_vis";
   // create_folder_if_necessary(output_folder);
-  std::vector<ompl::NearestNeighbors<std::shared_ptr<AStarNode>> *>
-      all_heuristics(robot_num, nullptr);
+  std::vector<Search_tree> all_heuristics(robot_num);
   Trajectory traj_out;
   Out_info_tdb info_out;
   std::vector<Motion> motions;
@@ -135,8 +171,8 @@ BOOST_AUTO_TEST_CASE(test_eval_reverse) {
   // export_node_expansion(expanded_trajs_tmp, &out2);
   BOOST_REQUIRE_NO_THROW(tdbastar(problem, o_uni1, traj_out, /*constraints*/ {},
                                   info_out, robot_id, /*reverse_search*/ false,
-                                  expanded_trajs_tmp, all_heuristics[robot_id],
-                                  nullptr));
+                                  expanded_trajs_tmp,
+                                  all_heuristics[robot_id].T_n.get(), nullptr));
   BOOST_TEST(info_out.solved, msg);
 }
 
@@ -229,3 +265,597 @@ BOOST_AUTO_TEST_CASE(test_eval_multiple_with_constraints) {
     BOOST_TEST(info_out.solved, msg);
   }
 }
+
+BOOST_FIXTURE_TEST_CASE(bench_heu_roadmap_bwd, Swap_fixture,
+                        *boost::unit_test::disabled()) {
+
+  // h() of Heu_roadmap_bwd with the tree of a reverse search, against a
+  // query with a new fake node per call (previous implementation).
+
+  Search_tree tree;
+  std::vector<dynobench::Trajectory> expanded_trajs_tmp;
+  Trajectory traj_out;
+  Out_info_tdb info_out;
+  BOOST_REQUIRE_NO_THROW(tdbastar(problem, o_uni1, traj_out, /*constraints*/ {},
+                                  info_out, /*robot_id*/ 0,
+                                  /*reverse_search*/ true, expanded_trajs_tmp,
+                                  nullptr, &tree));
+  BOOST_REQUIRE(tree.T_n);
+  auto heuristic_nn = tree.T_n.get();
+
+  Heu_roadmap_bwd<AStarNode> heu(robot, heuristic_nn, problem.goals[0]);
+  BOOST_TEST(heu.state_query);
+
+  const size_t num_queries = 1e5;
+  std::vector<Eigen::VectorXd> xs(num_queries, Eigen::VectorXd(robot->nx));
+  for (auto &x : xs) {
+    robot->sample_uniform(x);
+  }
+
+  std::vector<double> h_fake(num_queries), h_state(num_queries);
+  double time_fake = timed_fun_void([&] {
+    for (size_t i = 0; i < num_queries; i++) {
+      auto fake_node = std::make_unique<AStarNode>();
+      fake_node->state_eig = xs[i];
+      h_fake[i] = heuristic_nn->nearest(fake_node.get())->gScore;
+    }
+  });
+  double time_state = timed_fun_void([&] {
+    for (size_t i = 0; i < num_queries; i++) {
+      h_state[i] = heu.h(xs[i]);
+    }
+  });
+
+  BOOST_TEST((h_fake == h_state));
+  std::cout << "Heu_roadmap_bwd (" << heuristic_nn->size()
+            << " nodes): fake node [ms] " << time_fake << " state query [ms] "
+            << time_state << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(test_constraint_table) {
+
+  // Constraint_table against the linear check over all the constraints
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/swap/swap1_unicycle.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotType + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+  const double delta = .3;
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> jitter(-.4, .4);
+  std::uniform_int_distribution<int> step(0, 100);
+
+  // few constraints (no grid) and many constraints (with grid)
+  for (size_t num_constraints : {5, 3000}) {
+    std::vector<Constraint> constraints(num_constraints);
+    for (auto &c : constraints) {
+      c.time = (step(gen) + jitter(gen)) * robot->ref_dt;
+      c.constrained_state.resize(robot->nx);
+      robot->sample_uniform(c.constrained_state);
+    }
+    Constraint_table table(constraints, *robot, delta);
+    BOOST_TEST(table.size() == num_constraints);
+
+    const size_t size = 11;
+    dynobench::TrajWrapper traj;
+    traj.allocate_size(size, robot->nx, robot->nu);
+    traj.set_size(size);
+    Eigen::VectorXd x(robot->nx);
+
+    size_t num_violations = 0;
+    for (size_t trial = 0; trial < 1000; trial++) {
+      robot->sample_uniform(x);
+      for (size_t i = 0; i < size; i++) {
+        traj.get_state(i) = x;
+        x.head(2) += .05 * Eigen::Vector2d::Random();
+      }
+      const float g0 = step(gen) * robot->ref_dt;
+      const bool reaches_goal = trial % 2;
+
+      bool violation = false;
+      for (auto &c : constraints) {
+        float time_offset = c.time - g0;
+        int time_index = std::lround(time_offset / robot->ref_dt);
+        int i = -1;
+        if (reaches_goal && time_index >= (int)size - 1) {
+          i = size - 1;
+        }
+        if (time_index >= 0 && time_index < (int)size - 1) {
+          i = time_index;
+        }
+        if (i >= 0 &&
+            robot->distance(traj.get_state(i), c.constrained_state) <= delta) {
+          violation = true;
+          break;
+        }
+      }
+      BOOST_TEST(table.violated_trajectory(traj, g0, reaches_goal) ==
+                 violation);
+
+      bool violation_after = false;
+      for (auto &c : constraints) {
+        if (c.time >= g0 - 1e-6 &&
+            robot->distance(x, c.constrained_state) <= delta) {
+          violation_after = true;
+          break;
+        }
+      }
+      BOOST_TEST(table.violated_after(x, g0 - 1e-6) == violation_after);
+      num_violations += violation;
+    }
+    std::cout << "constraints " << num_constraints << " violations "
+              << num_violations << std::endl;
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_record_expanded_trajs, Swap_fixture) {
+
+  auto run = [&](int mode) {
+    Options_tdbastar options = o_uni1;
+    options.record_expanded_trajs = mode;
+    options.record_expanded_size = 10;
+    options.record_expanded_every = 7;
+    std::vector<dynobench::Trajectory> expanded_trajs;
+    Trajectory traj_out;
+    Out_info_tdb info_out;
+    size_t robot_id = 0;
+    BOOST_REQUIRE_NO_THROW(tdbastar(problem, options, traj_out,
+                                    /*constraints*/ {}, info_out, robot_id,
+                                    /*reverse_search*/ false, expanded_trajs,
+                                    nullptr, nullptr));
+    BOOST_TEST(info_out.solved);
+    return expanded_trajs;
+  };
+
+  // default: no copies of the expanded trajectories
+  BOOST_TEST(run(0).size() == 0);
+
+  auto all = run(1);
+  BOOST_TEST(all.size() > 10);
+
+  auto ring = run(2);
+  BOOST_TEST(ring.size() == 10);
+  for (size_t i = 0; i < ring.size(); i++) {
+    auto &t = all.at(all.size() - ring.size() + i);
+    BOOST_TEST(ring[i].states.front().isApprox(t.states.front()));
+    BOOST_TEST(ring[i].cost == t.cost);
+  }
+
+  auto sample = run(3);
+  BOOST_TEST(sample.size() == (all.size() + 6) / 7);
+  BOOST_TEST(
+      sample.front().states.front().isApprox(all.front().states.front()));
+}
+
+namespace {
+// open list of tdbastar before the nodes were moved to AStarNode_pool
+struct compare_shared_node {
+  bool operator()(const std::shared_ptr<AStarNode> a,
+                  const std::shared_ptr<AStarNode> b) const {
+    if (a->fScore != b->fScore) {
+      return a->fScore > b->fScore;
+    } else {
+      return a->gScore < b->gScore;
+    }
+  }
+};
+using open_shared_t = boost::heap::d_ary_heap<
+    std::shared_ptr<AStarNode>, boost::heap::arity<2>,
+    boost::heap::compare<compare_shared_node>, boost::heap::mutable_<true>>;
+} // namespace
+
+BOOST_AUTO_TEST_CASE(bench_open_list, *boost::unit_test::disabled()) {
+
+  // push and pop of the same nodes, with raw pointers into an AStarNode_pool
+  // (open_t) and with shared_ptr and by value comparisons (previous version)
+  const size_t num_nodes = 2e5;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(0, 100);
+
+  AStarNode_pool pool;
+  std::vector<std::shared_ptr<AStarNode>> shared_nodes;
+  for (size_t i = 0; i < num_nodes; i++) {
+    AStarNode *n = pool.allocate();
+    n->gScore = dist(gen);
+    n->fScore = n->gScore + dist(gen);
+    shared_nodes.push_back(std::make_shared<AStarNode>());
+    shared_nodes.back()->gScore = n->gScore;
+    shared_nodes.back()->fScore = n->fScore;
+  }
+
+  std::vector<double> f_raw, f_shared;
+  double time_raw = timed_fun_void([&] {
+    open_t open;
+    for (auto &n : pool.nodes) {
+      n.handle = open.push(&n);
+    }
+    while (!open.empty()) {
+      f_raw.push_back(open.top()->fScore);
+      open.pop();
+    }
+  });
+  double time_shared = timed_fun_void([&] {
+    open_shared_t open;
+    for (auto &n : shared_nodes) {
+      open.push(n);
+    }
+    while (!open.empty()) {
+      f_shared.push_back(open.top()->fScore);
+      open.pop();
+    }
+  });
+
+  BOOST_TEST((f_raw == f_shared));
+  BOOST_TEST(std::is_sorted(f_raw.begin(), f_raw.end()));
+  std::cout << "open list (" << num_nodes << " nodes): raw pointers [ms] "
+            << time_raw << " shared_ptr [ms] " << time_shared << std::endl;
+}
+
+BOOST_FIXTURE_TEST_CASE(test_cbs, Swap_fixture) {
+
+  BOOST_REQUIRE(problem.robotTypes.size() > 1);
+
+  Options_cbs options_cbs;
+  options_cbs.num_threads = 2;
+
+  std::vector<Trajectory> trajs;
+  Out_info_cbs out_cbs;
+  BOOST_REQUIRE_NO_THROW(cbs(problem, {{"unicycle1_v0", o_uni1}}, options_cbs,
+                             trajs, out_cbs));
+  BOOST_TEST(out_cbs.solved);
+  BOOST_REQUIRE(trajs.size() == problem.robotTypes.size());
+
+  std::vector<std::shared_ptr<dynobench::Model_robot>> robots;
+  for (size_t i = 0; i < trajs.size(); i++) {
+    robots.push_back(dynobench::robot_factory(
+        (problem.models_base_path + problem.robotTypes[i] + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub));
+    BOOST_TEST(robots[i]->distance(trajs[i].states.back(),
+                                   problem.goals[i]) <= o_uni1.delta);
+  }
+  Cbs_conflict conflict;
+  BOOST_TEST(!first_conflict(trajs, robots, problem.robotTypes, o_uni1.delta,
+                             conflict));
+  double cost = 0;
+  for (auto &traj : trajs) {
+    cost += traj.cost;
+  }
+  BOOST_TEST(out_cbs.cost == cost);
+
+  // the caches of the replans do not change the solution
+  options_cbs.incremental = false;
+  Out_info_cbs out_no_cache;
+  std::vector<Trajectory> trajs_no_cache;
+  BOOST_REQUIRE_NO_THROW(cbs(problem, {{"unicycle1_v0", o_uni1}}, options_cbs,
+                             trajs_no_cache, out_no_cache));
+  BOOST_TEST(out_no_cache.solved == out_cbs.solved);
+  BOOST_TEST(out_no_cache.cost == out_cbs.cost);
+  BOOST_TEST(out_no_cache.cache_hits == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_tdbastar_cache, Swap_fixture) {
+
+  // replanning with the collision checks of the previous searches gives the
+  // same solution as a search from scratch
+
+  Tdbastar_cache cache;
+  std::vector<Constraint> constraints;
+  std::vector<dynobench::Trajectory> expanded_trajs;
+  size_t robot_id = 0;
+  for (size_t k = 0; k < 3; k++) {
+    Trajectory traj_fresh, traj_cached;
+    Out_info_tdb info_fresh, info_cached;
+    BOOST_REQUIRE_NO_THROW(tdbastar(problem, o_uni1, traj_fresh, constraints,
+                                    info_fresh, robot_id,
+                                    /*reverse_search*/ false, expanded_trajs));
+    size_t hits = cache.hits;
+    BOOST_REQUIRE_NO_THROW(tdbastar(problem, o_uni1, traj_cached, constraints,
+                                    info_cached, robot_id,
+                                    /*reverse_search*/ false, expanded_trajs,
+                                    nullptr, nullptr, &cache));
+    BOOST_REQUIRE(info_fresh.solved == info_cached.solved);
+    if (!info_fresh.solved) {
+      break;
+    }
+    BOOST_TEST(info_fresh.cost == info_cached.cost);
+    BOOST_TEST(traj_fresh.states.size() == traj_cached.states.size());
+    if (k > 0) {
+      BOOST_TEST(cache.hits > hits);
+    }
+    // next replan: forbid the middle state of the solution
+    size_t t = traj_fresh.states.size() / 2;
+    constraints.push_back({t * robot->ref_dt, traj_fresh.states.at(t)});
+  }
+  std::cout << "cache states " << cache.size() << " hits " << cache.hits
+            << " misses " << cache.misses << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE(bench_first_conflict, *boost::unit_test::disabled()) {
+
+  // sweep and prune (sequential and parallel) against all the pairs, with
+  // random walks of unicycles
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      DYNOBENCH_BASE "models/unicycle1_v0.yaml", Eigen::Vector2d(0, 0),
+      Eigen::Vector2d(50, 50));
+  const double delta = .5;
+  const size_t num_steps = 2000;
+  std::mt19937 g(0);
+  std::uniform_real_distribution<double> position(0, 50);
+  std::normal_distribution<double> step(0, .02);
+  Thread_pool pool(4);
+
+  for (size_t num_robots : {5, 10, 20, 50}) {
+    std::vector<std::shared_ptr<dynobench::Model_robot>> robots(num_robots,
+                                                                robot);
+    std::vector<std::string> robot_types(num_robots, "unicycle1_v0");
+    std::vector<Trajectory> trajs(num_robots);
+    for (auto &traj : trajs) {
+      Eigen::Vector3d x(position(g), position(g), 0);
+      for (size_t t = 0; t < num_steps; t++) {
+        x += Eigen::Vector3d(step(g), step(g), step(g));
+        traj.states.push_back(x);
+      }
+    }
+
+    Cbs_conflict c_brute, c_sweep, c_parallel;
+    bool f_brute, f_sweep, f_parallel;
+    Conflict_detector detector(robots, robot_types, delta);
+    double time_brute = timed_fun_void([&] {
+      f_brute = first_conflict_brute_force(trajs, robots, robot_types, delta,
+                                           c_brute);
+    });
+    double time_sweep = timed_fun_void(
+        [&] { f_sweep = detector.first_conflict(trajs, c_sweep); });
+    double time_parallel = timed_fun_void([&] {
+      f_parallel = detector.first_conflict(trajs, c_parallel, &pool);
+    });
+
+    for (auto &[f, c] : {std::make_pair(f_sweep, c_sweep),
+                         std::make_pair(f_parallel, c_parallel)}) {
+      BOOST_TEST(f == f_brute);
+      if (f && f_brute) {
+        BOOST_TEST(c.time_step == c_brute.time_step);
+        BOOST_TEST(c.robot_a == c_brute.robot_a);
+        BOOST_TEST(c.robot_b == c_brute.robot_b);
+      }
+    }
+    std::cout << "first conflict, " << num_robots << " robots (conflict "
+              << f_brute << " at " << (f_brute ? c_brute.time_step : 0)
+              << "): all pairs [ms] " << time_brute << " sweep [ms] "
+              << time_sweep << " parallel [ms] " << time_parallel << std::endl;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_reservation_table) {
+
+  // Reservation_table against the pairwise check with all the states
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      DYNOBENCH_BASE "models/unicycle1_v0.yaml", Eigen::Vector2d(0, 0),
+      Eigen::Vector2d(10, 10));
+  const double delta = .5;
+  const size_t num_robots = 6;
+  std::vector<std::shared_ptr<dynobench::Model_robot>> robots(num_robots,
+                                                              robot);
+  std::vector<std::string> robot_types(num_robots, "unicycle1_v0");
+  std::mt19937 g(0);
+  std::uniform_real_distribution<double> position(0, 10);
+  std::normal_distribution<double> step(0, .1);
+
+  // the last robot is the one being planned
+  Conflict_detector detector(robots, robot_types, delta);
+  Reservation_table table(robots, robot_types, delta);
+  std::vector<Trajectory> trajs(num_robots - 1);
+  for (size_t j = 0; j < trajs.size(); j++) {
+    Eigen::Vector3d x(position(g), position(g), 0);
+    for (size_t t = 0; t < 50 + 20 * j; t++) {
+      x += Eigen::Vector3d(step(g), step(g), step(g));
+      trajs[j].states.push_back(x);
+    }
+    table.add(j, trajs[j]);
+  }
+
+  size_t robot_id = num_robots - 1;
+  size_t num_conflicts = 0;
+  for (size_t k = 0; k < 5000; k++) {
+    Eigen::Vector3d x(position(g), position(g), step(g));
+    long t = g() % 200;
+    bool in_conflict = false, violated_after = false;
+    for (size_t j = 0; j < trajs.size(); j++) {
+      auto &states = trajs[j].states;
+      size_t t_j = std::min<size_t>(t, states.size() - 1);
+      in_conflict |= detector.in_conflict(robot_id, j, x, states[t_j]);
+      for (size_t s = t_j; s < states.size(); s++) {
+        violated_after |= detector.in_conflict(robot_id, j, x, states[s]);
+      }
+    }
+    num_conflicts += in_conflict;
+    BOOST_TEST(table.in_conflict(robot_id, x, t) == in_conflict);
+    BOOST_TEST(table.violated_after(robot_id, x, t * robot->ref_dt) ==
+               violated_after);
+  }
+  BOOST_TEST(num_conflicts > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_prioritized, Swap_fixture) {
+
+  BOOST_REQUIRE(problem.robotTypes.size() > 1);
+
+  Options_prioritized options_prioritized;
+  options_prioritized.num_restarts = 4;
+  options_prioritized.num_threads = 2;
+
+  std::vector<Trajectory> trajs;
+  Out_info_prioritized out;
+  BOOST_REQUIRE_NO_THROW(prioritized(problem, {{"unicycle1_v0", o_uni1}},
+                                     options_prioritized, trajs, out));
+  BOOST_TEST(out.solved);
+  BOOST_REQUIRE(trajs.size() == problem.robotTypes.size());
+  BOOST_TEST(out.order.size() == problem.robotTypes.size());
+
+  std::vector<std::shared_ptr<dynobench::Model_robot>> robots;
+  double cost = 0;
+  for (size_t i = 0; i < trajs.size(); i++) {
+    robots.push_back(dynobench::robot_factory(
+        (problem.models_base_path + problem.robotTypes[i] + ".yaml").c_str(),
+        problem.p_lb, problem.p_ub));
+    BOOST_TEST(robots[i]->distance(trajs[i].states.back(),
+                                   problem.goals[i]) <= o_uni1.delta);
+    cost += trajs[i].cost;
+  }
+  Cbs_conflict conflict;
+  BOOST_TEST(!first_conflict(trajs, robots, problem.robotTypes, o_uni1.delta,
+                             conflict));
+  BOOST_TEST(out.cost == cost);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_primitive_library, Swap_fixture) {
+
+  // one library shared by two threads gives the same solutions as searches
+  // with their own motions
+  BOOST_REQUIRE(problem.robotTypes.size() > 1);
+
+  auto library =
+      std::make_shared<const Primitive_library>("unicycle1_v0", robot, o_uni1);
+  BOOST_TEST(library->motions.size() == o_uni1.max_motions);
+  BOOST_TEST(library->compatible("unicycle1_v0", o_uni1));
+  Options_tdbastar o_other = o_uni1;
+  o_other.max_motions = 50;
+  BOOST_TEST(!library->compatible("unicycle1_v0", o_other));
+  o_other = o_uni1;
+  o_other.cut_actions = !o_uni1.cut_actions;
+  BOOST_TEST(!library->compatible("unicycle1_v0", o_other));
+  o_other = o_uni1;
+  o_other.check_cols = !o_uni1.check_cols;
+  BOOST_TEST(!library->compatible("unicycle1_v0", o_other));
+
+  const size_t num_robots = 2;
+  std::vector<double> cost_own(num_robots), cost_shared(num_robots);
+  for (size_t i = 0; i < num_robots; i++) {
+    std::vector<Motion> motions;
+    load_motion_primitives_new(o_uni1.motionsFile, *robot, motions,
+                               o_uni1.max_motions, o_uni1.cut_actions, false,
+                               o_uni1.check_cols);
+    Options_tdbastar options = o_uni1;
+    options.motions_ptr = &motions;
+    Trajectory traj;
+    Out_info_tdb info;
+    std::vector<Trajectory> expanded_trajs;
+    size_t robot_id = i;
+    tdbastar(problem, options, traj, {}, info, robot_id, false,
+             expanded_trajs);
+    BOOST_TEST(info.solved);
+    cost_own[i] = info.cost;
+  }
+
+  Thread_pool pool(num_robots);
+  pool.parallel_for(num_robots, [&](size_t i, size_t) {
+    Options_tdbastar options = o_uni1;
+    options.primitives_ptr = library.get();
+    Trajectory traj;
+    Out_info_tdb info;
+    std::vector<Trajectory> expanded_trajs;
+    size_t robot_id = i;
+    tdbastar(problem, options, traj, {}, info, robot_id, false,
+             expanded_trajs);
+    cost_shared[i] = info.solved ? info.cost : -1;
+  });
+  for (size_t i = 0; i < num_robots; i++) {
+    BOOST_TEST(cost_shared[i] == cost_own[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_motion_registry) {
+
+  // a set is loaded once, and the binary cache gives the same trajectories
+  // as the primitive file
+  Problem problem(DYNOBENCH_BASE "envs/unicycle1_v0/swap/swap1_unicycle.yaml");
+  problem.models_base_path = DYNOBENCH_BASE "models/";
+  std::shared_ptr<dynobench::Model_robot> robot = dynobench::robot_factory(
+      (problem.models_base_path + problem.robotTypes[0] + ".yaml").c_str(),
+      problem.p_lb, problem.p_ub);
+
+  const std::string motions_file =
+      BASE_PATH_MOTIONS "unicycle1_v0__ispso__2023_04_03__14_56_57.bin.im.bin."
+                        "im.bin.small5000.msgpack";
+  const std::string cache_dir =
+      (std::filesystem::temp_directory_path() / "dynoplan_test_motions")
+          .string();
+  std::filesystem::remove_all(cache_dir);
+
+  std::vector<Trajectory> trajs;
+  {
+    Motion_registry registry;
+    registry.cache_dir = cache_dir;
+    registry.set_motions_file("unicycle1_v0", motions_file);
+    auto a = registry.motions("unicycle1_v0", *robot, 100);
+    auto b = registry.load(motions_file, *robot, 100);
+    BOOST_TEST(a.get() == b.get());
+    BOOST_TEST(a->size() == 100);
+    BOOST_TEST(registry.num_loads() == 1);
+    BOOST_TEST(registry.num_hits() == 1);
+    auto c = registry.load(motions_file, *robot, 50);
+    BOOST_TEST(c->size() == 50);
+    BOOST_TEST(registry.num_loads() == 2);
+    for (auto &m : *a) {
+      trajs.push_back(m.traj);
+    }
+  }
+
+  Motion_registry registry;
+  registry.cache_dir = cache_dir;
+  auto motions = registry.load(motions_file, *robot, 100);
+  BOOST_TEST_REQUIRE(motions->size() == trajs.size());
+  for (size_t i = 0; i < trajs.size(); i++) {
+    const Motion &m = motions->at(i);
+    BOOST_TEST(m.idx == i);
+    BOOST_TEST(m.cost == trajs[i].cost);
+    BOOST_TEST_REQUIRE(m.traj.states.size() == trajs[i].states.size());
+    for (size_t j = 0; j < trajs[i].states.size(); j++) {
+      BOOST_TEST(m.traj.states[j] == trajs[i].states[j]);
+    }
+    BOOST_TEST(m.collision_objects.size() ==
+               m.traj.states.size() * robot->collision_geometries.size());
+  }
+
+  // a truncated cache, or one with a corrupted count, is reloaded
+  std::string file;
+  for (auto &entry : std::filesystem::directory_iterator(cache_dir)) {
+    file = entry.path().string();
+  }
+  BOOST_TEST_REQUIRE(file.size());
+  std::string bytes;
+  {
+    std::ifstream in(file, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  uint64_t hash = 0;
+  std::memcpy(&hash, bytes.data() + 8, sizeof(hash));
+  auto write_bytes = [&](const std::string &data) {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+  };
+
+  dynobench::Trajectories cached;
+  BOOST_TEST(read_primitive_cache(file, hash, cached));
+  BOOST_TEST(cached.data.size() == trajs.size());
+
+  write_bytes(bytes.substr(0, bytes.size() - 8));
+  BOOST_TEST(!read_primitive_cache(file, hash, cached));
+  BOOST_TEST(cached.data.empty());
+
+  std::string corrupted = bytes;
+  const uint64_t huge = uint64_t(1) << 60;
+  std::memcpy(&corrupted[16], &huge, sizeof(huge));
+  write_bytes(corrupted);
+  BOOST_TEST(!read_primitive_cache(file, hash, cached));
+
+  write_bytes(bytes.substr(0, bytes.size() / 2));
+  Motion_registry registry_reload;
+  registry_reload.cache_dir = cache_dir;
+  auto reloaded = registry_reload.load(motions_file, *robot, 100);
+  BOOST_TEST(reloaded->size() == trajs.size());
+  BOOST_TEST(read_primitive_cache(file, hash, cached));
+
+  std::filesystem::remove_all(cache_dir);
+}